@@ -0,0 +1,168 @@
+//
+// Positional sound effects and streamed music.
+//
+
+#include "Audio.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include "Match.h"
+
+const int AUDIO_CHANNELS = 16;
+const double FALLOFF_PIXELS = 400; // Half as loud this far from the listener
+
+static const struct {
+    const char *file;
+    double gain;
+} SoundFiles[SND_COUNT] = {
+    {"sounds/explosion_x.wav", 1.0},
+    {"sounds/explosion_x.wav", 0.45}, // Walls only crumble a little
+};
+
+static int64_t ThreadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+bool TAudio::Open(int frequency, int chunkFrames)
+{
+    if (Mix_OpenAudio(frequency, MIX_DEFAULT_FORMAT, 2, chunkFrames) < 0) {
+        printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+        return false;
+    }
+    int rate = frequency;
+    Uint16 format;
+    int outChannels;
+    Mix_QuerySpec(&rate, &format, &outChannels);
+    periodNs = (int64_t)chunkFrames * 1000000000 / std::max(1, rate);
+    channels = Mix_AllocateChannels(AUDIO_CHANNELS);
+    voiceLimit = channels;
+    Mix_SetPostMix(&TAudio::PostMix, this);
+    open = true;
+    return true;
+}
+
+void TAudio::Close()
+{
+    if (!open)
+        return;
+    Mix_HaltMusic();
+    Mix_HaltChannel(-1);
+    Mix_SetPostMix(nullptr, nullptr);
+    Mix_FreeMusic(music);
+    music = nullptr;
+    for (Mix_Chunk *&s : sounds) {
+        Mix_FreeChunk(s);
+        s = nullptr;
+    }
+    Mix_CloseAudio();
+    open = false;
+}
+
+bool TAudio::LoadSounds()
+{
+    bool ok = true;
+    for (int i = 0; i < SND_COUNT; i++) {
+        if (sounds[i] == nullptr)
+            sounds[i] = Mix_LoadWAV(SoundFiles[i].file);
+        if (sounds[i] == nullptr) {
+            printf("Failed to load %s! SDL_mixer Error: %s\n", SoundFiles[i].file, Mix_GetError());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool TAudio::PlayMusic(const char *file, int volume)
+{
+    if (!open)
+        return false;
+    Mix_HaltMusic();
+    Mix_FreeMusic(music);
+    music = Mix_LoadMUS(file); // Opened, not decoded
+    if (music == nullptr) {
+        printf("Failed to open %s! SDL_mixer Error: %s\n", file, Mix_GetError());
+        return false;
+    }
+    Mix_VolumeMusic(volume);
+    return Mix_PlayMusic(music, -1) == 0;
+}
+
+/****************************************************************************
+ * Pan with equal power, so a sound keeps its loudness as it moves across,
+ * and fade with distance. The channel is set up before it starts so the
+ * first samples are already in place.
+ ***************************************************************************/
+void TAudio::PlayAt(TSoundId id, int x, int y, int listenerX, int listenerY)
+{
+    if (!open || sounds[id] == nullptr)
+        return;
+
+    // Fewer voices while the mixer is over budget, more again once it is well under
+    const double share = RecentShare();
+    if (share > BUDGET)
+        voiceLimit = std::max(2, voiceLimit - 1);
+    else if (share < BUDGET / 2)
+        voiceLimit = std::min(channels, voiceLimit + 1);
+    if (Mix_Playing(-1) >= voiceLimit) {
+        dropped++;
+        return;
+    }
+    const int channel = Mix_GroupAvailable(-1);
+    if (channel < 0) {
+        dropped++;
+        return;
+    }
+
+    const double dx = x - listenerX, dy = y - listenerY;
+    const double pan = std::clamp(dx / (PLAY_WIDTH / 2.0), -1.0, 1.0);
+    const double angle = (pan + 1) * 0.78539816; // 0 to a quarter turn
+    const double gain = SoundFiles[id].gain / (1 + std::sqrt(dx * dx + dy * dy) / FALLOFF_PIXELS);
+    Mix_SetPanning(channel, (Uint8)std::lround(255 * std::cos(angle)),
+                   (Uint8)std::lround(255 * std::sin(angle)));
+    Mix_Volume(channel, (int)std::lround(MIX_MAX_VOLUME * gain));
+    Mix_PlayChannel(channel, sounds[id], 0);
+}
+
+/****************************************************************************
+ * Runs on the mixer thread after every buffer is mixed. Everything the
+ * thread did since the last call, decoding music included, is charged to
+ * this buffer.
+ ***************************************************************************/
+void TAudio::PostMix(void *udata, Uint8 *, int)
+{
+    TAudio &audio = *static_cast<TAudio *>(udata);
+    const int64_t now = ThreadCpuNs();
+    if (audio.lastCpuNs >= 0) {
+        const int64_t used = now - audio.lastCpuNs;
+        audio.totalNs += used;
+        if (used > audio.worstNs)
+            audio.worstNs = used;
+        // Average over about 20 buffers
+        audio.recentNs = audio.recentNs + (used - audio.recentNs) / 20;
+        audio.callbacks++;
+    }
+    audio.lastCpuNs = now;
+}
+
+double TAudio::MeanMs() const
+{
+    const long n = callbacks;
+    return n > 0 ? totalNs / 1e6 / n : 0;
+}
+
+double TAudio::RecentShare() const
+{
+    return periodNs > 0 ? (double)recentNs / periodNs : 0;
+}
+
+void TAudio::Format(char *buf, size_t size) const
+{
+    snprintf(buf, size, "%ld callbacks of %.1f ms, mixer CPU mean %.3f ms (%.1f%%), worst %.3f ms, "
+             "budget %.0f%%, voice limit %d, %ld effects dropped",
+             (long)callbacks, PeriodMs(), MeanMs(), periodNs > 0 ? 100.0 * MeanMs() / PeriodMs() : 0,
+             WorstMs(), BUDGET * 100, voiceLimit, dropped);
+}
@@ -0,0 +1,76 @@
+//
+// Positional sound effects and streamed music.
+//
+
+#ifndef TANKS2_AUDIO_H
+#define TANKS2_AUDIO_H
+
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum TSoundId { SND_TANK_HIT, SND_WALL_HIT, SND_COUNT };
+
+/****************************************************************************
+ * Sound effects are placed relative to a listener, the player's tank:
+ * panned by how far left or right of it they are and quieter the further
+ * away. Sounds on other screens are not played at all.
+ *
+ * Music is opened with Mix_LoadMUS, which decodes it bit by bit on the
+ * mixer thread as it plays, so a whole decoded track is never held in
+ * memory.
+ *
+ * The mixer thread's CPU time is measured on every callback, as thread
+ * CPU time between consecutive callbacks. When its recent average goes
+ * over the budget share of a callback period, fewer effects may play at
+ * once until it is back under.
+ ***************************************************************************/
+class TAudio {
+public:
+    // Share of each callback period the mixer thread may use
+    static constexpr double BUDGET = 0.25;
+
+    TAudio() = default;
+    ~TAudio() { Close(); }
+    TAudio(const TAudio &) = delete;
+    TAudio &operator=(const TAudio &) = delete;
+
+    bool Open(int frequency = 44100, int chunkFrames = 2048);
+    void Close();
+    bool IsOpen() const { return open; }
+    // Load the effects. False if one is missing; the others still play.
+    bool LoadSounds();
+    // Stream a music file in a loop, replacing any music playing
+    bool PlayMusic(const char *file, int volume = MIX_MAX_VOLUME / 3);
+
+    // A sound at (x, y) on the listener's screen
+    void PlayAt(TSoundId id, int x, int y, int listenerX, int listenerY);
+
+    long Callbacks() const { return callbacks; }
+    double PeriodMs() const { return periodNs / 1e6; }
+    double MeanMs() const;
+    double WorstMs() const { return worstNs / 1e6; }
+    double RecentShare() const; // Of the period, averaged over the last second or so
+    int VoiceLimit() const { return voiceLimit; }
+    long Dropped() const { return dropped; }
+    void Format(char *buf, size_t size) const;
+
+private:
+    static void PostMix(void *udata, Uint8 *stream, int len);
+
+    bool open = false;
+    int channels = 0;
+    Mix_Chunk *sounds[SND_COUNT] = {};
+    Mix_Music *music = nullptr;
+    int voiceLimit = 0;
+    long dropped = 0; // Effects not played to stay in budget
+
+    // Written by the mixer thread
+    int64_t periodNs = 0;
+    int64_t lastCpuNs = -1;
+    std::atomic<long> callbacks{0};
+    std::atomic<int64_t> totalNs{0}, worstNs{0}, recentNs{0};
+};
+
+#endif //TANKS2_AUDIO_H
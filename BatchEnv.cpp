@@ -0,0 +1,124 @@
+//
+// Batched stepping of many matches for training agents.
+//
+
+#include "BatchEnv.h"
+#include <algorithm>
+#include <cstring>
+
+const int ENV_CHUNK = 16; // Worlds per thread pool item
+
+TBatchEnv::TBatchEnv(int count, uint32_t seed, int threads, int maxSteps)
+    : worlds(count > 0 ? count : 1), pool(threads), baseSeed(seed), maxSteps(maxSteps)
+{
+    for (size_t i = 0; i < worlds.size(); i++) {
+        worlds[i].index = (uint32_t)i;
+        worlds[i].match = std::make_unique<Match>();
+    }
+}
+
+/****************************************************************************
+ * Mark every cell touched by a rectangle.
+ ***************************************************************************/
+static void FillCells(uint8_t *plane, int x, int y, int w, int h)
+{
+    int c1 = std::max(x, 0) / OBS_CELL;
+    int r1 = std::max(y, 0) / OBS_CELL;
+    int c2 = std::min((x + w - 1) / OBS_CELL, OBS_COLS - 1);
+    int r2 = std::min((y + h - 1) / OBS_CELL, OBS_ROWS - 1);
+    for (int r = r1; r <= r2; r++)
+        for (int c = c1; c <= c2; c++)
+            plane[r * OBS_COLS + c] = 1;
+}
+
+/****************************************************************************
+ * Start a new episode. Every world and episode gets its own seed, so a
+ * batch built with the same seed replays exactly.
+ ***************************************************************************/
+void TBatchEnv::ResetWorld(TEnvWorld &w)
+{
+    Match &m = *w.match;
+    m.rngState = baseSeed * 2654435761u + w.index * 40503u + w.episode * 977u + 1;
+    w.episode++;
+    m.InitLists();
+    m.curScrn = 0;
+    m.playerIdx = GoodGuyIdx;
+    w.steps = 0;
+    w.redLeft = m.redCount;
+
+    w.wallGrid.assign(OBS_PLANE * m.ScreenCount(), 0);
+    for (const TItemRec &b : m.blocksList)
+        FillCells(&w.wallGrid[b.screen * OBS_PLANE], b.x, b.y, blockWidth, blockHeight);
+    for (const TItemRec &t : m.treeList)
+        FillCells(&w.wallGrid[t.screen * OBS_PLANE], t.x, t.y, treeWidth, treeHeight);
+}
+
+/****************************************************************************
+ * Draw the agent's current screen into one world's slice of obs.
+ ***************************************************************************/
+void TBatchEnv::Observe(const TEnvWorld &w, uint8_t *obs) const
+{
+    const Match &m = *w.match;
+    const int scrn = m.curScrn;
+    memset(obs, 0, OBS_PLANE * OBS_WALL);
+    memcpy(obs + OBS_PLANE * OBS_WALL, &w.wallGrid[scrn * OBS_PLANE], OBS_PLANE);
+
+    for (size_t i = 0; i < m.tanksList.size(); i++) {
+        const TItemRec &t = m.tanksList[i];
+        if (t.screen != scrn || t.color == DeadTank)
+            continue;
+        int plane = (int)i == m.playerIdx ? OBS_SELF : OBS_ENEMY;
+        FillCells(obs + OBS_PLANE * plane, t.x, t.y, tankWidth, tankHeight);
+    }
+    for (size_t i = 0; i < m.bullets.Size(); i++) {
+        if (m.bullets.screen[i] == scrn)
+            FillCells(obs + OBS_PLANE * OBS_BULLET, m.bullets.x[i], m.bullets.y[i], 1, 1);
+    }
+}
+
+void TBatchEnv::StepWorld(TEnvWorld &w, uint8_t action, uint8_t *obs, float &reward,
+                          uint8_t &done)
+{
+    Match &m = *w.match;
+    m.ApplyAction(GoodGuyIdx, action);
+    m.UpdateGame();
+    w.steps++;
+
+    reward = (float)(w.redLeft - m.redCount);
+    w.redLeft = m.redCount;
+    if (m.blueCount < 1)
+        reward -= 1.0f;
+
+    done = m.CheckGameOver() != 0 || (maxSteps > 0 && w.steps >= maxSteps);
+    if (done)
+        ResetWorld(w);
+    Observe(w, obs);
+}
+
+/****************************************************************************
+ * Start a new episode in every world.
+ ***************************************************************************/
+void TBatchEnv::Reset(uint8_t *obs)
+{
+    int chunks = (Count() + ENV_CHUNK - 1) / ENV_CHUNK;
+    pool.ParallelFor(chunks, [&](int chunk) {
+        int end = std::min(Count(), (chunk + 1) * ENV_CHUNK);
+        for (int i = chunk * ENV_CHUNK; i < end; i++) {
+            ResetWorld(worlds[i]);
+            Observe(worlds[i], obs + OBS_SIZE * i);
+        }
+    });
+}
+
+/****************************************************************************
+ * Apply actions[i] to world i and advance every world by one tick.
+ ***************************************************************************/
+void TBatchEnv::Step(const uint8_t *actions, uint8_t *obs, float *rewards, uint8_t *dones)
+{
+    int chunks = (Count() + ENV_CHUNK - 1) / ENV_CHUNK;
+    pool.ParallelFor(chunks, [&](int chunk) {
+        int end = std::min(Count(), (chunk + 1) * ENV_CHUNK);
+        for (int i = chunk * ENV_CHUNK; i < end; i++)
+            StepWorld(worlds[i], actions[i], obs + OBS_SIZE * i, rewards[i], dones[i]);
+    });
+}
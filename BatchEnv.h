@@ -0,0 +1,72 @@
+//
+// Batched stepping of many matches for training agents.
+//
+
+#ifndef TANKS2_BATCHENV_H
+#define TANKS2_BATCHENV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Match.h"
+#include "ThreadPool.h"
+
+// Observation: occupancy grids of the agent's current screen, one byte per
+// cell, 1 where something covers any part of the cell.
+const int OBS_CELL = 16; // Pixels per grid cell
+const int OBS_COLS = PLAY_WIDTH / OBS_CELL;
+const int OBS_ROWS = PLAY_HEIGHT / OBS_CELL;
+enum TObsChannel { OBS_SELF, OBS_ENEMY, OBS_BULLET, OBS_WALL, OBS_CHANNELS };
+const size_t OBS_PLANE = (size_t)OBS_ROWS * OBS_COLS;
+const size_t OBS_SIZE = OBS_PLANE * OBS_CHANNELS; // Bytes per world
+
+/****************************************************************************
+ * N independent matches stepped in lockstep. The agent in every match
+ * drives the blue tank against the red tank AI, with the same action bits
+ * the keyboard produces (ACT_LEFT, ACT_RIGHT, ACT_FORWARD, ACT_FIRE).
+ *
+ * All output goes straight into buffers owned by the caller, laid out
+ * world after world:
+ *   obs     - Count() * OBS_SIZE bytes, [world][channel][row][col]
+ *   rewards - Count() floats; +1 per red tank destroyed, -1 when the
+ *             agent's tank is destroyed
+ *   dones   - Count() bytes, 1 when the episode ended on this step
+ * A world whose episode ends is reset straight away and its observation
+ * is the first one of the new episode.
+ ***************************************************************************/
+class TBatchEnv {
+public:
+    // threads: 0 for one per hardware thread.
+    // maxSteps: episode length limit, 0 for none.
+    TBatchEnv(int count, uint32_t seed = 1, int threads = 0, int maxSteps = FPS * 180);
+
+    int Count() const { return (int)worlds.size(); }
+    int Threads() const { return pool.Threads(); }
+    const Match &World(int i) const { return *worlds[i].match; }
+
+    void Reset(uint8_t *obs);
+    void Step(const uint8_t *actions, uint8_t *obs, float *rewards, uint8_t *dones);
+
+private:
+    struct alignas(64) TEnvWorld {
+        std::unique_ptr<Match> match;
+        uint32_t index = 0;
+        uint32_t episode = 0;
+        int steps = 0;
+        int redLeft = 0;
+        // Walls never move, so their grids are drawn once per episode
+        std::vector<uint8_t> wallGrid; // One plane per screen
+    };
+
+    void ResetWorld(TEnvWorld &w);
+    void StepWorld(TEnvWorld &w, uint8_t action, uint8_t *obs, float &reward, uint8_t &done);
+    void Observe(const TEnvWorld &w, uint8_t *obs) const;
+
+    std::vector<TEnvWorld> worlds;
+    TThreadPool pool;
+    uint32_t baseSeed;
+    int maxSteps;
+};
+
+#endif //TANKS2_BATCHENV_H
@@ -0,0 +1,151 @@
+//
+// Bullet movement on structure-of-arrays storage.
+//
+
+#include "Bullets.h"
+#include <algorithm>
+#include <cstring>
+
+void TBullets::Clear()
+{
+    x.clear();
+    y.clear();
+    dist.clear();
+    dx.clear();
+    dy.clear();
+    dir.clear();
+    out.clear();
+    screen.clear();
+}
+
+void TBullets::Add(int bx, int by, int bscreen, int directionIdx, int bdist)
+{
+    int d = directionIdx & 7;
+    x.push_back((int16_t)bx);
+    y.push_back((int16_t)by);
+    dist.push_back((int16_t)bdist);
+    dx.push_back(BulletDX[d]);
+    dy.push_back(BulletDY[d]);
+    dir.push_back((uint8_t)d);
+    out.push_back(0);
+    screen.push_back(bscreen);
+}
+
+TItemRec TBullets::Item(size_t i) const
+{
+    TItemRec b = {};
+    b.x = x[i];
+    b.y = y[i];
+    b.screen = screen[i];
+    b.directionIdx = dir[i];
+    b.dist = dist[i];
+    return b;
+}
+
+void TBullets::Load(const TItemList &list)
+{
+    Clear();
+    for (const TItemRec &b : list)
+        Add(b.x, b.y, b.screen, b.directionIdx, b.dist);
+}
+
+void TBullets::Store(TItemList &list) const
+{
+    list.resize(Size());
+    for (size_t i = 0; i < Size(); i++)
+        list[i] = Item(i);
+}
+
+/****************************************************************************
+ * A bullet is out once it would come within a pixel of the edge it is
+ * heading for. Only the axes it moves along are checked. All fields are the
+ * same width and the arrays are restrict pointers, so the loop vectorizes.
+ ***************************************************************************/
+static void StepKernel(size_t n, int16_t width, int16_t height, int16_t *__restrict px,
+                       int16_t *__restrict py, int16_t *__restrict pd,
+                       const int16_t *__restrict vx, const int16_t *__restrict vy,
+                       uint8_t *__restrict po)
+{
+    for (size_t i = 0; i < n; i++) {
+        int16_t nx = (int16_t)(px[i] + vx[i]);
+        int16_t ny = (int16_t)(py[i] + vy[i]);
+        bool hit = ((vx[i] < 0) & (nx <= 1)) | ((vx[i] > 0) & (nx >= width)) |
+                   ((vy[i] < 0) & (ny <= 1)) | ((vy[i] > 0) & (ny >= height));
+        px[i] = nx;
+        py[i] = ny;
+        pd[i] = (int16_t)(pd[i] + BULLET_SPEED);
+        po[i] = hit;
+    }
+}
+
+template <typename T>
+static void MoveRun(TTagVector<T, MEM_WORLD> &field, size_t to, size_t from, size_t count)
+{
+    memmove(field.data() + to, field.data() + from, count * sizeof(T));
+}
+
+/****************************************************************************
+ * Move the unmarked bullets of [begin, end) down to the write cursor w and
+ * return where the next one goes. memchr() finds the next marked bullet
+ * and the run before it is moved with one memmove per field, so the cost
+ * follows the memory moved rather than the number of bullets. Runs before
+ * the first marked bullet are already in place.
+ ***************************************************************************/
+size_t TBullets::Drop(size_t begin, size_t end, size_t w)
+{
+    const uint8_t *marks = out.data();
+    for (size_t from = begin; from < end;) {
+        const void *hit = memchr(marks + from, 1, end - from);
+        const size_t to = hit ? (const uint8_t *)hit - marks : end;
+        const size_t run = to - from;
+        if (w != from) {
+            MoveRun(x, w, from, run);
+            MoveRun(y, w, from, run);
+            MoveRun(dist, w, from, run);
+            MoveRun(dx, w, from, run);
+            MoveRun(dy, w, from, run);
+            MoveRun(dir, w, from, run);
+            MoveRun(screen, w, from, run);
+        }
+        w += run;
+        from = to + 1;
+    }
+    return w;
+}
+
+void TBullets::Truncate(size_t n)
+{
+    x.resize(n);
+    y.resize(n);
+    dist.resize(n);
+    dx.resize(n);
+    dy.resize(n);
+    dir.resize(n);
+    screen.resize(n);
+    out.assign(n, 0);
+}
+
+/****************************************************************************
+ * Step and drop a block at a time, so a block is still in the cache when
+ * its survivors are moved and the arrays are streamed through only once.
+ ***************************************************************************/
+size_t TBullets::Step(int width, int height)
+{
+    const size_t n = Size();
+    size_t w = 0;
+    for (size_t begin = 0; begin < n; begin += BLOCK) {
+        const size_t end = std::min(n, begin + BLOCK);
+        StepKernel(end - begin, (int16_t)width, (int16_t)height, x.data() + begin, y.data() + begin,
+                   dist.data() + begin, dx.data() + begin, dy.data() + begin, out.data() + begin);
+        w = Drop(begin, end, w);
+    }
+    Truncate(w);
+    return w;
+}
+
+size_t TBullets::Compact()
+{
+    const size_t left = Drop(0, Size(), 0);
+    Truncate(left);
+    return left;
+}
@@ -0,0 +1,65 @@
+//
+// Bullet movement on structure-of-arrays storage.
+//
+
+#ifndef TANKS2_BULLETS_H
+#define TANKS2_BULLETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Item.h"
+#include "SpriteInfo.h"
+
+const int BULLET_SPEED = 6; // Pixels per tick
+
+// Step per tick for each tank direction
+constexpr int16_t BulletDX[8] = {
+    SPRITE_DIR_X[0] * BULLET_SPEED, SPRITE_DIR_X[1] * BULLET_SPEED, SPRITE_DIR_X[2] * BULLET_SPEED,
+    SPRITE_DIR_X[3] * BULLET_SPEED, SPRITE_DIR_X[4] * BULLET_SPEED, SPRITE_DIR_X[5] * BULLET_SPEED,
+    SPRITE_DIR_X[6] * BULLET_SPEED, SPRITE_DIR_X[7] * BULLET_SPEED};
+constexpr int16_t BulletDY[8] = {
+    SPRITE_DIR_Y[0] * BULLET_SPEED, SPRITE_DIR_Y[1] * BULLET_SPEED, SPRITE_DIR_Y[2] * BULLET_SPEED,
+    SPRITE_DIR_Y[3] * BULLET_SPEED, SPRITE_DIR_Y[4] * BULLET_SPEED, SPRITE_DIR_Y[5] * BULLET_SPEED,
+    SPRITE_DIR_Y[6] * BULLET_SPEED, SPRITE_DIR_Y[7] * BULLET_SPEED};
+
+/****************************************************************************
+ * The bullets of a match, kept as one array per field. Moving them is a
+ * pass with no branches that the compiler vectorizes, and those that leave
+ * the screen are dropped in the same pass: each block is moved, then its
+ * survivors are moved down behind a write cursor while the block is still
+ * in the cache. Bullets removed for other reasons are marked and go
+ * together in one Compact(). Either way the rest keep their order.
+ *
+ * Positions, steps and distances are 16 bit, which is plenty for one
+ * screen and halves the memory each pass streams through.
+ ***************************************************************************/
+class TBullets {
+public:
+    size_t Size() const { return x.size(); }
+    void Clear();
+    void Add(int bx, int by, int screen, int directionIdx, int dist);
+    TItemRec Item(size_t i) const;
+
+    // Conversion from and to the world's bullet list
+    void Load(const TItemList &list);
+    void Store(TItemList &list) const;
+
+    // Move every bullet one tick and drop those that reach the edge of a
+    // width x height screen. Returns how many are left.
+    size_t Step(int width, int height);
+    // Mark a bullet to be dropped by the next Compact()
+    void Remove(size_t i) { out[i] = 1; }
+    // Drop the marked bullets. Returns how many are left.
+    size_t Compact();
+
+    TTagVector<int16_t, MEM_WORLD> x, y, dist, dx, dy;
+    TTagVector<uint8_t, MEM_WORLD> dir, out;
+    TTagVector<int32_t, MEM_WORLD> screen;
+
+private:
+    static const size_t BLOCK = 4096; // Bullets stepped and dropped at a time
+    size_t Drop(size_t begin, size_t end, size_t w);
+    void Truncate(size_t n);
+};
+
+#endif //TANKS2_BULLETS_H
@@ -0,0 +1,209 @@
+//
+// Dirty rectangle drawing for the software renderer.
+//
+
+#include "DirtyRenderer.h"
+#include <algorithm>
+
+const SDL_Color BackgroundColor = {220, 220, 180, 255}; // Same as ClearScreen()
+
+TDirtyRenderer::TDirtyRenderer(SDL_Window *window, TSpriteAtlas &atlas) : window(window), atlas(atlas)
+{
+}
+
+TDirtyRenderer::~TDirtyRenderer()
+{
+    Invalidate();
+}
+
+bool TDirtyRenderer::TSprite::operator==(const TSprite &o) const
+{
+    return image == o.image && src.x == o.src.x && src.y == o.src.y &&
+           dst.x == o.dst.x && dst.y == o.dst.y && dst.w == o.dst.w && dst.h == o.dst.h;
+}
+
+/****************************************************************************
+ * Draw at a new scale and position, e.g. after the window was resized. The
+ * atlas must already be at the same scale.
+ ***************************************************************************/
+void TDirtyRenderer::SetView(const TViewScale &newView)
+{
+    view = newView;
+    Invalidate();
+}
+
+void TDirtyRenderer::Invalidate()
+{
+    fullRedraw = true;
+    // Walls only change with a new game or level, but then they may
+    for (SDL_Surface *bg : background)
+        SDL_FreeSurface(bg);
+    background.clear();
+}
+
+/****************************************************************************
+ * Everything that moves on the current screen, in drawing order.
+ ***************************************************************************/
+void TDirtyRenderer::CollectSprites(const TRenderFrame &frame)
+{
+    sprites.clear();
+    auto add = [&](TSpriteId id, const TItemRec &r, int cell) {
+        SDL_Rect src = atlas.Frame(id, cell);
+        sprites.push_back({atlas.Surface(id), src, {view.X(r.x), view.Y(r.y), src.w, src.h}});
+    };
+    for (const TItemRec &t : frame.tanks) {
+        if (t.color == BlueTank)
+            add(SPR_BLUE_TANK, t, t.directionIdx);
+        else if (t.color == RedTank)
+            add(SPR_RED_TANK, t, t.directionIdx);
+        else if (t.color == DeadTank)
+            add(SPR_DEAD_TANK, t, t.directionIdx);
+    }
+    for (const TItemRec &b : frame.bullets)
+        sprites.push_back({nullptr, {0, 0, 0, 0}, view.Rect(b.x - 1, b.y - 1, 3, 3)});
+    for (const TItemRec &e : frame.explosions)
+        add(SPR_EXPLOSION, e, e.directionIdx);
+}
+
+/****************************************************************************
+ * Background colour and walls of the frame's screen, drawn on first use.
+ ***************************************************************************/
+SDL_Surface *TDirtyRenderer::Background(const TRenderFrame &frame)
+{
+    const int screen = frame.curScrn;
+    if (background.size() < (size_t)frame.screenCount)
+        background.resize(frame.screenCount, nullptr);
+    if (background[screen] != nullptr)
+        return background[screen];
+    SDL_Surface *target = SDL_GetWindowSurface(window);
+    SDL_Rect play = view.Rect(0, 0, PLAY_WIDTH, PLAY_HEIGHT);
+    SDL_Surface *bg = SDL_CreateRGBSurfaceWithFormat(0, play.w, play.h,
+                                                     target->format->BitsPerPixel,
+                                                     target->format->format);
+    if (bg == nullptr)
+        return nullptr;
+    SDL_FillRect(bg, nullptr, SDL_MapRGB(bg->format, BackgroundColor.r, BackgroundColor.g,
+                                         BackgroundColor.b));
+    // Placed edge to edge so a fractional scale leaves no seams
+    for (const TItemRec &b : frame.blocks) {
+        SDL_Rect dst = view.Rect(b.x, b.y, blockWidth, blockHeight);
+        dst.x -= view.offsetX;
+        dst.y -= view.offsetY;
+        SDL_BlitScaled(atlas.Surface(SPR_BLOCK), nullptr, bg, &dst);
+    }
+    background[screen] = bg;
+    return bg;
+}
+
+/****************************************************************************
+ * Restore one area from the background and draw whatever overlaps it.
+ ***************************************************************************/
+void TDirtyRenderer::Repaint(SDL_Surface *target, const TRenderFrame &frame, const SDL_Rect &area)
+{
+    SDL_SetClipRect(target, &area);
+    SDL_Rect from = {area.x - view.offsetX, area.y - view.offsetY, area.w, area.h};
+    SDL_Rect dst = area;
+    SDL_BlitSurface(Background(frame), &from, target, &dst);
+
+    const Uint32 black = SDL_MapRGB(target->format, 0, 0, 0);
+    for (const TSprite &s : sprites) {
+        if (!SDL_HasIntersection(&s.dst, &area))
+            continue;
+        dst = s.dst;
+        if (s.image == nullptr)
+            SDL_FillRect(target, &dst, black);
+        else
+            SDL_BlitSurface(s.image, &s.src, target, &dst);
+    }
+    // Trees cover everything
+    SDL_Surface *tree = atlas.Surface(SPR_TREE);
+    for (const TItemRec &t : frame.trees) {
+        SDL_Rect r = {view.X(t.x), view.Y(t.y), tree->w, tree->h};
+        if (SDL_HasIntersection(&r, &area))
+            SDL_BlitSurface(tree, nullptr, target, &r);
+    }
+    SDL_SetClipRect(target, nullptr);
+}
+
+/****************************************************************************
+ * Draw the frame and present the changed areas.
+ * Parameters:
+ *   frame     - What to show.
+ *   text      - Font used for the score.
+ *   scoreText - Status bar text, redrawn only when it changes.
+ ***************************************************************************/
+void TDirtyRenderer::Draw(const TRenderFrame &frame, DrawText &text, const char *scoreText)
+{
+    if (wallsVersion != frame.wallsVersion) {
+        Invalidate(); // A new level or a loaded game
+        wallsVersion = frame.wallsVersion;
+    }
+    SDL_Surface *target = SDL_GetWindowSurface(window);
+    if (target == nullptr || Background(frame) == nullptr)
+        return;
+    const SDL_Rect play = view.Rect(0, 0, PLAY_WIDTH, PLAY_HEIGHT);
+
+    CollectSprites(frame);
+    dirty.clear();
+    if (fullRedraw) {
+        // Black bars around the game when the window has another shape
+        SDL_FillRect(target, nullptr, SDL_MapRGB(target->format, 0, 0, 0));
+        dirty.push_back(play);
+        lastScore.clear();
+    } else if (frame.curScrn != lastScreen) {
+        dirty.push_back(play);
+        lastScore.clear();
+    } else {
+        // Whatever moved, changed frame, appeared or went away
+        auto addDirty = [&](const TSprite &s, const std::vector<TSprite> &other) {
+            SDL_Rect r;
+            if (std::find(other.begin(), other.end(), s) == other.end() &&
+                SDL_IntersectRect(&s.dst, &play, &r))
+                dirty.push_back(r);
+        };
+        for (const TSprite &s : prevSprites)
+            addDirty(s, sprites);
+        for (const TSprite &s : sprites)
+            addDirty(s, prevSprites);
+
+        // Merge overlapping areas so nothing is drawn twice
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < dirty.size(); i++) {
+                for (size_t j = i + 1; j < dirty.size(); j++) {
+                    if (SDL_HasIntersection(&dirty[i], &dirty[j])) {
+                        SDL_UnionRect(&dirty[i], &dirty[j], &dirty[i]);
+                        dirty.erase(dirty.begin() + (long)j);
+                        merged = true;
+                        j = i;
+                    }
+                }
+            }
+        }
+    }
+    for (const SDL_Rect &r : dirty)
+        Repaint(target, frame, r);
+
+    if (lastScore != scoreText) {
+        // Down to the bottom of the game, above the black bar if there is one
+        SDL_Rect bar = {play.x, play.y + play.h, play.w, target->h - view.offsetY - play.y - play.h};
+        SDL_FillRect(target, &bar, SDL_MapRGB(target->format, BackgroundColor.r,
+                                              BackgroundColor.g, BackgroundColor.b));
+        text.printText(target, scoreText, view.X(PLAY_WIDTH - 150), view.Y(PLAY_HEIGHT + 1));
+        dirty.push_back(bar);
+        lastScore = scoreText;
+    }
+    if (fullRedraw)
+        dirty.assign(1, {0, 0, target->w, target->h}); // Bars included
+
+    lastRects = (int)dirty.size();
+    lastPixels = 0;
+    for (const SDL_Rect &r : dirty)
+        lastPixels += (long)r.w * r.h;
+    if (!dirty.empty())
+        SDL_UpdateWindowSurfaceRects(window, dirty.data(), (int)dirty.size());
+
+    prevSprites.swap(sprites);
+    lastScreen = frame.curScrn;
+    fullRedraw = false;
+} // Draw
@@ -0,0 +1,70 @@
+//
+// Dirty rectangle drawing for the software renderer.
+//
+
+#ifndef TANKS2_DIRTYRENDERER_H
+#define TANKS2_DIRTYRENDERER_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+#include "DrawText.h"
+#include "RenderPipe.h"
+#include "SpriteAtlas.h"
+
+/****************************************************************************
+ * Draws the play screen straight into the window surface and updates only
+ * the parts that changed since the last frame. Walls are drawn once per
+ * screen into a cached background; each frame the previous and current
+ * boxes of every moving thing are restored from it, redrawn and presented
+ * with SDL_UpdateWindowSurfaceRects. The cost follows the amount of motion
+ * instead of the window size.
+ *
+ * Sprites come from the atlas at the current draw scale and are placed
+ * through the view, so the window may have any size.
+ *
+ * Only useful with the software renderer, which draws into the same window
+ * surface, so message boxes drawn through the renderer still show up.
+ ***************************************************************************/
+class TDirtyRenderer {
+public:
+    TDirtyRenderer(SDL_Window *window, TSpriteAtlas &atlas);
+    ~TDirtyRenderer();
+    TDirtyRenderer(const TDirtyRenderer &) = delete;
+    TDirtyRenderer &operator=(const TDirtyRenderer &) = delete;
+
+    void SetView(const TViewScale &newView);
+    // Redraw everything next frame, e.g. after a message box or a new game
+    void Invalidate();
+    void Draw(const TRenderFrame &frame, DrawText &text, const char *scoreText);
+
+    int LastRectCount() const { return lastRects; }
+    long LastPixels() const { return lastPixels; }
+
+private:
+    struct TSprite {
+        SDL_Surface *image; // nullptr for a bullet
+        SDL_Rect src;
+        SDL_Rect dst;
+        bool operator==(const TSprite &o) const;
+    };
+
+    void CollectSprites(const TRenderFrame &frame);
+    SDL_Surface *Background(const TRenderFrame &frame);
+    void Repaint(SDL_Surface *target, const TRenderFrame &frame, const SDL_Rect &area);
+
+    SDL_Window *window;
+    TSpriteAtlas &atlas;
+    TViewScale view;
+    std::vector<SDL_Surface *> background; // Per screen, drawn on first use
+    uint32_t wallsVersion = 0;              // Of the frame the backgrounds were drawn for
+    std::vector<TSprite> prevSprites, sprites;
+    std::vector<SDL_Rect> dirty;
+    std::string lastScore;
+    int lastScreen = -1;
+    bool fullRedraw = true;
+    int lastRects = 0;
+    long lastPixels = 0;
+};
+
+#endif //TANKS2_DIRTYRENDERER_H
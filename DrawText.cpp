@@ -65,3 +65,20 @@ void DrawText::printText(SDL_Renderer *renderer, char *szText, int x, int y){
 
 // printText
 
+/****************************************************************************
+ * Same as above, drawing straight into a surface.
+ ***************************************************************************/
+void DrawText::printText(SDL_Surface *surface, const char *szText, int x, int y){
+    if(!initialized)
+        fontInit();
+    SDL_Surface *fontSurface = TTF_RenderText_Solid(font, szText, fColor);
+    if(fontSurface == nullptr)
+        return;
+    fontRect.x = x;
+    fontRect.y = y;
+    fontRect.h = fontSurface->h;
+    fontRect.w = fontSurface->w;
+    SDL_BlitSurface(fontSurface, NULL, surface, &fontRect);
+    SDL_FreeSurface(fontSurface);
+}
+
@@ -28,6 +28,7 @@ public:
     void setFColor(const SDL_Color &fColor);
     void setFontFile(char *FontFile);
     void printText(SDL_Renderer *renderer, char *c, int x, int y);
+    void printText(SDL_Surface *surface, const char *c, int x, int y);
 
 }; // class DrawText
 
@@ -0,0 +1,112 @@
+//
+// Reloading files while the game runs.
+//
+
+#include "FileWatcher.h"
+#include <algorithm>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+TFileWatcher::~TFileWatcher()
+{
+    quit = true;
+    if (worker.joinable())
+        worker.join();
+#ifdef __linux__
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+void TFileWatcher::Watch(const std::string &path, TLoader loader)
+{
+    const size_t slash = path.rfind('/');
+    TWatch w;
+    w.path = path;
+    w.dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    w.name = slash == std::string::npos ? path : path.substr(slash + 1);
+    w.loader = std::move(loader);
+    if (std::find(dirs.begin(), dirs.end(), w.dir) == dirs.end())
+        dirs.push_back(w.dir);
+    watches.push_back(std::move(w));
+}
+
+bool TFileWatcher::Start()
+{
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+    for (const std::string &dir : dirs)
+        dirHandles.push_back(inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO));
+    worker = std::thread(&TFileWatcher::Run, this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/****************************************************************************
+ * The watcher thread: wait for changes, then load every file that changed
+ * once. The wait wakes up now and then to see whether it should stop.
+ ***************************************************************************/
+void TFileWatcher::Run()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[16 * 1024];
+    std::vector<int> changed;
+    while (!quit) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 100) <= 0)
+            continue;
+        const TClock::time_point noticed = TClock::now();
+        changed.clear();
+        ssize_t len;
+        while ((len = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char *at = buffer; at < buffer + len;) {
+                const inotify_event *ev = reinterpret_cast<const inotify_event *>(at);
+                at += sizeof(inotify_event) + ev->len;
+                if (ev->len == 0)
+                    continue;
+                const auto dir = std::find(dirHandles.begin(), dirHandles.end(), ev->wd);
+                if (dir == dirHandles.end())
+                    continue;
+                const std::string &dirName = dirs[dir - dirHandles.begin()];
+                for (size_t i = 0; i < watches.size(); i++)
+                    if (watches[i].dir == dirName && watches[i].name == ev->name &&
+                        std::find(changed.begin(), changed.end(), (int)i) == changed.end())
+                        changed.push_back((int)i);
+            }
+        }
+        for (int i : changed) {
+            TSwap swap = watches[i].loader(watches[i].path);
+            if (!swap)
+                continue;
+            std::lock_guard<std::mutex> guard(readyLock);
+            ready.push_back({std::move(swap), noticed});
+        }
+    }
+#endif
+}
+
+int TFileWatcher::ApplyReady()
+{
+    std::vector<TReady> batch;
+    {
+        std::lock_guard<std::mutex> guard(readyLock);
+        if (ready.empty())
+            return 0;
+        batch.swap(ready);
+    }
+    for (TReady &r : batch) {
+        r.swap();
+        lastMs = std::chrono::duration<double, std::milli>(TClock::now() - r.noticed).count();
+        totalMs += lastMs;
+        worstMs = std::max(worstMs, lastMs);
+        reloads++;
+    }
+    return (int)batch.size();
+}
@@ -0,0 +1,80 @@
+//
+// Reloading files while the game runs.
+//
+
+#ifndef TANKS2_FILEWATCHER_H
+#define TANKS2_FILEWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/****************************************************************************
+ * Watches files for changes, with inotify on Linux, and reloads them on a
+ * thread of its own. Each watched file has a loader that runs on that
+ * thread, reads and decodes the file, and returns the step that swaps the
+ * result in, or nothing if the file could not be used. The swaps wait
+ * until the game thread calls ApplyReady() between frames, so the game
+ * never touches a half loaded asset and never waits for the disk.
+ *
+ * Directories are watched rather than files, so editors that save by
+ * writing a new file and renaming it over the old one are seen as well.
+ * Changes that arrive together are loaded once.
+ *
+ * Elsewhere Start() fails and nothing is reloaded.
+ ***************************************************************************/
+class TFileWatcher {
+public:
+    using TClock = std::chrono::steady_clock;
+    using TSwap = std::function<void()>;
+    using TLoader = std::function<TSwap(const std::string &path)>;
+
+    TFileWatcher() = default;
+    ~TFileWatcher();
+    TFileWatcher(const TFileWatcher &) = delete;
+    TFileWatcher &operator=(const TFileWatcher &) = delete;
+
+    // Add before Start()
+    void Watch(const std::string &path, TLoader loader);
+    bool Start();
+
+    // Run the swaps that are ready. Returns how many there were.
+    int ApplyReady();
+
+    // From noticing a change to its swap, over all reloads
+    int Reloads() const { return reloads; }
+    double LastMs() const { return lastMs; }
+    double MeanMs() const { return reloads > 0 ? totalMs / reloads : 0; }
+    double WorstMs() const { return worstMs; }
+
+private:
+    struct TWatch {
+        std::string path, dir, name;
+        TLoader loader;
+    };
+    struct TReady {
+        TSwap swap;
+        TClock::time_point noticed;
+    };
+
+    void Run();
+
+    std::vector<TWatch> watches;
+    std::vector<std::string> dirs;
+    int fd = -1;
+    std::vector<int> dirHandles; // Parallel to dirs
+    std::thread worker;
+    std::atomic<bool> quit{false};
+
+    std::mutex readyLock;
+    std::vector<TReady> ready;
+
+    int reloads = 0;
+    double lastMs = 0, totalMs = 0, worstMs = 0;
+};
+
+#endif //TANKS2_FILEWATCHER_H
@@ -0,0 +1,198 @@
+//
+// Asynchronous export of rendered frames as PNG files or raw video.
+//
+
+#include "FrameExport.h"
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <cstring>
+
+TFrameExporter::TFrameExporter(TExportFormat format, const std::string &target, int width,
+                               int height, int workerCount, int buffers)
+    : format(format), target(target), width(width), height(height)
+{
+    if (format == EXPORT_PNG) {
+        if (this->target.find('%') == std::string::npos) {
+            size_t ext = this->target.rfind(".png");
+            this->target.insert(ext == std::string::npos ? this->target.size() : ext, "%05d");
+        }
+    } else if (target == "-") {
+        out = stdout;
+    } else if (!target.empty() && target[0] == '|') {
+        out = popen(target.c_str() + 1, "w");
+        outIsPipe = true;
+    } else {
+        out = fopen(target.c_str(), "wb");
+    }
+    if (format == EXPORT_YUV && out == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to open %s", target.c_str());
+        ok = false;
+        return;
+    }
+
+    if (workerCount <= 0)
+        workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    frames.resize(std::max(buffers, workerCount + 1));
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].pixels.resize((size_t)width * height);
+        freeFrames.push_back((int)i);
+    }
+    for (int i = 0; i < workerCount; i++)
+        workers.emplace_back(&TFrameExporter::WorkerLoop, this);
+}
+
+TFrameExporter::~TFrameExporter()
+{
+    Finish();
+}
+
+/****************************************************************************
+ * Copy the frame into a free buffer and queue it. This is the only work
+ * left on the drawing thread.
+ ***************************************************************************/
+void TFrameExporter::Submit(const SDL_Surface *frame)
+{
+    if (!ok || frame->w != width || frame->h != height)
+        return;
+    std::unique_lock<std::mutex> guard(lock);
+    if (freeFrames.empty()) {
+        uint64_t start = SDL_GetPerformanceCounter();
+        released.wait(guard, [this] { return !freeFrames.empty(); });
+        stallMs += (double)(SDL_GetPerformanceCounter() - start) * 1000.0 /
+                   SDL_GetPerformanceFrequency();
+    }
+    int idx = freeFrames.back();
+    freeFrames.pop_back();
+    if (submitted == 0)
+        firstSubmit = SDL_GetPerformanceCounter();
+    TFrame &f = frames[idx];
+    f.number = submitted++;
+    guard.unlock();
+
+    const auto *src = static_cast<const uint8_t *>(frame->pixels);
+    for (int y = 0; y < height; y++)
+        memcpy(&f.pixels[(size_t)y * width], src + (size_t)y * frame->pitch, width * 4);
+
+    guard.lock();
+    queued.push_back(idx);
+    work.notify_one();
+}
+
+void TFrameExporter::Finish()
+{
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        released.wait(guard, [this] { return queued.empty() && nextToWrite >= submitted; });
+        stopping = true;
+    }
+    work.notify_all();
+    for (std::thread &t : workers)
+        t.join();
+    workers.clear();
+    if (out != nullptr && out != stdout) {
+        if (outIsPipe)
+            pclose(out);
+        else
+            fclose(out);
+    } else if (out == stdout) {
+        fflush(stdout);
+    }
+    out = nullptr;
+}
+
+double TFrameExporter::FramesPerSecond() const
+{
+    if (written == 0 || lastWrite <= firstSubmit)
+        return 0;
+    return written / ((double)(lastWrite - firstSubmit) / SDL_GetPerformanceFrequency());
+}
+
+/****************************************************************************
+ * Convert and write one frame. PNG files are independent and are written
+ * as soon as they are compressed; raw video waits for its turn.
+ ***************************************************************************/
+bool TFrameExporter::WriteFrame(const TFrame &frame, std::vector<uint8_t> &yuv)
+{
+    if (format == EXPORT_PNG) {
+        char name[512];
+        snprintf(name, sizeof(name), target.c_str(), (int)frame.number);
+        SDL_Surface *s = SDL_CreateRGBSurfaceWithFormatFrom(
+            (void *)frame.pixels.data(), width, height, 32, width * 4, SDL_PIXELFORMAT_ARGB8888);
+        bool saved = s != nullptr && IMG_SavePNG(s, name) == 0;
+        SDL_FreeSurface(s);
+        std::lock_guard<std::mutex> guard(lock);
+        nextToWrite++;
+        return saved;
+    }
+
+    // I420: full size luma, then quarter size U and V, BT.601 studio range
+    const int cw = width / 2, ch = height / 2;
+    yuv.resize((size_t)width * height + 2 * (size_t)cw * ch);
+    uint8_t *yp = yuv.data();
+    uint8_t *up = yp + (size_t)width * height;
+    uint8_t *vp = up + (size_t)cw * ch;
+    for (int y = 0; y < height; y++) {
+        const uint32_t *row = &frame.pixels[(size_t)y * width];
+        for (int x = 0; x < width; x++) {
+            int r = (row[x] >> 16) & 0xFF, g = (row[x] >> 8) & 0xFF, b = row[x] & 0xFF;
+            yp[(size_t)y * width + x] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+    for (int y = 0; y < ch; y++) {
+        const uint32_t *row0 = &frame.pixels[(size_t)(2 * y) * width];
+        const uint32_t *row1 = row0 + width;
+        for (int x = 0; x < cw; x++) {
+            uint32_t p[4] = {row0[2 * x], row0[2 * x + 1], row1[2 * x], row1[2 * x + 1]};
+            int r = 0, g = 0, b = 0;
+            for (uint32_t c : p) {
+                r += (c >> 16) & 0xFF;
+                g += (c >> 8) & 0xFF;
+                b += c & 0xFF;
+            }
+            r /= 4; g /= 4; b /= 4;
+            up[(size_t)y * cw + x] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vp[(size_t)y * cw + x] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        released.wait(guard, [&] { return nextToWrite == frame.number; });
+    }
+    // Only this frame's turn may write, so the stream needs no lock; a slow
+    // encoder then holds up the other workers but never Submit()
+    bool saved = fwrite(yuv.data(), 1, yuv.size(), out) == yuv.size();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        nextToWrite++;
+    }
+    released.notify_all();
+    return saved;
+}
+
+void TFrameExporter::WorkerLoop()
+{
+    std::vector<uint8_t> yuv;
+    for (;;) {
+        int idx;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            work.wait(guard, [this] { return stopping || !queued.empty(); });
+            if (queued.empty())
+                return;
+            idx = queued.front();
+            queued.pop_front();
+        }
+        bool saved = WriteFrame(frames[idx], yuv);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (saved)
+                written++;
+            else
+                ok = false;
+            lastWrite = SDL_GetPerformanceCounter();
+            freeFrames.push_back(idx);
+        }
+        released.notify_all();
+    }
+} // WorkerLoop
@@ -0,0 +1,82 @@
+//
+// Asynchronous export of rendered frames as PNG files or raw video.
+//
+
+#ifndef TANKS2_FRAMEEXPORT_H
+#define TANKS2_FRAMEEXPORT_H
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum TExportFormat { EXPORT_PNG, EXPORT_YUV };
+
+/****************************************************************************
+ * Frames handed to Submit() are copied into one of a fixed set of buffers
+ * and converted and written by worker threads, so drawing the next frame
+ * goes on while earlier ones are compressed. Submit() only waits when
+ * every buffer is still queued.
+ *
+ * EXPORT_PNG - One file per frame. The target is a printf pattern such as
+ *              "frames/tank%05d.png"; without one the number is put
+ *              before ".png".
+ * EXPORT_YUV - Raw I420 frames, in order, to a file, to stdout ("-") or
+ *              to a command ("|ffmpeg -f rawvideo -pix_fmt yuv420p ...").
+ ***************************************************************************/
+class TFrameExporter {
+public:
+    TFrameExporter(TExportFormat format, const std::string &target, int width, int height,
+                   int workers = 0, int buffers = 8);
+    ~TFrameExporter();
+    TFrameExporter(const TFrameExporter &) = delete;
+    TFrameExporter &operator=(const TFrameExporter &) = delete;
+
+    bool Ok() const { return ok; }
+    // frame must be width x height, SDL_PIXELFORMAT_ARGB8888
+    void Submit(const SDL_Surface *frame);
+    // Wait for every submitted frame to be written
+    void Finish();
+
+    long FramesWritten() const { return written; }
+    double FramesPerSecond() const;
+    double StallMs() const { return stallMs; } // Time Submit() spent waiting
+
+private:
+    struct TFrame {
+        std::vector<uint32_t> pixels;
+        long number = 0;
+    };
+
+    void WorkerLoop();
+    bool WriteFrame(const TFrame &frame, std::vector<uint8_t> &yuv);
+
+    TExportFormat format;
+    std::string target;
+    int width, height;
+    bool ok = true;
+    FILE *out = nullptr;
+    bool outIsPipe = false;
+
+    std::vector<TFrame> frames;
+    std::vector<int> freeFrames;
+    std::deque<int> queued;
+    std::mutex lock;
+    std::condition_variable work;     // A frame was queued, or stopping
+    std::condition_variable released; // A buffer is free, or a frame written
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    long submitted = 0;
+    long nextToWrite = 0; // Keeps raw video in order
+    long written = 0;
+    double stallMs = 0;
+    uint64_t firstSubmit = 0, lastWrite = 0;
+};
+
+#endif //TANKS2_FRAMEEXPORT_H
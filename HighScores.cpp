@@ -0,0 +1,181 @@
+//
+// The table of best scores and the file it is kept in.
+//
+
+#include "HighScores.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Snapshot.h"
+
+const uint32_t HIGH_SCORE_VERSION = 1;
+
+// The file, byte for byte
+struct THighScoreFile {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    THighScore entries[HIGH_SCORE_SLOTS];
+    uint64_t checksum; // SnapshotHash of everything before it
+};
+static_assert(sizeof(THighScoreFile) == 16 + HIGH_SCORE_SLOTS * 24 + 8,
+              "THighScoreFile must have no padding");
+
+static uint64_t Checksum(const THighScoreFile &file)
+{
+    return SnapshotHash(reinterpret_cast<const uint8_t *>(&file), offsetof(THighScoreFile, checksum));
+}
+
+static bool ReadTable(const std::string &fileName, THighScoreFile &file)
+{
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+    const bool whole = fread(&file, sizeof(file), 1, f) == 1;
+    fclose(f);
+    return whole && memcmp(file.magic, "TKHS", 4) == 0 && file.version == HIGH_SCORE_VERSION &&
+           file.count <= (uint32_t)HIGH_SCORE_SLOTS && file.checksum == Checksum(file);
+}
+
+/****************************************************************************
+ * Replace the file in one step: the new table goes to a temporary file,
+ * reaches the disk, and only then takes the old one's name. The directory
+ * is flushed as well so that the rename itself survives a crash.
+ ***************************************************************************/
+static bool WriteTable(const std::string &fileName, const THighScoreFile &file)
+{
+    const std::string temp = fileName + ".tmp";
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (f == nullptr)
+        return false;
+    bool ok = fwrite(&file, sizeof(file), 1, f) == 1;
+    ok = fflush(f) == 0 && ok;
+    ok = fsync(fileno(f)) == 0 && ok;
+    ok = fclose(f) == 0 && ok;
+    if (ok)
+        ok = rename(temp.c_str(), fileName.c_str()) == 0;
+    if (!ok) {
+        remove(temp.c_str());
+        return false;
+    }
+    const size_t slash = fileName.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : fileName.substr(0, slash + 1);
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+}
+
+THighScores::THighScores(std::string fileName)
+    : fileName(std::move(fileName)), worker(&THighScores::Run, this)
+{
+}
+
+THighScores::~THighScores()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+int THighScores::Count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+THighScore THighScores::At(int rank) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return rank >= 0 && rank < count ? entries[rank] : THighScore{};
+}
+
+bool THighScores::Qualifies(double score) const
+{
+    const int32_t tenths = (int32_t)std::lround(score * 10);
+    std::lock_guard<std::mutex> lock(mutex);
+    return tenths > 0 && (count < HIGH_SCORE_SLOTS || tenths > entries[count - 1].tenths);
+}
+
+int THighScores::Add(const char *name, double score)
+{
+    THighScore entry = {};
+    snprintf(entry.name, sizeof(entry.name), "%s", name);
+    entry.tenths = (int32_t)std::lround(score * 10);
+    entry.time = (uint32_t)time(nullptr);
+    int rank;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rank = Insert(entry);
+        dirty = dirty || rank >= 0;
+    }
+    if (rank >= 0)
+        wake.notify_one();
+    return rank;
+}
+
+// Below every entry with at least the same score, so older ones win ties
+int THighScores::Insert(const THighScore &entry)
+{
+    if (entry.tenths <= 0)
+        return -1;
+    int rank = 0;
+    while (rank < count && entries[rank].tenths >= entry.tenths)
+        rank++;
+    if (rank == HIGH_SCORE_SLOTS)
+        return -1;
+    const int moved = (count < HIGH_SCORE_SLOTS ? count : HIGH_SCORE_SLOTS - 1) - rank;
+    memmove(&entries[rank + 1], &entries[rank], moved * sizeof(THighScore));
+    entries[rank] = entry;
+    if (count < HIGH_SCORE_SLOTS)
+        count++;
+    return rank;
+}
+
+/****************************************************************************
+ * The file thread: load once, then write whenever the table has changed.
+ * The lock is only held to copy the table, never during file access.
+ ***************************************************************************/
+void THighScores::Run()
+{
+    THighScoreFile file;
+    if (ReadTable(fileName, file)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i = 0; i < file.count; i++) {
+            file.entries[i].name[HIGH_SCORE_NAME - 1] = 0;
+            Insert(file.entries[i]);
+        }
+    } else if (FILE *f = fopen(fileName.c_str(), "rb")) {
+        fclose(f);
+        failures++; // There, but not a table we can use; replaced on the next write
+    }
+    loaded = true;
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return dirty || quit; });
+        if (!dirty)
+            return;
+        dirty = false;
+        memset(&file, 0, sizeof(file));
+        memcpy(file.magic, "TKHS", 4);
+        file.version = HIGH_SCORE_VERSION;
+        file.count = (uint32_t)count;
+        memcpy(file.entries, entries, sizeof(entries));
+        lock.unlock();
+
+        file.checksum = Checksum(file);
+        if (!WriteTable(fileName, file))
+            failures++;
+    }
+}
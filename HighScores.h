@@ -0,0 +1,73 @@
+//
+// The table of best scores and the file it is kept in.
+//
+
+#ifndef TANKS2_HIGHSCORES_H
+#define TANKS2_HIGHSCORES_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+const int HIGH_SCORE_SLOTS = 10;
+const int HIGH_SCORE_NAME = 16; // Including the terminating zero
+
+struct THighScore {
+    char name[HIGH_SCORE_NAME];
+    int32_t tenths; // Score times ten, as shown with one decimal
+    uint32_t time;  // Unix time it was set
+};
+
+/****************************************************************************
+ * The ten best scores, best first. The table has a fixed size, so every
+ * query is constant time.
+ *
+ * All file work happens on a thread of its own. It loads the file as soon
+ * as the table is made and writes it again after every new entry, so
+ * neither a slow disk nor a failing one can hold up the caller. Scores
+ * added before loading has finished are merged with the file.
+ *
+ * The file holds the whole table at a fixed size with a checksum. It is
+ * written to a temporary file, flushed to disk and renamed over the old
+ * one, so a crash leaves either the old table or the new one. A file that
+ * is missing, short or fails its checksum counts as an empty table.
+ ***************************************************************************/
+class THighScores {
+public:
+    explicit THighScores(std::string fileName);
+    // Waits for the last write to finish
+    ~THighScores();
+    THighScores(const THighScores &) = delete;
+    THighScores &operator=(const THighScores &) = delete;
+
+    bool Loaded() const { return loaded; }
+    int Count() const;
+    THighScore At(int rank) const;
+    // Would the score make it into the table
+    bool Qualifies(double score) const;
+    // Enter a score. Returns its rank from 0, or -1 when it is not good
+    // enough. The file is written in the background.
+    int Add(const char *name, double score);
+    // Reads and writes that failed so far
+    int Failures() const { return failures; }
+
+private:
+    int Insert(const THighScore &entry); // With the lock held
+    void Run();
+
+    const std::string fileName;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    THighScore entries[HIGH_SCORE_SLOTS] = {};
+    int count = 0;
+    bool dirty = false; // Changed since the last write
+    bool quit = false;
+    std::atomic<bool> loaded{false};
+    std::atomic<int> failures{0};
+    std::thread worker; // Last, so it starts after everything it uses
+};
+
+#endif //TANKS2_HIGHSCORES_H
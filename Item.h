@@ -5,10 +5,16 @@
 #ifndef TANKS2_ITEM_H
 #define TANKS2_ITEM_H
 
+#include "Memory.h"
+
 struct TItemRec {
     int x, y, screen;
     int directionIdx, color;
-    int dist;
+    int dist;    // Bullets: distance flown
+    uint32_t ai; // Red tanks: TSquadMemory, see Squad.h
 };
 
+// Entity list of a world, counted as world memory
+using TItemList = TTagVector<TItemRec, MEM_WORLD>;
+
 #endif //TANKS2_ITEM_H
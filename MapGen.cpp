@@ -0,0 +1,300 @@
+//
+// Seeded procedural maps of any number of screens.
+//
+
+#include "MapGen.h"
+#include "Match.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+const int RED_PER_SCREEN = 2;
+const int DOOR_ROWS = 5;     // Height of a door in the left or right wall, in tiles
+const int DOOR_COLS = 4;     // Width of a door in the top or bottom wall
+const int TANK_TILES = 3;    // Tiles a tank covers in each direction
+const int MAX_ATTEMPTS = 16; // Layouts tried before a screen is left open
+
+/****************************************************************************
+ * Small hash based generator. Every screen and every door has its own
+ * stream, so the result does not depend on the order screens are built in.
+ ***************************************************************************/
+struct TMapRand {
+    uint64_t state;
+
+    TMapRand(uint32_t seed, uint32_t a, uint32_t b)
+        : state(((uint64_t)seed << 32) ^ ((uint64_t)a * 0x9E3779B97F4A7C15ull) ^ (b + 1)) {}
+
+    uint32_t Next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return (uint32_t)(z ^ (z >> 31));
+    }
+    int Range(int lo, int hi) { return hi <= lo ? lo : lo + (int)(Next() % (uint32_t)(hi - lo + 1)); }
+};
+
+struct TScreenOut {
+    std::vector<TItemRec> blocks, trees, tanks;
+};
+
+/****************************************************************************
+ * Builds one screen on a grid of wall sized tiles.
+ ***************************************************************************/
+class TScreenGen {
+public:
+    TScreenGen(int cols, int rows, int gw, int gh, uint32_t seed)
+        : cols(cols), rows(rows), gw(gw), gh(gh), seed(seed),
+          solid((size_t)gw * gh), reach((size_t)gw * gh) {}
+
+    void Build(int screen, TScreenOut &out);
+
+private:
+    struct TCell { int c, r; };
+
+    bool Solid(int c, int r) const { return solid[(size_t)r * gw + c] != 0; }
+    bool TankFits(int c, int r) const;
+    int DoorStart(int edge, bool vertical) const;
+    void Layout(int screen, int attempt, bool interior);
+    bool Connected() const;
+
+    const int cols, rows, gw, gh;
+    const uint32_t seed;
+    std::vector<uint8_t> solid;
+    mutable std::vector<uint8_t> reach;
+    mutable std::vector<TCell> stack;
+    std::vector<TCell> doors, spawns;
+    std::vector<int> spawnDirs;
+};
+
+bool TScreenGen::TankFits(int c, int r) const
+{
+    if (c < 0 || r < 0 || c + TANK_TILES > gw || r + TANK_TILES > gh)
+        return false;
+    for (int y = r; y < r + TANK_TILES; y++)
+        for (int x = c; x < c + TANK_TILES; x++)
+            if (Solid(x, y))
+                return false;
+    return true;
+}
+
+/****************************************************************************
+ * First tile of the door on a shared edge. Both screens beside the edge
+ * work it out from the edge number, so the gaps line up.
+ ***************************************************************************/
+int TScreenGen::DoorStart(int edge, bool vertical) const
+{
+    TMapRand rnd(seed, 0x0D00, (uint32_t)edge);
+    return vertical ? rnd.Range(2, gh - 3 - DOOR_ROWS) : rnd.Range(2, gw - 3 - DOOR_COLS);
+}
+
+void TScreenGen::Layout(int screen, int attempt, bool interior)
+{
+    const int col = screen % cols, row = screen / cols;
+    std::fill(solid.begin(), solid.end(), 0);
+    doors.clear();
+    spawns.clear();
+    spawnDirs.clear();
+
+    for (int c = 0; c < gw; c++)
+        solid[c] = solid[(size_t)(gh - 1) * gw + c] = 1;
+    for (int r = 0; r < gh; r++)
+        solid[(size_t)r * gw] = solid[(size_t)r * gw + gw - 1] = 1;
+
+    // Doors: left/right edges are numbered 2 * screen on the left screen,
+    // top/bottom edges 2 * screen + 1 on the upper screen
+    auto openVertical = [&](int edge, int c, int entryC) {
+        int d = DoorStart(edge, true);
+        for (int r = d; r < d + DOOR_ROWS; r++)
+            solid[(size_t)r * gw + c] = 0;
+        doors.push_back({entryC, d + (DOOR_ROWS - TANK_TILES) / 2});
+    };
+    auto openHorizontal = [&](int edge, int r, int entryR) {
+        int d = DoorStart(edge, false);
+        for (int c = d; c < d + DOOR_COLS; c++)
+            solid[(size_t)r * gw + c] = 0;
+        doors.push_back({d + (DOOR_COLS - TANK_TILES) / 2, entryR});
+    };
+    if (col > 0)
+        openVertical(2 * (screen - 1), 0, 0);
+    if (col + 1 < cols)
+        openVertical(2 * screen, gw - 1, gw - TANK_TILES);
+    if (row > 0)
+        openHorizontal(2 * (screen - cols) + 1, 0, 0);
+    if (row + 1 < rows)
+        openHorizontal(2 * screen + 1, gh - 1, gh - TANK_TILES);
+
+    TMapRand rnd(seed, (uint32_t)screen, (uint32_t)attempt);
+    if (interior) {
+        int walls = rnd.Range(6, 12);
+        for (int i = 0; i < walls; i++) {
+            int len = rnd.Range(4, 16);
+            bool across = rnd.Next() & 1;
+            int c = rnd.Range(TANK_TILES + 1, gw - TANK_TILES - 2);
+            int r = rnd.Range(TANK_TILES + 1, gh - TANK_TILES - 2);
+            for (int k = 0; k < len; k++) {
+                int x = across ? c + k : c;
+                int y = across ? r : r + k;
+                if (x > TANK_TILES && x < gw - 1 - TANK_TILES && y > TANK_TILES && y < gh - 1 - TANK_TILES)
+                    solid[(size_t)y * gw + x] = 1;
+            }
+        }
+    }
+
+    // Blue tank in the top left of screen 0, as on the hand-made map
+    int tanks = RED_PER_SCREEN + (screen == 0 ? 1 : 0);
+    for (int t = 0; t < tanks; t++) {
+        for (int tries = 0; tries < 64; tries++) {
+            int c = (screen == 0 && t == 0) ? 2 + tries % 8 : rnd.Range(2, gw - 2 - TANK_TILES);
+            int r = (screen == 0 && t == 0) ? 2 + tries / 8 : rnd.Range(2, gh - 2 - TANK_TILES);
+            bool clash = !TankFits(c, r);
+            for (const TCell &s : spawns)
+                clash = clash || (abs(s.c - c) < TANK_TILES + 1 && abs(s.r - r) < TANK_TILES + 1);
+            if (!clash) {
+                spawns.push_back({c, r});
+                spawnDirs.push_back(screen == 0 && t == 0 ? 4 : rnd.Range(0, DIR_COUNT - 1));
+                break;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+ * Flood fill over the places a tank fits, from the first spawn or door.
+ * True when every spawn and door was reached and every tank was placed.
+ ***************************************************************************/
+bool TScreenGen::Connected() const
+{
+    std::vector<TCell> targets = spawns;
+    targets.insert(targets.end(), doors.begin(), doors.end());
+    if (targets.empty())
+        return true;
+
+    std::fill(reach.begin(), reach.end(), 0);
+    stack.clear();
+    stack.push_back(targets[0]);
+    reach[(size_t)targets[0].r * gw + targets[0].c] = 1;
+    while (!stack.empty()) {
+        TCell p = stack.back();
+        stack.pop_back();
+        const TCell next[4] = {{p.c + 1, p.r}, {p.c - 1, p.r}, {p.c, p.r + 1}, {p.c, p.r - 1}};
+        for (const TCell &n : next) {
+            if (TankFits(n.c, n.r) && !reach[(size_t)n.r * gw + n.c]) {
+                reach[(size_t)n.r * gw + n.c] = 1;
+                stack.push_back(n);
+            }
+        }
+    }
+    for (const TCell &t : targets)
+        if (!reach[(size_t)t.r * gw + t.c])
+            return false;
+    return true;
+}
+
+void TScreenGen::Build(int screen, TScreenOut &out)
+{
+    const int wanted = RED_PER_SCREEN + (screen == 0 ? 1 : 0);
+    bool ok = false;
+    for (int attempt = 0; attempt < MAX_ATTEMPTS && !ok; attempt++) {
+        Layout(screen, attempt, true);
+        ok = (int)spawns.size() == wanted && Connected();
+    }
+    if (!ok)
+        Layout(screen, MAX_ATTEMPTS, false); // Border and doors only, always open
+
+    out.blocks.clear();
+    for (int r = 0; r < gh; r++)
+        for (int c = 0; c < gw; c++)
+            if (Solid(c, r))
+                out.blocks.push_back({c * blockWidth, r * blockHeight, screen, 0, 0, 0});
+
+    out.tanks.clear();
+    for (size_t t = 0; t < spawns.size(); t++) {
+        int color = (screen == 0 && t == 0) ? BlueTank : RedTank;
+        out.tanks.push_back({spawns[t].c * blockWidth, spawns[t].r * blockHeight, screen,
+                             spawnDirs[t], color, 0});
+    }
+
+    out.trees.clear();
+    TMapRand rnd(seed, (uint32_t)screen, 0x7EE5);
+    int clusters = rnd.Range(1, 3);
+    for (int i = 0; i < clusters; i++) {
+        int cx = rnd.Range(treeWidth, gw * blockWidth - 2 * treeWidth);
+        int cy = rnd.Range(treeHeight, gh * blockHeight - 2 * treeHeight);
+        int trees = rnd.Range(2, 4);
+        for (int k = 0; k < trees; k++)
+            out.trees.push_back({cx + rnd.Range(-treeWidth, treeWidth),
+                                 cy + rnd.Range(-treeHeight, treeHeight), screen, 0, 0, 0});
+    }
+} // Build
+
+void GenerateMap(Match &match, int cols, int rows, uint32_t seed, TThreadPool *pool)
+{
+    cols = std::max(cols, 1);
+    rows = std::max(rows, 1);
+    if (seed == 0)
+        seed = 1; // 0 stands for the hand-made map
+    const int screens = cols * rows;
+    const int gw = match.width / blockWidth;
+    const int gh = match.height / blockHeight;
+
+    std::vector<TScreenOut> outs(screens);
+    auto build = [&](int first, int last) {
+        TScreenGen gen(cols, rows, gw, gh, seed);
+        for (int s = first; s < last; s++)
+            gen.Build(s, outs[s]);
+    };
+    const int chunk = 16; // Screens per task, so the scratch grids are reused
+    const int tasks = (screens + chunk - 1) / chunk;
+    if (pool != nullptr)
+        pool->ParallelFor(tasks, [&](int t) { build(t * chunk, std::min(screens, (t + 1) * chunk)); });
+    else
+        build(0, screens);
+
+    match.bulletList.clear();
+    match.bullets.Clear();
+    match.explosionList.clear();
+    match.tanksList.clear();
+    match.blocksList.clear();
+    match.treeList.clear();
+    size_t blocks = 0, trees = 0, tanks = 0;
+    for (const TScreenOut &o : outs) {
+        blocks += o.blocks.size();
+        trees += o.trees.size();
+        tanks += o.tanks.size();
+    }
+    match.blocksList.reserve(blocks);
+    match.treeList.reserve(trees);
+    match.tanksList.reserve(tanks);
+    int red = 0;
+    for (const TScreenOut &o : outs) {
+        match.blocksList.insert(match.blocksList.end(), o.blocks.begin(), o.blocks.end());
+        match.treeList.insert(match.treeList.end(), o.trees.begin(), o.trees.end());
+        match.tanksList.insert(match.tanksList.end(), o.tanks.begin(), o.tanks.end());
+        for (const TItemRec &t : o.tanks)
+            red += t.color == RedTank;
+    }
+
+    match.screenCols = cols;
+    match.screenRows = rows;
+    match.mapCols = cols;
+    match.mapRows = rows;
+    match.mapSeed = seed;
+    match.curScrn = 0;
+    match.blueCount = 1;
+    match.redCount = red;
+    match.leftCnt = 0;
+    match.rightCnt = 0;
+    match.score = 1000.0;
+    match.RebuildWalls();
+} // GenerateMap
+
+bool ParseMapSize(const char *text, int &cols, int &rows, uint32_t &seed)
+{
+    unsigned s = 1;
+    int n = sscanf(text, "%dx%d:%u", &cols, &rows, &s);
+    seed = s;
+    return n >= 2 && cols > 0 && rows > 0;
+}
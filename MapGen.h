@@ -0,0 +1,32 @@
+//
+// Seeded procedural maps of any number of screens.
+//
+
+#ifndef TANKS2_MAPGEN_H
+#define TANKS2_MAPGEN_H
+
+#include <cstdint>
+
+class Match;
+class TThreadPool;
+
+/****************************************************************************
+ * Replace the match's screens with a generated map of cols x rows screens:
+ * border walls with door gaps to the neighbouring screens, random interior
+ * walls, clusters of trees and two red tanks per screen. The blue tank
+ * starts on screen 0.
+ *
+ * Each screen is checked with a flood fill over the wall grid: every spawn
+ * point and every door must be reachable by a tank from the others. A
+ * screen that fails is generated again with a new layout.
+ *
+ * The result depends only on the seed and the map size, not on the number
+ * of threads. With a pool the screens are generated in parallel. The map
+ * is remembered in the match, so InitLists() builds it again.
+ ***************************************************************************/
+void GenerateMap(Match &match, int cols, int rows, uint32_t seed, TThreadPool *pool = nullptr);
+
+// Read a map size given as "COLSxROWS" or "COLSxROWS:SEED" (seed 1 if left out)
+bool ParseMapSize(const char *text, int &cols, int &rows, uint32_t &seed);
+
+#endif //TANKS2_MAPGEN_H
@@ -0,0 +1,1118 @@
+//
+// One independent game: world state plus the rules that advance it.
+//
+
+#include "Match.h"
+#include "MapGen.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cstdlib>
+
+/****************************************************************************
+* Create a match with its screens set up.
+* Parameters:
+*   seed, Random seed; matches with the same seed and inputs play the same.
+****************************************************************************/
+Match::Match(uint32_t seed)
+{
+    rngState = seed;
+    InitLists();
+}
+
+/******************************************************************************
+* Clear all lists and counters. Reset the screens
+******************************************************************************/
+void Match::InitLists()
+{
+    if (mapSeed != 0) {
+        GenerateMap(*this, mapCols, mapRows, mapSeed);
+        return;
+    }
+    explosionList.clear();
+    bulletList.clear();
+    bullets.Clear();
+    tanksList.clear();
+    blocksList.clear();
+    treeList.clear();
+    blueCount = 1;
+    redCount  = 8;
+    score = 1000.0;
+    screenCols = 2;
+    screenRows = 2;
+    InitScrn1();
+    InitScrn2();
+    InitScrn3();
+    InitScrn4();
+    RebuildWalls();
+}
+
+/******************************************************************************
+* Bucket the tanks for collision tests and note the blue ones.
+******************************************************************************/
+void Match::BuildTankGrid()
+{
+    tankGrid.Build(tanksList, ScreenCount(), width, height, tankWidth, tankHeight);
+    blueTanks.clear();
+    for (int i = 0; i < (int)tanksList.size(); i++)
+        if (tanksList[i].color == BlueTank)
+            blueTanks.push_back(i);
+}
+
+/******************************************************************************
+* Bring the wall grid up to date with blocksList.
+******************************************************************************/
+void Match::RebuildWalls()
+{
+    walls.Build(blocksList, ScreenCount(), width, height, blockWidth, blockHeight);
+    wallsVersion++;
+}
+
+/******************************************************************************
+* Procedure: InitScrn1;
+* Parameters: None
+* This function initializes screen [0], the top left game screen.
+*     ||
+* [0] ||  1
+* ==========
+*  2  ||  3
+*     ||
+******************************************************************************/
+void Match::InitScrn1()
+{
+    const int boxTop = 110;
+    const int boxLeft = 90;
+    const int boxH = 20; // blocks high
+    const int boxW = 20; // blocks wide
+    const int scrNo = 0;
+
+    TItemRec *TnkPtr;
+    TItemRec *ptRec;
+
+    int w = blockWidth;
+    int h = blockHeight;
+    int gate_y1 = (height / 4) + (blockHeight / 2);
+    int gate_y2 = gate_y1 * 2;
+    int gate_x1 = (width / 4) + (blockWidth / 2);
+    int gate_x2 = gate_x1 * 2;
+
+    int i = w;
+
+    blocksList.clear();
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = i;
+        ptRec->y = 0;
+        ptRec->screen = scrNo;
+        if((i < gate_x1) ||(i >= gate_x2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = i;
+            ptRec->y = height - h;
+            ptRec->screen = scrNo;
+        }
+        i = i + w;
+    } while( i < (width - w));
+
+    i = 0;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = 0;
+        ptRec->y = i;
+        ptRec->screen = scrNo;
+        if((i < gate_y1) || (i >= gate_y2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = width - w;
+            ptRec->y = i;
+            ptRec->screen = scrNo;
+        }
+        i = i + h;
+    } while( i < (height - h));
+
+    int x = boxLeft;
+    int y = boxTop;
+    for(i = 0; i < boxW; i++)
+    {
+        //top
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        // bottom
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = boxTop + (boxH * h);
+        ptRec->screen = scrNo;
+        x = x + w;
+    } // next i
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 4;
+    TnkPtr->color = BlueTank; // Good guy
+    TnkPtr->x = 20;
+    TnkPtr->y = 20;
+    TnkPtr->screen = scrNo;
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 4;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = 150;
+    TnkPtr->y = 30;
+    TnkPtr->screen = scrNo;
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 2;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = 160;
+    TnkPtr->y = 200;
+    TnkPtr->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 140;
+    ptRec->y = height / 2;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 60;
+    ptRec->y = (height / 2) + 110;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 50;
+    ptRec->y = (height / 2) - 220;
+    ptRec->screen = scrNo;
+    //*********************************************
+} // InitScrn1
+
+/******************************************************************************
+* Procedure: InitScrn2;
+* Parameters: None
+* This function initializes screen [1], the top right game screen.
+*     ||
+*  0  || [1]
+* ==========
+*  2  ||  3
+*     ||
+******************************************************************************/
+void Match::InitScrn2()
+{
+    const int boxTop = 110;
+    const int boxLeft = 90;
+    const int boxH = 20; // blocks high
+    const int boxW = 20; // blocks wide
+    const int scrNo = 1;
+
+    TItemRec *TnkPtr;
+    TItemRec *ptRec;
+
+    int w = blockWidth;
+    int h = blockHeight;
+    int gate_y1 = (height / 4) + (blockHeight / 2);
+    int gate_y2 = gate_y1 * 2;
+    int gate_x1 = (width / 4) + (blockWidth / 2);
+    int gate_x2 = gate_x1 * 2;
+
+    int i = w;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = i;
+        ptRec->y = 0;
+        ptRec->screen = scrNo;
+        if((i < gate_x1) ||(i >= gate_x2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = i;
+            ptRec->y = height - h;
+            ptRec->screen = scrNo;
+        }
+        i = i + w;
+    } while( i < (width - w));
+
+    i = 0;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = width - w;
+        ptRec->y = i;
+        ptRec->screen = scrNo;
+        if((i < gate_y1) || (i >= gate_y2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = 0;
+            ptRec->y = i;
+            ptRec->screen = scrNo;
+        }
+        i = i + h;
+    } while( i < (height - h));
+
+    int x = boxLeft;
+    int y = boxTop;
+    for(i = 0; i < boxW; i++)
+    {
+        //top
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        // bottom
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x + (boxW * w);
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        y = y + h;
+    } // next i
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 4;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = width - 40;
+    TnkPtr->y = 30;
+    TnkPtr->screen = scrNo;
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 2;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = 160;
+    TnkPtr->y = 200;
+    TnkPtr->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 40;
+    ptRec->y = height / 2;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 60;
+    ptRec->y = (height / 2) + 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 50;
+    ptRec->y = (height / 2) + 15;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 4) - 20;
+    ptRec->y = (height / 4) + 20;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 3) - 60;
+    ptRec->y = (height / 4) + 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 3) - 50;
+    ptRec->y = (height / 4) + 15;
+    ptRec->screen = scrNo;
+    //***********************************************}
+} // void InitScrn2()
+
+/******************************************************************************
+* Procedure: InitScrn3;
+* Parameters: None
+* This function initializes screen[2], the bottom left game screen.
+*
+*     ||
+*  0  ||  1
+* ==========
+* [2] ||  3
+*     ||
+******************************************************************************/
+void Match::InitScrn3()
+{
+    const int boxTop = 115;
+    const int boxLeft = 90;
+    const int boxH = 18; // blocks high
+    const int boxW = 22; // blocks wide
+    const int scrNo = 2;
+
+    TItemRec *TnkPtr;
+    TItemRec *ptRec;
+
+    int w = blockWidth;
+    int h = blockHeight;
+    int gate_y1 = (height / 4) + (blockHeight / 2);
+    int gate_y2 = gate_y1 * 2;
+    int gate_x1 = (width / 4) + (blockWidth / 2);
+    int gate_x2 = gate_x1 * 2;
+
+    int i = w;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = i;
+        ptRec->y = height - h;
+        ptRec->screen = scrNo;
+        if((i < gate_x1) ||(i >= gate_x2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = i;
+            ptRec->y = 0;
+            ptRec->screen = scrNo;
+        }
+        i = i + w;
+    } while( i < (width - w));
+
+    i = 0;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = 0;
+        ptRec->y = i;
+        ptRec->screen = scrNo;
+        if((i < gate_y1) || (i >= gate_y2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = width - w;
+            ptRec->y = i;
+            ptRec->screen = scrNo;
+        }
+        i = i + h;
+    } while( i < (height - h));
+
+    int x = boxLeft;
+    int y = boxTop;
+    for(i = 0; i < boxW; i++)
+    {
+        //top
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        // bottom
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x + (boxW * w);
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        y = y + h;
+    } // next i
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 4;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = width - 40;
+    TnkPtr->y = 30;
+    TnkPtr->screen = scrNo;
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 2;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = 160;
+    TnkPtr->y = height - 60;
+    TnkPtr->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 45;
+    ptRec->y = (height / 2) - 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 60;
+    ptRec->y = (height / 2) + 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 50;
+    ptRec->y = (height / 2) + 15;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 4) - 20;
+    ptRec->y = (height / 4) + 20;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 3) - 60;
+    ptRec->y = (height / 4) + 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 3) - 50;
+    ptRec->y = (height / 4) + 15;
+    ptRec->screen = scrNo;
+    //***********************************************}
+} // InitScrn3()
+
+/******************************************************************************
+* Procedure: InitScrn4;
+* Parameters: None
+* This function initializes screen [3], the bottom right game screen.
+*
+*     ||
+*  0  ||  1
+* ==========
+*  2  || [3]
+*     ||
+******************************************************************************/
+void Match::InitScrn4()
+{
+    const int boxTop = 110;
+    const int boxLeft = 110;
+    const int boxH = 18; // blocks high
+    const int boxW = 18; // blocks wide
+    const int scrNo = 3;
+
+    TItemRec *TnkPtr;
+    TItemRec *ptRec;
+
+    int w = blockWidth;
+    int h = blockHeight;
+    int gate_y1 = (height / 4) + (h / 2);
+    int gate_y2 = gate_y1 * 2;
+    int gate_x1 = (width / 4) + (w / 2);
+    int gate_x2 = gate_x1 * 2;
+
+    int i = w;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = i;
+        ptRec->y = height - h;
+        ptRec->screen = scrNo;
+        if((i < gate_x1) ||(i >= gate_x2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = i;
+            ptRec->y = 0;
+            ptRec->screen = scrNo;
+        }
+        i = i + w;
+    } while( i < (width - w));
+
+    i = 0;
+    do{
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = width - w;
+        ptRec->y = i;
+        ptRec->screen = scrNo;
+        if((i < gate_y1) || (i >= gate_y2))
+        {
+            ptRec = &blocksList.emplace_back();
+            ptRec->x = 0;
+            ptRec->y = i;
+            ptRec->screen = scrNo;
+        }
+        i = i + h;
+    } while( i < (height - h));
+
+    int x = boxLeft;
+    int y = boxTop;
+    for(i = 0; i < boxW; i++)
+    {
+        //top
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        // bottom
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = boxTop + (boxH * h);;
+        ptRec->screen = scrNo;
+        x = x + w;
+    } // next i
+
+    x = boxLeft;
+    for(i = 0; i < boxH; i++)
+    {
+        //top
+        ptRec = &blocksList.emplace_back();
+        ptRec->x = x;
+        ptRec->y = y;
+        ptRec->screen = scrNo;
+        y = y + h;
+    } // next i
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 4;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = width - 40;
+    TnkPtr->y = 30;
+    TnkPtr->screen = scrNo;
+
+    TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 2;
+    TnkPtr->color = RedTank; // Bad guy
+    TnkPtr->x = 160;
+    TnkPtr->y = height - 60;
+    TnkPtr->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 45;
+    ptRec->y = (height / 2) - 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 60;
+    ptRec->y = (height / 2) + 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 2) - 50;
+    ptRec->y = (height / 2) + 15;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 4) - 20;
+    ptRec->y = (height / 4) + 20;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 3) - 60;
+    ptRec->y = (height / 4) + 10;
+    ptRec->screen = scrNo;
+
+    ptRec = &treeList.emplace_back();
+    ptRec->x = (width / 3) - 50;
+    ptRec->y = (height / 4) + 15;
+    ptRec->screen = scrNo;
+    //***********************************************}
+} // InitScrn4()
+
+/******************************************************************************
+* ApplyAction
+* Rotate, move and fire a player's tank.
+* Parameters:
+*   tankIdx, Player tank.
+*   action, Combination of the ACT_ bits.
+******************************************************************************/
+void Match::ApplyAction(int tankIdx, uint8_t action)
+{
+    if (tankIdx < 0 || tankIdx >= (int)tanksList.size() || action == 0)
+        return;
+    TItemRec *tnkPtr = &tanksList[tankIdx];
+    if (tnkPtr->color != BlueTank)
+        return;
+    if (action & ACT_RIGHT) {
+        tnkPtr->directionIdx = tnkPtr->directionIdx + 1;
+        if (tnkPtr->directionIdx >= DIR_COUNT)
+            tnkPtr->directionIdx = 0;
+    }
+    if (action & ACT_LEFT) {
+        tnkPtr->directionIdx = tnkPtr->directionIdx - 1;
+        if (tnkPtr->directionIdx < 0)
+            tnkPtr->directionIdx = DIR_COUNT - 1;
+    }
+    if (action & ACT_FORWARD) {
+        BuildTankGrid();
+        MoveTank(tankIdx, 3);
+    }
+    if (action & ACT_FIRE) {
+        const int bx = tnkPtr->x + ShotStartX[tnkPtr->directionIdx];
+        const int by = tnkPtr->y + ShotStartY[tnkPtr->directionIdx];
+        bullets.Add(bx, by, tnkPtr->screen, tnkPtr->directionIdx, 0);
+        TelemetryEmit(TEL_SHOT, telemetrySource, tick, tankIdx, tnkPtr->screen, bx, by,
+                      tnkPtr->directionIdx);
+    }
+    rightCnt = 0;
+    leftCnt = 0;
+} // ApplyAction
+
+/******************************************************************************
+* AddPlayerTank
+* Add a tank for another player in the top left screen.
+* Parameters:
+*   slot, Player number, 1 to NET_MAX_PLAYERS - 1.
+* Returns: Index of the new tank.
+******************************************************************************/
+int Match::AddPlayerTank(int slot)
+{
+    TItemRec *TnkPtr = &tanksList.emplace_back();
+    TnkPtr->directionIdx = 4;
+    TnkPtr->color = BlueTank;
+    TnkPtr->x = 20;
+    TnkPtr->y = 20 + slot * 48;
+    TnkPtr->screen = 0;
+    blueCount++;
+    return (int)tanksList.size() - 1;
+} // AddPlayerTank
+
+/******************************************************************************
+* Move the bullets one tick and drop those that reached the edge of the
+* screen, in one pass; bullets stay in the order they were fired.
+******************************************************************************/
+void Match::move_bullets() {
+    bullets.Step(width, height);
+}
+
+void Match::animate_explosions() {
+    // Animate explosions
+    for(int i = (int)explosionList.size()-1; i>=0; i--)
+    {
+        TItemRec *ExpRec = &explosionList[i];
+        ExpRec->directionIdx++;
+        if(ExpRec->directionIdx >= EXP_COUNT)
+        {
+            explosionList.erase (explosionList.begin()+i);
+        }
+    }
+}
+
+/****************************************************************************
+* Summary: Update all game objects. Events from the previous tick are
+* discarded, so read them after each call.
+****************************************************************************/
+void Match::UpdateGame()
+{
+    char s[20];
+    //bool done;
+
+    tick++;
+    events.clear();
+    BuildTankGrid();
+    squads.Build(tanksList, ScreenCount(), RedTank);
+    move_bullets();
+    animate_explosions();
+
+    blueCount = 0;
+    redCount = 0;
+    for(int i = tanksList.size()-1; i >= 0; i--)
+    {
+        TItemRec *TnkPtr = &tanksList[i];
+
+        if (TnkPtr->color == DeadTank)
+        {
+             TnkPtr->directionIdx++;
+             if(TnkPtr->directionIdx >= DEAD_COUNT)
+                TnkPtr->directionIdx = 0;
+        }
+        else if(TnkPtr->color == BlueTank)
+            blueCount++;
+        else if(TnkPtr->color == RedTank)
+        {
+            redCount++;
+            badGuyRoutine(i);
+        }
+    } // next i
+    if(score > 0)
+        score -= 0.1;
+
+     ChkCollisions();
+    //Image1.Repaint;
+    CheckGameOver();
+}
+
+/*****************************************************************************
+* Find how far a tank can move along one axis, up to delta pixels. Only the
+* strip the tank would newly cover is tested, so a tank that already
+* overlaps something can always back out of it.
+* Returns: The part of delta that is free.
+*****************************************************************************/
+int Match::SweepTank(int tankIdx, int delta, bool alongX)
+{
+    const TItemRec &tnk = tanksList[tankIdx];
+    const int step = delta > 0 ? 1 : -1;
+    for (int d = delta; d != 0; d -= step)
+    {
+        int sx = tnk.x, sy = tnk.y, sw = tankWidth, sh = tankHeight;
+        if (alongX)
+        {
+            sx = d > 0 ? tnk.x + tankWidth : tnk.x + d;
+            sw = d > 0 ? d : -d;
+        }
+        else
+        {
+            sy = d > 0 ? tnk.y + tankHeight : tnk.y + d;
+            sh = d > 0 ? d : -d;
+        }
+        bool blocked = walls.RectBlocked(tnk.screen, sx, sy, sw, sh);
+        if (!blocked)
+        {
+            tankGrid.ForEachNear(tnk.screen, sx, sy, sx + sw - 1, sy + sh - 1, [&](int other) {
+                const TItemRec &o = tanksList[other];
+                if (other == tankIdx || o.screen != tnk.screen)
+                    return;
+                bool hitsStrip = o.x < sx + sw && sx < o.x + tankWidth &&
+                                 o.y < sy + sh && sy < o.y + tankHeight;
+                bool overlapsNow = o.x < tnk.x + tankWidth && tnk.x < o.x + tankWidth &&
+                                   o.y < tnk.y + tankHeight && tnk.y < o.y + tankHeight;
+                blocked = blocked || (hitsStrip && !overlapsNow);
+            });
+        }
+        if (!blocked)
+            return d;
+    }
+    return 0;
+}
+
+/*****************************************************************************
+* Summary: Move a tank in the direction it faces. The box of the tank is
+* swept against walls and other tanks one axis at a time, so a diagonal
+* move that is blocked on one axis slides along the obstacle.
+* Parameters:
+*   tankIdx, Tank to be moved.
+*   cnt, Number of pixelsto move
+* Returns: False if the tank could not move at all.
+*****************************************************************************/
+bool Match::MoveTank(int tankIdx, int cnt)
+{
+    TItemRec *tnkPtr = &tanksList[tankIdx];
+    const int oldX = tnkPtr->x;
+    const int oldY = tnkPtr->y;
+    int x = oldX;
+    int y = oldY;
+    if (SPRITE_DIR_X[tnkPtr->directionIdx] > 0)
+        x = MoveBtmRight(tnkPtr->x, cnt, MaxX);
+    else if (SPRITE_DIR_X[tnkPtr->directionIdx] < 0)
+        x = MoveTopLeft(tnkPtr->x, cnt);
+    if (SPRITE_DIR_Y[tnkPtr->directionIdx] > 0)
+        y = MoveBtmRight(tnkPtr->y, cnt, MaxY);
+    else if (SPRITE_DIR_Y[tnkPtr->directionIdx] < 0)
+        y = MoveTopLeft(tnkPtr->y, cnt);
+
+    tnkPtr->x += SweepTank(tankIdx, x - oldX, true);
+    tnkPtr->y += SweepTank(tankIdx, y - oldY, false);
+    bool moved = tnkPtr->x != oldX || tnkPtr->y != oldY;
+    NewScreenCheck(tankIdx);
+    tankGrid.Move(tankIdx, *tnkPtr);
+    return moved;
+} // MoveTank
+
+/*****************************************************************************
+* Summary:
+* Parameters:
+*****************************************************************************/
+int Match::MoveTopLeft(int pos, int cnt)
+{
+    pos = pos - cnt;
+    if(pos < 1)
+        pos = 0;
+    return pos;
+}
+
+/*****************************************************************************
+* Summary:
+* Parameters:
+*****************************************************************************/
+int Match::MoveBtmRight(int pos, int cnt, int max_val)
+{
+    pos = pos + cnt;
+    if(pos >= max_val)
+        pos = max_val - 1;
+    return pos;
+}
+
+/*****************************************************************************
+* Summary: When moving thru a door, mov tank to the new screen.
+* Screens form a grid, screenCols wide, numbered row by row:
+*     ||
+*  0  ||  1
+* ==========
+*  2  ||  3
+*     ||
+* Parameters:
+*****************************************************************************/
+void Match::NewScreenCheck(int tankIdx)
+{
+    TItemRec *tnkPtr = &tanksList[tankIdx];
+    const int col = tnkPtr->screen % screenCols;
+    const int row = tnkPtr->screen / screenCols;
+    const int oldScreen = tnkPtr->screen;
+    bool thruDoor = false;
+    if(tnkPtr->x >= (MaxX - 4) && col + 1 < screenCols)
+    {
+        tnkPtr->screen += 1;
+        tnkPtr->x = 5;
+        thruDoor = true;
+    }
+    else if(tnkPtr->x < 4 && col > 0)
+    {
+        tnkPtr->screen -= 1;
+        tnkPtr->x = MaxX - (tankWidth + 1);
+        thruDoor = true;
+    }
+    else if(tnkPtr->y >= (MaxY - 4) && row + 1 < screenRows)
+    {
+        tnkPtr->screen += screenCols;
+        tnkPtr->y = 5;
+        thruDoor = true;
+    }
+    else if(tnkPtr->y < 4 && row > 0)
+    {
+        tnkPtr->screen -= screenCols;
+        tnkPtr->y = MaxY - (tankHeight + 1);
+        thruDoor = true;
+    }
+    if (thruDoor)
+        TelemetryEmit(TEL_SCREEN, telemetrySource, tick, tankIdx, tnkPtr->screen, tnkPtr->x,
+                      tnkPtr->y, oldScreen);
+    if (thruDoor && (tankIdx == playerIdx)) // Our tank? Follow it.
+        curScrn = tnkPtr->screen;
+}
+
+/*****************************************************************************
+*
+*****************************************************************************/
+int Match::CheckGameOver() const
+{
+    int rval = 0;
+    if(redCount < 1)
+    {
+        rval = 1;
+    }
+    else if(blueCount < 1) // You loose
+    {
+        rval = 2;
+    }
+    return rval;
+}
+
+/*****************************************************************************
+* Summary:
+* Parameters: None
+*****************************************************************************/
+void Match::ChkCollisions()
+{
+    int j=0;
+    int removed = 0;
+    for(int i = (int)bullets.Size()-1; i >= 0;i--)
+    {
+        const TItemRec b = bullets.Item(i);
+        if(TankCollision(b.x, b.y, b.screen, &j))
+        {
+            if(j >= 0 && j < tanksList.size())
+            {
+                TItemRec *TnkPtr = &tanksList[j];
+                TItemRec *expRec = &explosionList.emplace_back();
+                expRec->x = b.x - (explosionWidth / 2);
+                expRec->y = b.y - (explosionHeight / 2);
+                expRec->directionIdx = 0;
+                expRec->screen = b.screen;
+                TelemetryEmit(TEL_HIT, telemetrySource, tick, j, b.screen, b.x, b.y,
+                              TnkPtr->color);
+                if (TnkPtr->color != DeadTank)
+                    TelemetryEmit(TEL_DEATH, telemetrySource, tick, j, TnkPtr->screen, TnkPtr->x,
+                                  TnkPtr->y, TnkPtr->color);
+                TnkPtr->color = DeadTank;
+                TnkPtr->directionIdx = 0;
+                // Let the front end play the pop sound
+                events.push_back({EV_TANK_HIT, b.x, b.y, b.screen});
+                bullets.Remove(i);
+                removed++;
+            }
+        }
+        else if(WallCollision(b.x, b.y, b.screen))
+        {
+            TItemRec *expRec = &explosionList.emplace_back();
+            expRec->x = b.x - (explosionWidth / 2);
+            expRec->y = b.y - (explosionHeight / 2);
+            expRec->directionIdx = 0;
+            expRec->screen = b.screen;
+            TelemetryEmit(TEL_WALL_HIT, telemetrySource, tick, -1, b.screen, b.x, b.y);
+            events.push_back({EV_WALL_HIT, b.x, b.y, b.screen});
+            bullets.Remove(i);
+            removed++;
+        }
+    } // next i
+    if (removed > 0)
+        bullets.Compact(); // All at once rather than an erase per bullet
+}
+
+/*****************************************************************************
+* Summary:
+* Parameters:
+*****************************************************************************/
+bool Match::chkBump(int x, int y, int screen)
+{
+    int idx = 0;
+
+    return WallCollision(x,y,screen) || TankCollision(x,y,screen,&idx);
+}
+
+/*****************************************************************************
+* Summary: Test a point against the tanks near it.
+* Parameters: x,y    - Point to be tested
+*             screen - Screen the point is on
+*             idx    - Set to the tank hit, -1 for none
+*****************************************************************************/
+bool Match::TankCollision(int x,int y, int screen, int *idx)
+{
+    // Of several tanks under the point, the last in the list is hit
+    *idx = -1;
+    tankGrid.ForEachNear(screen, x, y, x, y, [&](int i) {
+        const TItemRec *tnkPtr = &tanksList[i];
+        if(i > *idx && tnkPtr->screen == screen &&
+           Collision(x, y, tnkPtr->x, tnkPtr->y, tnkPtr->x + tankWidth, tnkPtr->y + tankHeight))
+            *idx = i;
+    });
+    return *idx >= 0;
+}
+
+/*****************************************************************************
+* Test to see if point is inside rectangle.
+* Parameters:
+*   x, y            - Point
+*   x1, y1, x2, y2  - Rectangle
+* Returns:
+*****************************************************************************/
+bool Match::Collision(int x, int y, int x1, int y1, int x2, int y2)
+{
+    bool retval = ((x >x1) && (x <x2) && (y > y1) && (y < y2));
+
+    return retval;
+} // Collision
+
+/******************************************************************************
+* Test to see if tank[idx] is aiming at a player on its screen.
+******************************************************************************/
+bool Match::AimingAtTarget(int idx)
+{
+    bool retVal = false;
+    TItemRec *tnkPtr = &tanksList[idx];
+    int x2 = tnkPtr->x + (tankWidth / 2);
+    int y2 = tnkPtr->y + (tankHeight / 2);
+    int dir = tnkPtr->directionIdx;
+    int screen = tnkPtr->screen;
+
+    for (size_t target = 0; target < blueTanks.size() && !retVal; target++)
+    {
+        tnkPtr = &tanksList[blueTanks[target]];
+        if ((tnkPtr->color != BlueTank) || (tnkPtr->screen != screen))
+            continue;
+
+        int x1 = tnkPtr->x + (tankWidth / 2);
+        int y1 = tnkPtr->y + (tankHeight / 2);
+
+        int deltaX  = (x1 - x2);
+        int deltaY  = (y2 - y1);
+        int t = 999;
+        if(deltaY != 0)
+            t = (deltaX * 100) / deltaY;
+        switch(dir)
+        {
+            case 0:
+                retVal = (deltaY > 1) && ( abs(t) < 20);
+                break;
+            case 1:
+                retVal = (deltaX > 1) && ( t > 40) and (t < 300);
+                break;
+            case 2:
+                retVal = (deltaX > 1) && ( abs(t) > 400);
+                break;
+            case 3:
+                retVal = (deltaX > 1) && ( t < -40) and (t > -300);
+                break;
+            case 4:
+                retVal = (deltaY < -1) && ( abs(t) < 20);
+                break;
+            case 5:
+                retVal = (deltaX < -1) && ( t > 40) and (t < 300);
+                break;
+            case 6:
+                retVal = (deltaX < -1) && ( abs(t) > 400);
+                break;
+            case 7:
+                retVal = (deltaX < -1) && ( t < -40) and (t > -300);
+                break;
+        }
+    }
+
+    return retVal;
+}// AimingAtTarget
+
+/*****************************************************************************
+ * Summary: Drive a red tank for one tick. It turns a step toward the heading
+ * its last think chose and, once facing it, drives on unless it is holding
+ * position to fire. A tank that is stuck tries sideways until it next
+ * thinks. Thinking happens every THINK_TICKS ticks, see SquadThink().
+ *****************************************************************************/
+void Match::badGuyRoutine(int tankIdx) {
+    TItemRec *tnkPtr = &tanksList[tankIdx];
+    TSquadMemory mem = TSquadMemory::Unpack(tnkPtr->ai);
+    bool fire = false;
+    if (mem.countdown == 0)
+        fire = SquadThink(tankIdx, mem);
+    else
+        mem.countdown--;
+
+    tnkPtr->directionIdx = TurnToward(tnkPtr->directionIdx, mem.desiredDir);
+    if (tnkPtr->directionIdx == mem.desiredDir && !mem.engaging) {
+        const int screen = tnkPtr->screen;
+        if (!MoveTank(tankIdx, 2))
+            mem.desiredDir = (mem.desiredDir + (WorldRand(*this) % 2 ? 2 : DIR_COUNT - 2)) % DIR_COUNT;
+        if (tnkPtr->screen != screen)
+            mem.known = false; // The sighting was on the screen it left
+    }
+    tnkPtr->ai = mem.Pack();
+
+    if (fire) {
+        const int bx = tnkPtr->x + ShotStartX[tnkPtr->directionIdx];
+        const int by = tnkPtr->y + ShotStartY[tnkPtr->directionIdx];
+        bullets.Add(bx, by, tnkPtr->screen, tnkPtr->directionIdx, 0);
+        TelemetryEmit(TEL_SHOT, telemetrySource, tick, tankIdx, tnkPtr->screen, bx, by,
+                      tnkPtr->directionIdx);
+    }
+} // badGuyRoutine
+
+/*****************************************************************************
+ * Summary: Decide where a red tank is going. It looks for the player along
+ * a clear line of sight and shares what it sees on its screen's board;
+ * otherwise it takes the squad's freshest sighting, and forgets it after
+ * MEMORY_THINKS thinks. With a sighting the chaser heads for the player
+ * and the flankers for points to either side of it; in range of a player
+ * it can see, a tank stops and turns to fire. Without one it wanders.
+ * Returns: True if it should fire now.
+ *****************************************************************************/
+bool Match::SquadThink(int tankIdx, TSquadMemory &mem)
+{
+    const TItemRec &tnk = tanksList[tankIdx];
+    // The first think spreads the squad over the ticks
+    mem.countdown = mem.started ? THINK_TICKS - 1 : tankIdx % THINK_TICKS;
+    mem.started = true;
+
+    const int cx = tnk.x + tankWidth / 2, cy = tnk.y + tankHeight / 2;
+    bool sees = false;
+    for (size_t i = 0; i < blueTanks.size() && !sees; i++) {
+        const TItemRec &target = tanksList[blueTanks[i]];
+        if (target.color != BlueTank || target.screen != tnk.screen)
+            continue;
+        const int px = target.x + tankWidth / 2, py = target.y + tankHeight / 2;
+        if (walls.LineOfSight(tnk.screen, cx, cy, px, py)) {
+            sees = true;
+            mem.seenX = px;
+            mem.seenY = py;
+        }
+    }
+
+    if (mem.known && ++mem.age >= MEMORY_THINKS)
+        mem.known = false;
+    const TSquadBoard *board = squads.Board(tnk.screen);
+    if (sees) {
+        mem.known = true;
+        mem.age = 0;
+        squads.Report(tnk.screen, mem.seenX, mem.seenY);
+    } else if (board != nullptr && board->known && board->age < MEMORY_THINKS &&
+               (!mem.known || board->age < mem.age)) {
+        mem.known = true;
+        mem.seenX = board->seenX;
+        mem.seenY = board->seenY;
+        mem.age = board->age;
+    }
+
+    mem.engaging = false;
+    if (!mem.known) {
+        if (WorldRand(*this) % 4 == 0)
+            mem.desiredDir = WorldRand(*this) % DIR_COUNT;
+        return false;
+    }
+
+    const int dx = mem.seenX - cx, dy = mem.seenY - cy;
+    const int dist = std::max(abs(dx), abs(dy));
+    int gx = mem.seenX, gy = mem.seenY;
+    const TSquadRole role = board != nullptr && board->members > 1 ? squads.Role(tankIdx) : ROLE_CHASE;
+    if (role != ROLE_CHASE && dist > ENGAGE_PIXELS) {
+        // Square to the line from this tank to the player
+        const int side = role == ROLE_FLANK_LEFT ? 1 : -1;
+        gx = std::clamp(gx + side * dy * FLANK_PIXELS / dist, tankWidth / 2, MaxX);
+        gy = std::clamp(gy - side * dx * FLANK_PIXELS / dist, tankHeight / 2, MaxY);
+    }
+    const int gdx = gx - cx, gdy = gy - cy;
+    const bool arrived = std::max(abs(gdx), abs(gdy)) <= ARRIVE_PIXELS;
+    if (sees && (dist <= ENGAGE_PIXELS || arrived)) {
+        mem.engaging = true;
+        mem.desiredDir = HeadingTo(dx, dy);
+    } else if (arrived) {
+        mem.known = false; // Nobody here any more
+    } else {
+        mem.desiredDir = HeadingTo(gdx, gdy);
+    }
+    // Half the thinks spent reloading, so a squad in range does not fire a wall of shots
+    return sees && AimingAtTarget(tankIdx) && WorldRand(*this) % 2 == 0;
+} // SquadThink
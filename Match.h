@@ -0,0 +1,133 @@
+//
+// One independent game: world state plus the rules that advance it.
+//
+
+#ifndef TANKS2_MATCH_H
+#define TANKS2_MATCH_H
+
+#include <cstdint>
+#include <vector>
+#include "World.h"
+#include "WallGrid.h"
+#include "TankGrid.h"
+#include "Bullets.h"
+#include "Squad.h"
+#include "SpriteInfo.h"
+
+const int BlueTank = 1;
+const int RedTank = 2;
+const int DeadTank = 3;
+// Animation frames, taken from the sprite sheets
+const int DIR_COUNT = SPRITE_BLUE_TANK.frames;
+const int EXP_COUNT = SPRITE_EXPLOSION.frames;
+const int DEAD_COUNT = SPRITE_DEAD_TANK.frames;
+const int GoodGuyIdx = 0;
+const int FPS = 14; // Simulation ticks per second
+
+// Play area. The window adds the status bar below it.
+const int PLAY_WIDTH = 800;
+const int PLAY_HEIGHT = 560;
+static_assert(PLAY_WIDTH <= 1 << SQUAD_COORD_BITS && PLAY_HEIGHT <= 1 << SQUAD_COORD_BITS,
+              "Red tanks remember sightings anywhere on the screen");
+
+// Sizes of the images. They are compile time constants so collision and
+// drawing code folds them; the front end checks the loaded textures match.
+const int tankWidth = SPRITE_BLUE_TANK.frameWidth;
+const int tankHeight = SPRITE_BLUE_TANK.frameHeight;
+const int explosionWidth = SPRITE_EXPLOSION.frameWidth;
+const int explosionHeight = SPRITE_EXPLOSION.frameHeight;
+const int blockWidth = SPRITE_BLOCK.frameWidth;
+const int blockHeight = SPRITE_BLOCK.frameHeight;
+const int treeWidth = SPRITE_TREE.frameWidth;
+const int treeHeight = SPRITE_TREE.frameHeight;
+// Shot start relative to the tank, per direction
+inline constexpr const int (&ShotStartX)[DIR_COUNT] = SPRITE_MUZZLE_X;
+inline constexpr const int (&ShotStartY)[DIR_COUNT] = SPRITE_MUZZLE_Y;
+
+// Things that happened during a tick that the front end may want to show
+// or play. They are not part of the world state.
+enum TEventType : uint8_t { EV_TANK_HIT, EV_WALL_HIT };
+
+struct TGameEvent {
+    TEventType type;
+    int x, y, screen;
+};
+
+/****************************************************************************
+ * A match owns its whole world, so any number of them can run side by side,
+ * each on whatever thread ticks it. Nothing in here touches SDL.
+ ***************************************************************************/
+class Match : public TWorld {
+public:
+    int width = PLAY_WIDTH;
+    int height = PLAY_HEIGHT;
+    int MaxX = PLAY_WIDTH - tankWidth;
+    int MaxY = PLAY_HEIGHT - tankHeight;
+    int playerIdx = GoodGuyIdx; // Tank whose screen curScrn follows, -1 for none
+    std::vector<TGameEvent> events;
+    // Stamped on telemetry events; not part of the world, so not saved
+    uint32_t tick = 0;            // UpdateGame() calls so far
+    uint16_t telemetrySource = 0; // Tells matches apart in the stream
+    // Generated map used by InitLists(), see GenerateMap(). A seed of 0
+    // means the four hand-made screens.
+    int mapCols = 2, mapRows = 2;
+    uint32_t mapSeed = 0;
+    // Built from blocksList. Call RebuildWalls() after replacing the walls
+    // other than through InitLists(), e.g. when loading a snapshot.
+    TWallGrid walls;
+    uint32_t wallsVersion = 0; // Counts RebuildWalls() calls, for caches of the walls
+    // The live bullets. bulletList is only a copy for snapshots, brought up
+    // to date by Synced(); after replacing bulletList other than through
+    // InitLists(), e.g. when loading a snapshot, call LoadBullets().
+    TBullets bullets;
+
+    explicit Match(uint32_t seed = 1);
+
+    void InitLists();
+    void RebuildWalls();
+    // The world with bulletList up to date, to save, send or hash. Saving
+    // and hashing a Match itself does not compile, see Snapshot.h.
+    const TWorld &Synced()
+    {
+        bullets.Store(bulletList);
+        return *this;
+    }
+    void LoadBullets() { bullets.Load(bulletList); }
+    // Bring the tank lookups up to date after changing tanksList directly.
+    // ApplyAction() and UpdateGame() do this themselves.
+    void BuildTankGrid();
+    void ApplyAction(int tankIdx, uint8_t action);
+    int AddPlayerTank(int slot);
+    void UpdateGame();
+    int CheckGameOver() const;
+
+    bool MoveTank(int tankIdx, int cnt);
+    void NewScreenCheck(int tankIdx);
+    bool chkBump(int x, int y, int screen);
+    bool TankCollision(int x,int y, int screen, int *idx);
+    bool WallCollision(int x, int y, int screen) const { return walls.Blocked(screen, x, y); }
+    bool AimingAtTarget(int idx);
+    static int MoveTopLeft(int pos, int cnt);
+    static int MoveBtmRight(int pos, int cnt, int max_val);
+    static bool Collision(int x, int y, int x1, int y1, int x2, int y2);
+
+private:
+    void InitScrn1();
+    void InitScrn2();
+    void InitScrn3();
+    void InitScrn4();
+    void move_bullets();
+    void animate_explosions();
+    void ChkCollisions();
+    void badGuyRoutine(int tankIdx);
+    bool SquadThink(int tankIdx, TSquadMemory &mem);
+    int SweepTank(int tankIdx, int delta, bool alongX);
+
+    // Rebuilt at the start of every ApplyAction() and UpdateGame(), so
+    // outside changes to tanksList (snapshots, new players) are picked up
+    TTankGrid tankGrid;
+    std::vector<int> blueTanks; // Targets for AimingAtTarget()
+    TSquads squads;             // Rebuilt at the start of every UpdateGame()
+};
+
+#endif //TANKS2_MATCH_H
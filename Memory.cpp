@@ -0,0 +1,120 @@
+//
+// Arenas and tagged memory accounting.
+//
+
+#include "Memory.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+const char *const MemTagNames[MEM_TAG_COUNT] = {
+    "world", "level", "frame", "render", "particles", "rewind"
+};
+
+static std::atomic<int64_t> tagLive[MEM_TAG_COUNT];
+static std::atomic<int64_t> tagPeak[MEM_TAG_COUNT];
+static std::atomic<int64_t> tagAllocs[MEM_TAG_COUNT];
+
+void MemAccount(TMemTag tag, int64_t bytes)
+{
+    int64_t live = tagLive[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (bytes <= 0)
+        return;
+    tagAllocs[tag].fetch_add(1, std::memory_order_relaxed);
+    int64_t peak = tagPeak[tag].load(std::memory_order_relaxed);
+    while (live > peak && !tagPeak[tag].compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+TMemTagStats MemStats(TMemTag tag)
+{
+    return {tagLive[tag].load(std::memory_order_relaxed), tagPeak[tag].load(std::memory_order_relaxed),
+            tagAllocs[tag].load(std::memory_order_relaxed)};
+}
+
+void TArena::AddChunk(size_t atLeast)
+{
+    const size_t size = std::max(chunkBytes, atLeast);
+    char *data = static_cast<char *>(malloc(size));
+    if (data == nullptr)
+        throw std::bad_alloc();
+    chunks.push_back({data, size});
+    reserved += size;
+    MemAccount(tag, (int64_t)size);
+}
+
+void *TArena::Alloc(size_t bytes, size_t align)
+{
+    for (;;) {
+        if (current < chunks.size()) {
+            const TChunk &c = chunks[current];
+            const uintptr_t base = (uintptr_t)c.data;
+            const size_t start = ((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+            if (start + bytes <= c.size) {
+                offset = start + bytes;
+                used += bytes;
+                return c.data + start;
+            }
+            if (current + 1 < chunks.size()) {
+                current++; // Chunks kept from earlier rounds
+                offset = 0;
+                continue;
+            }
+        }
+        AddChunk(bytes + align);
+        current = chunks.size() - 1;
+        offset = 0;
+    }
+}
+
+char *TArena::CopyString(const char *s, size_t len)
+{
+    char *copy = AllocArray<char>(len + 1);
+    memcpy(copy, s, len);
+    copy[len] = 0;
+    return copy;
+}
+
+void TArena::Reset()
+{
+    if (chunks.size() > 1) {
+        const size_t total = reserved;
+        Release();
+        AddChunk(total);
+    }
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+void TArena::Reset(size_t capacity)
+{
+    if (chunks.size() != 1 || chunks[0].size != std::max(chunkBytes, capacity)) {
+        Release();
+        AddChunk(capacity);
+    }
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+void TArena::Release()
+{
+    for (const TChunk &c : chunks) {
+        MemAccount(tag, -(int64_t)c.size);
+        free(c.data);
+    }
+    chunks.clear();
+    reserved = 0;
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+TArena &FrameArena()
+{
+    static thread_local TArena arena(MEM_FRAME);
+    return arena;
+}
@@ -0,0 +1,151 @@
+//
+// Arenas and tagged memory accounting.
+//
+
+#ifndef TANKS2_MEMORY_H
+#define TANKS2_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What memory is used for. Every tagged allocation is counted under one.
+enum TMemTag : uint8_t {
+    MEM_WORLD,     // Entity lists of matches
+    MEM_LEVEL,     // Built from a level's walls, replaced with the level
+    MEM_FRAME,     // Scratch that lives for one drawn frame
+    MEM_RENDER,    // Frames handed from the simulation to drawing
+    MEM_PARTICLES,
+    MEM_REWIND,
+    MEM_TAG_COUNT
+};
+
+extern const char *const MemTagNames[MEM_TAG_COUNT];
+
+struct TMemTagStats {
+    int64_t live;  // Bytes held now
+    int64_t peak;  // Most ever held at once
+    int64_t allocs; // Allocations so far
+};
+
+// Count bytes allocated (positive) or freed (negative) under a tag. Safe
+// from any thread.
+void MemAccount(TMemTag tag, int64_t bytes);
+TMemTagStats MemStats(TMemTag tag);
+
+/****************************************************************************
+ * Standard allocator that counts what its container holds under Tag, e.g.
+ * TTagVector<TItemRec, MEM_WORLD>. Otherwise the same as std::allocator.
+ ***************************************************************************/
+template <typename T, TMemTag Tag>
+struct TTagAllocator {
+    using value_type = T;
+    template <typename U>
+    struct rebind {
+        using other = TTagAllocator<U, Tag>;
+    };
+
+    TTagAllocator() noexcept = default;
+    template <typename U>
+    TTagAllocator(const TTagAllocator<U, Tag> &) noexcept {}
+
+    T *allocate(size_t n)
+    {
+        MemAccount(Tag, (int64_t)(n * sizeof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n) noexcept
+    {
+        MemAccount(Tag, -(int64_t)(n * sizeof(T)));
+        ::operator delete(p);
+    }
+};
+
+template <typename T, typename U, TMemTag Tag>
+bool operator==(const TTagAllocator<T, Tag> &, const TTagAllocator<U, Tag> &) { return true; }
+template <typename T, typename U, TMemTag Tag>
+bool operator!=(const TTagAllocator<T, Tag> &, const TTagAllocator<U, Tag> &) { return false; }
+
+template <typename T, TMemTag Tag>
+using TTagVector = std::vector<T, TTagAllocator<T, Tag>>;
+
+/****************************************************************************
+ * Linear allocator: allocations bump a pointer through large chunks and
+ * are never freed one by one. Reset() forgets them all at once and keeps
+ * the chunks for next time, so an arena that is reset every frame or every
+ * level stops calling malloc once it has grown to its working size. When a
+ * round needed more than one chunk, Reset() replaces them with a single
+ * chunk of the total size.
+ *
+ * Only for types that need no destructor. Not thread safe; give each
+ * thread its own arena.
+ ***************************************************************************/
+class TArena {
+public:
+    explicit TArena(TMemTag tag, size_t chunkBytes = 64 * 1024) : tag(tag), chunkBytes(chunkBytes) {}
+    ~TArena() { Release(); }
+    TArena(const TArena &) = delete;
+    TArena &operator=(const TArena &) = delete;
+
+    void *Alloc(size_t bytes, size_t align = alignof(std::max_align_t));
+    template <typename T>
+    T *AllocArray(size_t count) { return static_cast<T *>(Alloc(count * sizeof(T), alignof(T))); }
+    // Copy of len characters, zero terminated
+    char *CopyString(const char *s, size_t len);
+
+    void Reset();
+    // Reset to a single chunk of capacity bytes, for a user that knows what
+    // it is about to allocate. The chunk is kept when it is that size already.
+    void Reset(size_t capacity);
+    // Reset and return the memory as well
+    void Release();
+
+    size_t Used() const { return used; }
+    size_t Reserved() const { return reserved; }
+
+private:
+    struct TChunk {
+        char *data;
+        size_t size;
+    };
+    void AddChunk(size_t atLeast);
+
+    TMemTag tag;
+    size_t chunkBytes;
+    std::vector<TChunk> chunks;
+    size_t current = 0; // Chunk being filled
+    size_t offset = 0;  // Next free byte in it
+    size_t used = 0, reserved = 0;
+};
+
+/****************************************************************************
+ * Allocator for standard containers that takes its memory from an arena.
+ * Freeing does nothing; the memory comes back when the arena is reset, so
+ * the container must not outlive that.
+ ***************************************************************************/
+template <typename T>
+struct TArenaAllocator {
+    using value_type = T;
+    TArena *arena;
+
+    explicit TArenaAllocator(TArena &arena) noexcept : arena(&arena) {}
+    template <typename U>
+    TArenaAllocator(const TArenaAllocator<U> &o) noexcept : arena(o.arena) {}
+
+    T *allocate(size_t n) { return arena->AllocArray<T>(n); }
+    void deallocate(T *, size_t) noexcept {}
+};
+
+template <typename T, typename U>
+bool operator==(const TArenaAllocator<T> &a, const TArenaAllocator<U> &b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const TArenaAllocator<T> &a, const TArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+template <typename T>
+using TArenaVector = std::vector<T, TArenaAllocator<T>>;
+
+// Per-frame scratch of the calling thread. Whoever runs the thread's frame
+// loop resets it once per frame.
+TArena &FrameArena();
+
+#endif //TANKS2_MEMORY_H
@@ -0,0 +1,386 @@
+//
+// UDP transport for networked matches.
+//
+
+#include "Net.h"
+#include "Snapshot.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+const size_t STATE_HEADER_SIZE = 16;
+
+/****************************************************************************
+ * Small helpers for building and reading packets. All values are stored in
+ * the host byte order; both ends run the same build.
+ ***************************************************************************/
+template<typename T>
+static void Put(std::vector<uint8_t> &buf, T value)
+{
+    const uint8_t *p = (const uint8_t *)&value;
+    buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+template<typename T>
+static T Get(const uint8_t *data, size_t offset)
+{
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+uint64_t NetTimeMs()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+static int OpenSocket(uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+        return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool NetResolve(const char *host, uint16_t port, sockaddr_in &addr)
+{
+    addrinfo hints{};
+    addrinfo *result = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr)
+        return false;
+    addr = *(sockaddr_in *)result->ai_addr;
+    addr.sin_port = htons(port);
+    freeaddrinfo(result);
+    return true;
+}
+
+/****************************************************************************
+ * Queue a packet, or drop it to simulate loss.
+ ***************************************************************************/
+void TLinkSim::Send(int sock, const sockaddr_in &to, const uint8_t *data, size_t size)
+{
+    if (lossPercent > 0 && (int)(rng() % 100) < lossPercent)
+        return;
+    if (latencyMs <= 0 && jitterMs <= 0) {
+        sendto(sock, data, size, 0, (const sockaddr *)&to, sizeof(to));
+        return;
+    }
+    uint64_t due = NetTimeMs() + latencyMs + (jitterMs > 0 ? rng() % (jitterMs + 1) : 0);
+    pending.push_back({due, to, std::vector<uint8_t>(data, data + size)});
+}
+
+/****************************************************************************
+ * Send the delayed packets that are due. Jitter may reorder them, as it
+ * would on a real network.
+ ***************************************************************************/
+void TLinkSim::Flush(int sock)
+{
+    uint64_t now = NetTimeMs();
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->dueMs <= now) {
+            sendto(sock, it->data.data(), it->data.size(), 0, (const sockaddr *)&it->to, sizeof(it->to));
+            it = pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/*******************************************************************************
+ * TNetServer
+ ******************************************************************************/
+TNetServer::~TNetServer()
+{
+    if (sock >= 0)
+        close(sock);
+}
+
+bool TNetServer::Open(uint16_t port)
+{
+    sock = OpenSocket(port);
+    return sock >= 0;
+}
+
+int TNetServer::FindClient(const sockaddr_in &addr) const
+{
+    for (size_t i = 0; i < clients.size(); i++) {
+        if (clients[i].addr.sin_addr.s_addr == addr.sin_addr.s_addr &&
+            clients[i].addr.sin_port == addr.sin_port)
+            return (int)i;
+    }
+    return -1;
+}
+
+/****************************************************************************
+ * Read everything waiting on the socket and drop clients that went quiet.
+ ***************************************************************************/
+void TNetServer::Poll()
+{
+    uint8_t buf[2048];
+    sockaddr_in from{};
+    socklen_t fromLen = sizeof(from);
+    ssize_t n;
+    while ((n = recvfrom(sock, buf, sizeof(buf), 0, (sockaddr *)&from, &fromLen)) > 0) {
+        HandlePacket(from, buf, (size_t)n);
+        fromLen = sizeof(from);
+    }
+
+    uint64_t now = NetTimeMs();
+    for (int i = (int)clients.size() - 1; i >= 0; i--) {
+        if (now - clients[i].lastHeardMs > NET_TIMEOUT_MS) {
+            int tankIdx = clients[i].tankIdx;
+            clients.erase(clients.begin() + i);
+            if (onLeave)
+                onLeave(tankIdx);
+        }
+    }
+    link.Flush(sock);
+}
+
+void TNetServer::HandlePacket(const sockaddr_in &from, const uint8_t *data, size_t size)
+{
+    if (size < 1)
+        return;
+    int idx = FindClient(from);
+
+    if (data[0] == PKT_HELLO) {
+        if (idx < 0) {
+            if ((int)clients.size() >= NET_MAX_PLAYERS || !onJoin)
+                return;
+            int tankIdx = onJoin();
+            if (tankIdx < 0)
+                return;
+            TClient client;
+            client.addr = from;
+            client.tankIdx = tankIdx;
+            clients.push_back(client);
+            idx = (int)clients.size() - 1;
+        }
+        clients[idx].lastHeardMs = NetTimeMs();
+        packet.clear();
+        Put<uint8_t>(packet, PKT_WELCOME);
+        Put<uint8_t>(packet, 0);
+        Put<int16_t>(packet, (int16_t)clients[idx].tankIdx);
+        Put<int16_t>(packet, (int16_t)mapCols);
+        Put<int16_t>(packet, (int16_t)mapRows);
+        Put<uint32_t>(packet, mapSeed);
+        link.Send(sock, from, packet.data(), packet.size());
+        bytesSent += packet.size();
+    } else if (data[0] == PKT_INPUT && idx >= 0 && size >= 10) {
+        // type, count, ackTick, lastSeq, count actions ending at lastSeq
+        TClient &client = clients[idx];
+        uint8_t count = data[1];
+        uint32_t ackTick = Get<uint32_t>(data, 2);
+        uint32_t lastSeq = Get<uint32_t>(data, 6);
+        if (size < 10u + count || count > lastSeq)
+            return;
+        client.lastHeardMs = NetTimeMs();
+        if (ackTick > client.ackTick)
+            client.ackTick = ackTick;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t seq = lastSeq - count + 1 + i;
+            if (seq > client.appliedSeq && seq + NET_INPUT_WINDOW > client.receivedSeq)
+                client.inputs[seq % NET_INPUT_WINDOW] = data[10 + i];
+        }
+        if (lastSeq > client.receivedSeq)
+            client.receivedSeq = lastSeq;
+        // Skip inputs that would fall out of the window
+        if (client.receivedSeq - client.appliedSeq > NET_INPUT_WINDOW / 2)
+            client.appliedSeq = client.receivedSeq - NET_INPUT_WINDOW / 4;
+    }
+}
+
+/****************************************************************************
+ * The next input of a client for this tick, or no action if it has not
+ * arrived yet.
+ ***************************************************************************/
+uint8_t TNetServer::NextInput(int client)
+{
+    TClient &c = clients[client];
+    if (c.receivedSeq <= c.appliedSeq)
+        return 0;
+    c.appliedSeq++;
+    return c.inputs[c.appliedSeq % NET_INPUT_WINDOW];
+}
+
+/****************************************************************************
+ * Send the state after the given tick to every client.
+ * Packet: type, pad, tank index, tick, base tick (0 = none), last input
+ * applied, then the snapshot delta against the base.
+ ***************************************************************************/
+void TNetServer::SendState(const TWorld &world, uint32_t tick)
+{
+    THistory &current = history[tick % NET_HISTORY];
+    SaveSnapshot(world, current.state, 0);
+    current.tick = tick;
+
+    for (TClient &client : clients) {
+        uint32_t baseTick = client.ackTick;
+        const THistory &base = history[baseTick % NET_HISTORY];
+        if (baseTick == 0 || base.tick != baseTick || tick - baseTick >= NET_HISTORY)
+            baseTick = 0;
+
+        if (baseTick != 0)
+            EncodeSnapshotDelta(base.state.data(), base.state.size(),
+                                current.state.data(), current.state.size(), delta);
+        else
+            EncodeSnapshotDelta(nullptr, 0, current.state.data(), current.state.size(), delta);
+        if (STATE_HEADER_SIZE + delta.size() > NET_MAX_PACKET)
+            continue;
+
+        packet.clear();
+        Put<uint8_t>(packet, PKT_STATE);
+        Put<uint8_t>(packet, 0);
+        Put<int16_t>(packet, (int16_t)client.tankIdx);
+        Put<uint32_t>(packet, tick);
+        Put<uint32_t>(packet, baseTick);
+        Put<uint32_t>(packet, client.appliedSeq);
+        packet.insert(packet.end(), delta.begin(), delta.end());
+        link.Send(sock, client.addr, packet.data(), packet.size());
+        bytesSent += packet.size();
+    }
+    link.Flush(sock);
+}
+
+/*******************************************************************************
+ * TNetClient
+ ******************************************************************************/
+TNetClient::~TNetClient()
+{
+    if (sock >= 0)
+        close(sock);
+}
+
+bool TNetClient::Connect(const char *host, uint16_t port)
+{
+    if (!NetResolve(host, port, server))
+        return false;
+    sock = OpenSocket(0);
+    return sock >= 0;
+}
+
+/****************************************************************************
+ * Say hello until the server answers, and read incoming states.
+ ***************************************************************************/
+void TNetClient::Poll()
+{
+    uint64_t now = NetTimeMs();
+    if (!Joined() && now - lastHelloMs > 250) {
+        uint8_t hello = PKT_HELLO;
+        link.Send(sock, server, &hello, 1);
+        bytesSent++;
+        lastHelloMs = now;
+    }
+
+    sockaddr_in from{};
+    socklen_t fromLen = sizeof(from);
+    ssize_t n;
+    while ((n = recvfrom(sock, recvBuf, sizeof(recvBuf), 0, (sockaddr *)&from, &fromLen)) > 0) {
+        if (from.sin_addr.s_addr == server.sin_addr.s_addr && from.sin_port == server.sin_port) {
+            bytesReceived += (uint64_t)n;
+            HandlePacket(recvBuf, (size_t)n);
+        }
+        fromLen = sizeof(from);
+    }
+    link.Flush(sock);
+}
+
+void TNetClient::HandlePacket(const uint8_t *data, size_t size)
+{
+    if (size >= 12 && data[0] == PKT_WELCOME) {
+        // type, 0, tank, map columns, map rows, map seed
+        int16_t cols = Get<int16_t>(data, 4);
+        int16_t rows = Get<int16_t>(data, 6);
+        if (cols <= 0 || rows <= 0)
+            return;
+        tankIdx = Get<int16_t>(data, 2);
+        mapCols = cols;
+        mapRows = rows;
+        mapSeed = Get<uint32_t>(data, 8);
+    } else if (size >= STATE_HEADER_SIZE && data[0] == PKT_STATE) {
+        if (mapCols == 0)
+            return; // Not welcomed yet, the map is unknown
+        int16_t tank = Get<int16_t>(data, 2);
+        uint32_t tick = Get<uint32_t>(data, 4);
+        uint32_t baseTick = Get<uint32_t>(data, 8);
+        uint32_t ackSeq = Get<uint32_t>(data, 12);
+        if (tick <= latestTick)
+            return; // Late or duplicate
+
+        state.clear();
+        if (baseTick != 0) {
+            const THistory &base = history[baseTick % NET_HISTORY];
+            if (base.tick != baseTick)
+                return;
+            state = base.state;
+        }
+        if (!ApplySnapshotDelta(state, data + STATE_HEADER_SIZE, size - STATE_HEADER_SIZE))
+            return;
+
+        THistory &slot = history[tick % NET_HISTORY];
+        slot.tick = tick;
+        slot.state.swap(state);
+        latestTick = tick;
+        latestAckSeq = ackSeq;
+        tankIdx = tank;
+        newState = true;
+    }
+}
+
+/****************************************************************************
+ * Number the input, remember it for replay and send it along with the few
+ * before it, so that a lost packet does not lose the input.
+ ***************************************************************************/
+uint32_t TNetClient::SendInput(uint8_t action)
+{
+    lastSeq++;
+    inputs[lastSeq % NET_INPUT_WINDOW] = action;
+    if (!Joined())
+        return lastSeq;
+
+    uint8_t count = (uint8_t)std::min<uint32_t>(NET_INPUT_REDUNDANCY, lastSeq);
+    std::vector<uint8_t> packet;
+    Put<uint8_t>(packet, PKT_INPUT);
+    Put<uint8_t>(packet, count);
+    Put<uint32_t>(packet, latestTick);
+    Put<uint32_t>(packet, lastSeq);
+    for (uint32_t seq = lastSeq - count + 1; seq <= lastSeq; seq++)
+        Put<uint8_t>(packet, inputs[seq % NET_INPUT_WINDOW]);
+    link.Send(sock, server, packet.data(), packet.size());
+    bytesSent += packet.size();
+    return lastSeq;
+}
+
+/****************************************************************************
+ * Load the newest authoritative state, if one arrived since the last call.
+ * ackSeq is the last of our inputs the server had applied to it.
+ ***************************************************************************/
+bool TNetClient::TakeState(TWorld &world, uint32_t &ackSeq, int &playerTank)
+{
+    if (!newState)
+        return false;
+    newState = false;
+    const THistory &latest = history[latestTick % NET_HISTORY];
+    if (!RestoreSnapshot(world, latest.state.data(), latest.state.size()))
+        return false;
+    ackSeq = latestAckSeq;
+    playerTank = tankIdx;
+    return true;
+}
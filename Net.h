@@ -0,0 +1,160 @@
+//
+// UDP transport for networked matches.
+//
+
+#ifndef TANKS2_NET_H
+#define TANKS2_NET_H
+
+#include <netinet/in.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <random>
+#include <vector>
+#include "World.h"
+
+class Match;
+
+const uint16_t NET_DEFAULT_PORT = 27960;
+const int NET_MAX_PLAYERS = 4;
+const int NET_INPUT_REDUNDANCY = 8; // Inputs repeated in every input packet
+const int NET_HISTORY = 64;         // Ticks of snapshots kept as delta bases
+const int NET_INPUT_WINDOW = 64;    // Buffered inputs per client
+const int NET_TIMEOUT_MS = 5000;
+const size_t NET_MAX_PACKET = 65507; // Largest UDP payload
+
+enum TPacketType : uint8_t { PKT_HELLO = 1, PKT_WELCOME, PKT_INPUT, PKT_STATE };
+
+/****************************************************************************
+ * Sends packets after a simulated delay, optionally dropping some of them.
+ * With no latency and no loss, packets go straight to the socket.
+ ***************************************************************************/
+class TLinkSim {
+public:
+    int latencyMs = 0;
+    int jitterMs = 0;
+    int lossPercent = 0;
+
+    void Send(int sock, const sockaddr_in &to, const uint8_t *data, size_t size);
+    void Flush(int sock);
+
+private:
+    struct TPending {
+        uint64_t dueMs;
+        sockaddr_in to;
+        std::vector<uint8_t> data;
+    };
+    std::deque<TPending> pending;
+    std::mt19937 rng{12345};
+};
+
+uint64_t NetTimeMs();
+bool NetResolve(const char *host, uint16_t port, sockaddr_in &addr);
+
+/****************************************************************************
+ * Authoritative side. The game loop drains one input per client each tick,
+ * runs the simulation and calls SendState() with the result. Every client
+ * receives the state delta-compressed against the last one it acknowledged.
+ ***************************************************************************/
+class TNetServer {
+public:
+    // Called when a new client joins. Returns the tank index of the new
+    // player, or -1 to refuse the client.
+    std::function<int()> onJoin;
+    // Called when a client times out, with its tank index.
+    std::function<void(int)> onLeave;
+    TLinkSim link;
+    // Map sent to joining clients, as in Match (seed 0 for the classic screens)
+    int mapCols = 2, mapRows = 2;
+    uint32_t mapSeed = 0;
+
+    ~TNetServer();
+    bool Open(uint16_t port);
+    void Poll();
+    int ClientCount() const { return (int)clients.size(); }
+    int ClientTank(int client) const { return clients[client].tankIdx; }
+    void SetClientTank(int client, int tankIdx) { clients[client].tankIdx = tankIdx; }
+    uint8_t NextInput(int client);
+    void SendState(const TWorld &world, uint32_t tick);
+    void SendState(const Match &match, uint32_t tick) = delete; // Send match.Synced()
+    uint64_t BytesSent() const { return bytesSent; }
+
+private:
+    struct TClient {
+        sockaddr_in addr;
+        uint64_t lastHeardMs;
+        int tankIdx;
+        uint32_t ackTick = 0;      // Newest state the client has, 0 for none
+        uint32_t appliedSeq = 0;   // Last input applied to the world
+        uint32_t receivedSeq = 0;  // Newest input received
+        uint8_t inputs[NET_INPUT_WINDOW] = {};
+    };
+    struct THistory {
+        uint32_t tick = 0;
+        std::vector<uint8_t> state;
+    };
+
+    int sock = -1;
+    std::vector<TClient> clients;
+    THistory history[NET_HISTORY];
+    std::vector<uint8_t> delta;
+    std::vector<uint8_t> packet;
+    uint64_t bytesSent = 0;
+
+    int FindClient(const sockaddr_in &addr) const;
+    void HandlePacket(const sockaddr_in &from, const uint8_t *data, size_t size);
+};
+
+/****************************************************************************
+ * Client side. Inputs are numbered; the client applies each one locally at
+ * once and keeps it until the server reports it as applied, so that the
+ * prediction can be replayed on top of every authoritative state.
+ ***************************************************************************/
+class TNetClient {
+public:
+    TLinkSim link;
+
+    ~TNetClient();
+    bool Connect(const char *host, uint16_t port);
+    bool Joined() const { return tankIdx >= 0; }
+    // Map the server plays on, known once it welcomed us
+    int MapCols() const { return mapCols; }
+    int MapRows() const { return mapRows; }
+    uint32_t MapSeed() const { return mapSeed; }
+    void Poll();
+    uint32_t SendInput(uint8_t action);
+    uint8_t InputAt(uint32_t seq) const { return inputs[seq % NET_INPUT_WINDOW]; }
+    uint32_t LastSeq() const { return lastSeq; }
+    bool TakeState(TWorld &world, uint32_t &ackSeq, int &playerTank);
+    uint64_t BytesReceived() const { return bytesReceived; }
+    uint64_t BytesSent() const { return bytesSent; }
+
+private:
+    struct THistory {
+        uint32_t tick = 0;
+        std::vector<uint8_t> state;
+    };
+
+    int sock = -1;
+    sockaddr_in server{};
+    int tankIdx = -1;
+    int mapCols = 0, mapRows = 0;
+    uint32_t mapSeed = 0;
+    uint32_t lastSeq = 0;
+    uint8_t inputs[NET_INPUT_WINDOW] = {};
+    THistory history[NET_HISTORY];
+    uint32_t latestTick = 0;
+    uint32_t latestAckSeq = 0;
+    bool newState = false;
+    uint64_t lastHelloMs = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;
+    // Scratch reused by every packet
+    uint8_t recvBuf[NET_MAX_PACKET];
+    std::vector<uint8_t> state;
+
+    void HandlePacket(const uint8_t *data, size_t size);
+};
+
+#endif //TANKS2_NET_H
@@ -0,0 +1,203 @@
+//
+// Every screen of a match drawn at once, as a tiled overview or a minimap.
+//
+
+#include "Overview.h"
+#include <algorithm>
+#include <cmath>
+#include "Memory.h"
+
+const SDL_Color BackgroundColor = {220, 220, 180, 255}; // Same as ClearScreen()
+
+// Kinds of dot, drawn in this order
+using TRectList = TArenaVector<SDL_Rect>;
+
+enum { DOT_BLUE, DOT_RED, DOT_DEAD, DOT_BULLET, DOT_EXPLOSION, DOT_KINDS };
+static const SDL_Color DotColor[DOT_KINDS] = {
+    {30, 60, 230, 255}, {210, 30, 30, 255}, {90, 90, 90, 255}, {0, 0, 0, 255}, {255, 150, 0, 255}
+};
+
+/****************************************************************************
+ * Window rectangle of a box given in map coordinates, where the screen in
+ * column c, row r starts at (c * PLAY_WIDTH, r * PLAY_HEIGHT). Never less
+ * than a pixel, so the smallest minimap still shows everything.
+ ***************************************************************************/
+static SDL_Rect MapBox(int ox, int oy, double k, int x, int y, int w, int h)
+{
+    int x1 = ox + (int)std::lround(x * k), y1 = oy + (int)std::lround(y * k);
+    int x2 = ox + (int)std::lround((x + w) * k), y2 = oy + (int)std::lround((y + h) * k);
+    return {x1, y1, std::max(1, x2 - x1), std::max(1, y2 - y1)};
+}
+
+void TOverview::Invalidate()
+{
+    if (walls != nullptr)
+        SDL_DestroyTexture(walls);
+    walls = nullptr;
+    wallsRenderer = nullptr;
+}
+
+/****************************************************************************
+ * Background, walls, screen borders and, without sprites, trees, with the
+ * grid's top left corner at (ox, oy).
+ ***************************************************************************/
+static void PaintWalls(SDL_Renderer *renderer, TSpriteAtlas &atlas, const TRenderFrame &frame,
+                       bool sprites, int ox, int oy, int w, int h, double k)
+{
+    SDL_Rect all = {ox, oy, w, h};
+    SDL_SetRenderDrawColor(renderer, BackgroundColor.r, BackgroundColor.g, BackgroundColor.b, 255);
+    SDL_RenderFillRect(renderer, &all);
+
+    SDL_Texture *block = sprites ? atlas.Texture(renderer, SPR_BLOCK) : nullptr;
+    TRectList rects{TArenaAllocator<SDL_Rect>(FrameArena())};
+    for (int s = 0; s < frame.allBlocks.Screens(); s++) {
+        const int baseX = (s % frame.screenCols) * PLAY_WIDTH;
+        const int baseY = (s / frame.screenCols) * PLAY_HEIGHT;
+        for (const TItemRec *b = frame.allBlocks.Begin(s); b != frame.allBlocks.End(s); b++) {
+            SDL_Rect r = MapBox(ox, oy, k, baseX + b->x, baseY + b->y, blockWidth, blockHeight);
+            if (block != nullptr)
+                SDL_RenderCopy(renderer, block, nullptr, &r);
+            else
+                rects.push_back(r);
+        }
+    }
+    SDL_SetRenderDrawColor(renderer, 120, 70, 40, 255);
+    SDL_RenderFillRects(renderer, rects.data(), (int)rects.size());
+
+    if (!sprites) {
+        rects.clear();
+        for (int s = 0; s < frame.allTrees.Screens(); s++) {
+            const int baseX = (s % frame.screenCols) * PLAY_WIDTH;
+            const int baseY = (s / frame.screenCols) * PLAY_HEIGHT;
+            for (const TItemRec *t = frame.allTrees.Begin(s); t != frame.allTrees.End(s); t++)
+                rects.push_back(MapBox(ox, oy, k, baseX + t->x, baseY + t->y, treeWidth, treeHeight));
+        }
+        SDL_SetRenderDrawColor(renderer, 40, 130, 40, 255);
+        SDL_RenderFillRects(renderer, rects.data(), (int)rects.size());
+    }
+
+    SDL_SetRenderDrawColor(renderer, 60, 60, 60, 255);
+    for (int c = 1; c < frame.screenCols; c++) {
+        int x = ox + (int)std::lround(c * PLAY_WIDTH * k);
+        SDL_RenderDrawLine(renderer, x, oy, x, oy + h - 1);
+    }
+    for (int r = 1; r < frame.screenRows; r++) {
+        int y = oy + (int)std::lround(r * PLAY_HEIGHT * k);
+        SDL_RenderDrawLine(renderer, ox, y, ox + w - 1, y);
+    }
+}
+
+/****************************************************************************
+ * Bring the walls texture up to date and draw it. Falls back to drawing the
+ * walls every frame where the renderer cannot draw into textures.
+ ***************************************************************************/
+void TOverview::DrawWalls(SDL_Renderer *renderer, const TRenderFrame &frame, bool sprites)
+{
+    if (walls != nullptr && (wallsRenderer != renderer || wallsVersion != frame.wallsVersion ||
+                             wallsSprites != sprites))
+        Invalidate();
+    SDL_Rect dst = {gridX, gridY, gridW, gridH};
+    if (walls == nullptr && SDL_RenderTargetSupported(renderer)) {
+        walls = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                  gridW, gridH);
+        if (walls != nullptr && SDL_SetRenderTarget(renderer, walls) == 0) {
+            PaintWalls(renderer, atlas, frame, sprites, 0, 0, gridW, gridH, k);
+            SDL_SetRenderTarget(renderer, nullptr);
+            wallsRenderer = renderer;
+            wallsVersion = frame.wallsVersion;
+            wallsSprites = sprites;
+        } else {
+            Invalidate();
+        }
+    }
+    if (walls != nullptr)
+        SDL_RenderCopy(renderer, walls, nullptr, &dst);
+    else
+        PaintWalls(renderer, atlas, frame, sprites, gridX, gridY, gridW, gridH, k);
+}
+
+bool TOverview::Draw(SDL_Renderer *renderer, const TRenderFrame &frame, const SDL_Rect &area,
+                     bool sprites)
+{
+    if (!frame.allScreens || frame.allTanks.Screens() == 0 || area.w <= 0 || area.h <= 0)
+        return false;
+
+    // Fit the whole map into the area, keeping its shape
+    const int mapW = frame.screenCols * PLAY_WIDTH;
+    const int mapH = frame.screenRows * PLAY_HEIGHT;
+    const double scale = std::min((double)area.w / mapW, (double)area.h / mapH);
+    const int w = std::max(1, (int)std::lround(mapW * scale));
+    const int h = std::max(1, (int)std::lround(mapH * scale));
+    if (w != gridW || h != gridH)
+        Invalidate();
+    gridW = w;
+    gridH = h;
+    gridX = area.x + (area.w - w) / 2;
+    gridY = area.y + (area.h - h) / 2;
+    k = scale;
+    DrawWalls(renderer, frame, sprites);
+
+    const TArenaAllocator<SDL_Rect> scratch(FrameArena());
+    TRectList rects[DOT_KINDS] = {TRectList(scratch), TRectList(scratch), TRectList(scratch),
+                                  TRectList(scratch), TRectList(scratch)};
+    auto forEach = [&](const TScreenBuckets &buckets, auto &&draw) {
+        for (int s = 0; s < buckets.Screens(); s++) {
+            const int baseX = (s % frame.screenCols) * PLAY_WIDTH;
+            const int baseY = (s / frame.screenCols) * PLAY_HEIGHT;
+            for (const TItemRec *item = buckets.Begin(s); item != buckets.End(s); item++)
+                draw(*item, baseX + item->x, baseY + item->y);
+        }
+    };
+    auto image = [&](TSpriteId id, const TItemRec &item, int x, int y, int w, int h) {
+        SDL_Rect src = atlas.Frame(id, item.directionIdx);
+        SDL_Rect dst = MapBox(gridX, gridY, k, x, y, w, h);
+        SDL_RenderCopy(renderer, atlas.Texture(renderer, id), &src, &dst);
+    };
+
+    forEach(frame.allTanks, [&](const TItemRec &t, int x, int y) {
+        if (t.color != BlueTank && t.color != RedTank && t.color != DeadTank)
+            return;
+        if (sprites)
+            image(t.color == BlueTank ? SPR_BLUE_TANK : t.color == RedTank ? SPR_RED_TANK : SPR_DEAD_TANK,
+                  t, x, y, tankWidth, tankHeight);
+        else
+            rects[t.color == BlueTank ? DOT_BLUE : t.color == RedTank ? DOT_RED : DOT_DEAD].push_back(
+                MapBox(gridX, gridY, k, x, y, tankWidth, tankHeight));
+    });
+    forEach(frame.allBullets, [&](const TItemRec &, int x, int y) {
+        rects[DOT_BULLET].push_back(MapBox(gridX, gridY, k, x - 1, y - 1, 3, 3));
+    });
+    // Bullets go under explosions and trees, as on the play screen
+    if (sprites) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderFillRects(renderer, rects[DOT_BULLET].data(), (int)rects[DOT_BULLET].size());
+        rects[DOT_BULLET].clear();
+    }
+    forEach(frame.allExplosions, [&](const TItemRec &e, int x, int y) {
+        if (sprites)
+            image(SPR_EXPLOSION, e, x, y, explosionWidth, explosionHeight);
+        else
+            rects[DOT_EXPLOSION].push_back(MapBox(gridX, gridY, k, x, y, explosionWidth, explosionHeight));
+    });
+    if (sprites) {
+        SDL_Texture *tree = atlas.Texture(renderer, SPR_TREE);
+        forEach(frame.allTrees, [&](const TItemRec &, int x, int y) {
+            SDL_Rect dst = MapBox(gridX, gridY, k, x, y, treeWidth, treeHeight);
+            SDL_RenderCopy(renderer, tree, nullptr, &dst);
+        });
+    }
+    for (int kind = 0; kind < DOT_KINDS; kind++) {
+        if (rects[kind].empty())
+            continue;
+        const SDL_Color &c = DotColor[kind];
+        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+        SDL_RenderFillRects(renderer, rects[kind].data(), (int)rects[kind].size());
+    }
+
+    // Mark the screen the player is on
+    SDL_Rect current = MapBox(gridX, gridY, k, (frame.curScrn % frame.screenCols) * PLAY_WIDTH,
+                              (frame.curScrn / frame.screenCols) * PLAY_HEIGHT, PLAY_WIDTH, PLAY_HEIGHT);
+    SDL_SetRenderDrawColor(renderer, 255, 220, 0, 255);
+    SDL_RenderDrawRect(renderer, &current);
+    return true;
+} // Draw
@@ -0,0 +1,52 @@
+//
+// Every screen of a match drawn at once, as a tiled overview or a minimap.
+//
+
+#ifndef TANKS2_OVERVIEW_H
+#define TANKS2_OVERVIEW_H
+
+#include <SDL2/SDL.h>
+#include "RenderPipe.h"
+#include "SpriteAtlas.h"
+
+/****************************************************************************
+ * Draws all screens of a frame captured with allScreens, laid out in their
+ * map grid and scaled to fit an area of the window. Walls and trees only
+ * change with a new map, so they are drawn once into a texture that is
+ * reused until the frame's wallsVersion or the area changes.
+ *
+ * The moving things are walked screen by screen through the frame's
+ * buckets, each item touched once whatever the number of screens. Without
+ * sprites every item becomes a rectangle and each kind is drawn with one
+ * SDL_RenderFillRects call, which keeps thousands of items cheap. The
+ * rectangle lists come from the frame arena.
+ ***************************************************************************/
+class TOverview {
+public:
+    explicit TOverview(TSpriteAtlas &atlas) : atlas(atlas) {}
+    ~TOverview() { Invalidate(); }
+    TOverview(const TOverview &) = delete;
+    TOverview &operator=(const TOverview &) = delete;
+
+    // Draw the frame into area (window pixels). False if the frame holds
+    // only its current screen. With sprites tanks, explosions and trees are
+    // drawn as images, otherwise as dots.
+    bool Draw(SDL_Renderer *renderer, const TRenderFrame &frame, const SDL_Rect &area, bool sprites);
+    // Drop the cached walls, e.g. before their renderer goes
+    void Invalidate();
+
+private:
+    void DrawWalls(SDL_Renderer *renderer, const TRenderFrame &frame, bool sprites);
+
+    TSpriteAtlas &atlas;
+    // Layout of the last Draw(): grid origin in the window and map scale
+    int gridX = 0, gridY = 0, gridW = 0, gridH = 0;
+    double k = 1;
+
+    SDL_Texture *walls = nullptr;
+    SDL_Renderer *wallsRenderer = nullptr;
+    uint32_t wallsVersion = 0;
+    bool wallsSprites = false;
+};
+
+#endif //TANKS2_OVERVIEW_H
@@ -0,0 +1,105 @@
+//
+// Frame pacing on the high resolution clock.
+//
+
+#include "Pacer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using namespace std::chrono;
+
+const TFramePacer::TClock::duration MIN_MARGIN = microseconds(250);
+const TFramePacer::TClock::duration MAX_MARGIN = milliseconds(4);
+
+TFramePacer::TFramePacer(double hz)
+    : periodSeconds(1.0 / hz),
+      period(duration_cast<TClock::duration>(duration<double>(periodSeconds))),
+      margin(milliseconds(2))
+{
+    Restart();
+}
+
+void TFramePacer::Restart()
+{
+    start = TClock::now();
+    due = 0;
+    haveLast = false;
+}
+
+void TFramePacer::Wait()
+{
+    due++;
+    // From the frame count, not by adding periods, so rounding never adds up
+    const TClock::time_point target =
+        start + duration_cast<TClock::duration>(duration<double>(periodSeconds * (double)due));
+    TClock::time_point now = TClock::now();
+    if (now - target > period) {
+        late++;
+        start = now; // Too far behind to catch up, carry on from here
+        due = 0;
+        Record(now);
+        return;
+    }
+
+    if (target - now > margin) {
+        const TClock::time_point wake = target - margin;
+        std::this_thread::sleep_until(wake);
+        // Keep the margin a little above the worst recent oversleep,
+        // slowly giving it back while the system behaves
+        const TClock::duration overslept = TClock::now() - wake;
+        margin = std::clamp(std::max(margin - margin / 16, overslept + overslept / 2), MIN_MARGIN,
+                            MAX_MARGIN);
+    }
+    while ((now = TClock::now()) < target) {
+        // Spin out the last fraction of a millisecond
+    }
+    if (now - target > milliseconds(1))
+        late++;
+    Record(now);
+}
+
+void TFramePacer::Record(TClock::time_point now)
+{
+    if (haveLast) {
+        const double ms = duration<double, std::milli>(now - last).count();
+        const double dev = ms - periodSeconds * 1000;
+        frames++;
+        sumMs += ms;
+        sumSqMs += ms * ms;
+        worstMs = std::max(worstMs, std::fabs(dev));
+        int bucket = (int)std::lround(dev / BUCKET_MS) + BUCKETS / 2;
+        histogram[std::clamp(bucket, 0, BUCKETS - 1)]++;
+    }
+    last = now;
+    haveLast = true;
+}
+
+double TFramePacer::MeanMs() const
+{
+    return frames > 0 ? sumMs / frames : 0;
+}
+
+double TFramePacer::JitterMs() const
+{
+    if (frames < 2)
+        return 0;
+    const double mean = MeanMs();
+    return std::sqrt(std::max(0.0, sumSqMs / frames - mean * mean));
+}
+
+void TFramePacer::Format(char *buf, size_t size) const
+{
+    int n = snprintf(buf, size, "%ld frames, period %.3f ms, mean %.3f ms, jitter %.3f ms, "
+                     "worst %.3f ms off, %ld late",
+                     frames, periodSeconds * 1000, MeanMs(), JitterMs(),
+                     worstMs, late);
+    for (int b = 0; b < BUCKETS && n > 0 && (size_t)n < size; b++) {
+        if (histogram[b] == 0)
+            continue;
+        const double dev = (b - BUCKETS / 2) * BUCKET_MS;
+        const char *edge = b == 0 ? "<=" : b == BUCKETS - 1 ? ">=" : "  ";
+        n += snprintf(buf + n, size - n, "\n  %s%+5.1f ms: %ld", edge, dev, histogram[b]);
+    }
+}
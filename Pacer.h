@@ -0,0 +1,63 @@
+//
+// Frame pacing on the high resolution clock.
+//
+
+#ifndef TANKS2_PACER_H
+#define TANKS2_PACER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/****************************************************************************
+ * Holds a loop to a fixed rate. Frame n is due at start + n * period, on an
+ * absolute timeline in nanoseconds, so a period that is not a whole number
+ * of milliseconds never drifts. Wait() sleeps until shortly before the due
+ * time and spins for the rest; the margin follows how late the operating
+ * system has been waking us, so the spin stays short.
+ *
+ * A loop that falls more than a frame behind restarts the timeline from
+ * now rather than running a burst of frames to catch up.
+ *
+ * The time between consecutive Wait() returns goes into a histogram of
+ * deviations from the period, for the log on exit.
+ ***************************************************************************/
+class TFramePacer {
+public:
+    using TClock = std::chrono::steady_clock;
+
+    explicit TFramePacer(double hz);
+
+    // Return when the next frame is due
+    void Wait();
+    // Start the timeline again from now, e.g. after the loop was paused.
+    // The pause is left out of the statistics.
+    void Restart();
+
+    long Frames() const { return frames; }
+    long LateFrames() const { return late; }
+    double MeanMs() const;        // Average time between frames
+    double JitterMs() const;      // Standard deviation of that time
+    double WorstMs() const { return worstMs; } // Largest deviation from the period
+    // One line summary and the histogram, one line per used bucket
+    void Format(char *buf, size_t size) const;
+
+private:
+    static const int BUCKETS = 101;        // -5 ms to +5 ms around the period
+    static constexpr double BUCKET_MS = 0.1;
+
+    void Record(TClock::time_point now);
+
+    double periodSeconds;
+    TClock::duration period;          // Rounded to the clock, for comparisons
+    TClock::time_point start, last;
+    int64_t due = 0;                  // Frames since start
+    TClock::duration margin;          // Woken this early to spin the rest
+    bool haveLast = false;
+
+    long frames = 0, late = 0;
+    double sumMs = 0, sumSqMs = 0, worstMs = 0;
+    long histogram[BUCKETS] = {};
+};
+
+#endif //TANKS2_PACER_H
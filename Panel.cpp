@@ -0,0 +1,193 @@
+//
+// Message boxes and menus laid out and drawn into a texture once.
+//
+
+#include "Panel.h"
+#include <algorithm>
+
+const int PANEL_PADDING = 8;  // Between the text and the edge of the box
+const int LINE_SPACING = 5;   // Added to the font's own line height
+
+TPanel::TPanel(TTF_Font *font, SDL_Color textColor, SDL_Color backColor)
+    : font(font), textColor(textColor), backColor(backColor)
+{
+}
+
+void TPanel::Invalidate()
+{
+    if (texture != nullptr)
+        SDL_DestroyTexture(texture);
+    texture = nullptr;
+    textureRenderer = nullptr;
+}
+
+void TPanel::SetText(const std::string &newText, int newW, int newH)
+{
+    if (newText == text && items.empty() && newW == w && newH == h)
+        return;
+    text = newText;
+    items.clear();
+    w = newW;
+    h = newH;
+    selected = -1;
+    Layout();
+}
+
+void TPanel::SetMenu(const std::string &title, const std::vector<std::string> &newItems, int newW,
+                     int newH)
+{
+    if (title == text && newItems == items && newW == w && newH == h)
+        return;
+    text = title;
+    items = newItems;
+    w = newW;
+    h = newH;
+    selected = items.empty() ? -1 : 0;
+    Layout();
+}
+
+void TPanel::SetColors(SDL_Color text, SDL_Color back)
+{
+    auto same = [](SDL_Color a, SDL_Color b) {
+        return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    };
+    if (same(text, textColor) && same(back, backColor))
+        return;
+    textColor = text;
+    backColor = back;
+    stale = true;
+}
+
+void TPanel::MoveSelection(int delta)
+{
+    const int n = ItemCount();
+    if (n > 0)
+        selected = ((selected + delta) % n + n) % n;
+}
+
+/****************************************************************************
+ * Break text into lines that fit the box: at every '\n', and at the last
+ * space that keeps a line inside the padding. A word wider than the box
+ * gets a line of its own.
+ ***************************************************************************/
+void TPanel::Wrap(const std::string &source, std::vector<std::string> &out) const
+{
+    const int maxWidth = std::max(1, w - 2 * PANEL_PADDING);
+    size_t start = 0;
+    while (start <= source.size()) {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos)
+            end = source.size();
+        const std::string paragraph = source.substr(start, end - start);
+
+        std::string line;
+        size_t pos = 0;
+        while (pos < paragraph.size()) {
+            size_t space = paragraph.find(' ', pos);
+            if (space == std::string::npos)
+                space = paragraph.size();
+            const std::string word = paragraph.substr(pos, space - pos);
+            const std::string candidate = line.empty() ? word : line + " " + word;
+            int width = 0;
+            if (font != nullptr)
+                TTF_SizeText(font, candidate.c_str(), &width, nullptr);
+            if (width > maxWidth && !line.empty()) {
+                out.push_back(line);
+                line = word;
+            } else {
+                line = candidate;
+            }
+            pos = space + 1;
+        }
+        out.push_back(line);
+        start = end + 1;
+    }
+}
+
+/****************************************************************************
+ * Wrap the title and items and place them, the whole block centred in the
+ * box.
+ ***************************************************************************/
+void TPanel::Layout()
+{
+    lines.clear();
+    lineY.clear();
+    itemRects.clear();
+    stale = true;
+
+    const int lineHeight = (font != nullptr ? TTF_FontLineSkip(font) : 24) + LINE_SPACING;
+    if (!text.empty())
+        Wrap(text, lines);
+    std::vector<int> firstLine;
+    for (const std::string &item : items) {
+        if (!lines.empty() && firstLine.empty())
+            lines.emplace_back(); // A gap between the title and the items
+        firstLine.push_back((int)lines.size());
+        Wrap(item, lines);
+    }
+    firstLine.push_back((int)lines.size());
+
+    const int total = (int)lines.size() * lineHeight - LINE_SPACING;
+    const int top = std::max(PANEL_PADDING, (h - total) / 2);
+    for (size_t i = 0; i < lines.size(); i++)
+        lineY.push_back(top + (int)i * lineHeight);
+    for (size_t i = 0; i < items.size(); i++) {
+        const int y = top + firstLine[i] * lineHeight - LINE_SPACING / 2;
+        const int rows = firstLine[i + 1] - firstLine[i];
+        itemRects.push_back({PANEL_PADDING, y, w - 2 * PANEL_PADDING, rows * lineHeight});
+    }
+}
+
+/****************************************************************************
+ * Draw the background and every line into a surface and turn it into the
+ * panel's texture.
+ ***************************************************************************/
+bool TPanel::Rasterize(SDL_Renderer *renderer)
+{
+    Invalidate();
+    stale = false;
+    if (w <= 0 || h <= 0)
+        return false;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr)
+        return false;
+    SDL_FillRect(surface, nullptr,
+                 SDL_MapRGBA(surface->format, backColor.r, backColor.g, backColor.b, backColor.a));
+    for (size_t i = 0; i < lines.size() && font != nullptr; i++) {
+        if (lines[i].empty())
+            continue;
+        SDL_Surface *line = TTF_RenderText_Blended(font, lines[i].c_str(), textColor);
+        if (line == nullptr)
+            continue;
+        SDL_Rect at = {(w - line->w) / 2, lineY[i], line->w, line->h};
+        SDL_BlitSurface(line, nullptr, surface, &at);
+        SDL_FreeSurface(line);
+    }
+    texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (texture == nullptr)
+        return false;
+    textureRenderer = renderer;
+    rebuilds++;
+    return true;
+}
+
+void TPanel::Draw(SDL_Renderer *renderer, const SDL_Rect &dst)
+{
+    if ((stale || texture == nullptr || textureRenderer != renderer) && !Rasterize(renderer))
+        return;
+    SDL_RenderCopy(renderer, texture, nullptr, &dst);
+    if (selected < 0 || w <= 0 || h <= 0)
+        return;
+
+    // The selection bar, mapped from panel to destination pixels
+    const SDL_Rect &r = itemRects[selected];
+    SDL_Rect bar = {dst.x + r.x * dst.w / w, dst.y + r.y * dst.h / h, r.w * dst.w / w,
+                    r.h * dst.h / h};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 80);
+    SDL_RenderFillRect(renderer, &bar);
+    SDL_SetRenderDrawColor(renderer, textColor.r, textColor.g, textColor.b, 255);
+    SDL_RenderDrawRect(renderer, &bar);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
@@ -0,0 +1,74 @@
+//
+// Message boxes and menus laid out and drawn into a texture once.
+//
+
+#ifndef TANKS2_PANEL_H
+#define TANKS2_PANEL_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+#include <vector>
+
+/****************************************************************************
+ * A box of text, optionally followed by a list of items to choose from.
+ * The text is word wrapped to the box width and every line is rasterized
+ * into one texture the first time the panel is drawn; after that a redraw
+ * is a single copy until the text, the size or the renderer changes.
+ * Setting the same text again is free, so callers may set it every frame.
+ *
+ * Moving the selection does not redraw the texture either: the selected
+ * item is marked with a translucent bar drawn over it.
+ *
+ * Sizes are in game pixels. Draw() stretches the texture to the
+ * destination, so the same panel serves every window size.
+ ***************************************************************************/
+class TPanel {
+public:
+    TPanel(TTF_Font *font, SDL_Color textColor, SDL_Color backColor);
+    ~TPanel() { Invalidate(); }
+    TPanel(const TPanel &) = delete;
+    TPanel &operator=(const TPanel &) = delete;
+
+    // Text only. '\n' starts a new line; longer lines wrap at spaces.
+    void SetText(const std::string &text, int w, int h);
+    // A title followed by one line per item, the first one selected
+    void SetMenu(const std::string &title, const std::vector<std::string> &items, int w, int h);
+    void SetColors(SDL_Color text, SDL_Color back);
+
+    int ItemCount() const { return (int)items.size(); }
+    int Selected() const { return selected; }
+    // Move the selection by delta items, wrapping around
+    void MoveSelection(int delta);
+    // Select an item, or none with -1
+    void Select(int item) { selected = item >= 0 && item < ItemCount() ? item : -1; }
+
+    void Draw(SDL_Renderer *renderer, const SDL_Rect &dst);
+    // Drop the texture, e.g. before its renderer goes
+    void Invalidate();
+    int Rebuilds() const { return rebuilds; }
+
+private:
+    void Layout();
+    void Wrap(const std::string &text, std::vector<std::string> &out) const;
+    bool Rasterize(SDL_Renderer *renderer);
+
+    TTF_Font *font;
+    SDL_Color textColor, backColor;
+    std::string text;
+    std::vector<std::string> items;
+    int w = 0, h = 0;
+    int selected = -1;
+
+    // Layout: wrapped lines, their top in the panel, and each item's bar
+    std::vector<std::string> lines;
+    std::vector<int> lineY;
+    std::vector<SDL_Rect> itemRects;
+
+    SDL_Texture *texture = nullptr;
+    SDL_Renderer *textureRenderer = nullptr;
+    bool stale = true; // Layout changed since the texture was made
+    int rebuilds = 0;
+};
+
+#endif //TANKS2_PANEL_H
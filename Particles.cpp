@@ -0,0 +1,147 @@
+//
+// Decorative particles: debris, smoke and bullet trails.
+//
+
+#include "Particles.h"
+#include <algorithm>
+#include <cmath>
+
+const float PARTICLE_DRAG = 1.5f; // Share of speed lost per second, roughly
+
+TParticles::TParticles(int capacity)
+{
+    x.resize(capacity);
+    y.resize(capacity);
+    vx.resize(capacity);
+    vy.resize(capacity);
+    age.resize(capacity);
+    life.resize(capacity);
+    size.resize(capacity);
+    grow.resize(capacity);
+    lift.resize(capacity);
+    color.resize(capacity);
+}
+
+float TParticles::Random()
+{
+    rnd = rnd * 1103515245u + 12345u;
+    return (float)((rnd >> 8) & 0xFFFF) / 65536.0f;
+}
+
+void TParticles::Emit(float px, float py, float pvx, float pvy, float plife, float psize,
+                      float pgrow, float plift, uint32_t rgba)
+{
+    if (count == Capacity())
+        return;
+    const int i = count++;
+    x[i] = px;
+    y[i] = py;
+    vx[i] = pvx;
+    vy[i] = pvy;
+    age[i] = 0;
+    life[i] = plife;
+    size[i] = psize;
+    grow[i] = pgrow;
+    lift[i] = plift;
+    color[i] = rgba;
+}
+
+/****************************************************************************
+ * Fragments flying out in all directions and falling, for hits.
+ ***************************************************************************/
+void TParticles::Debris(float px, float py, int amount, uint32_t rgb)
+{
+    for (int i = 0; i < amount; i++) {
+        float angle = Random() * 6.2831853f;
+        float speed = 40 + Random() * 160;
+        Emit(px, py, std::cos(angle) * speed, std::sin(angle) * speed - 60, 0.4f + Random() * 0.6f,
+             2 + Random() * 2, 0, 300, rgb << 8 | 0xFF);
+    }
+}
+
+/****************************************************************************
+ * Grey puffs that drift up and spread, for burning wrecks and after hits.
+ ***************************************************************************/
+void TParticles::Smoke(float px, float py, int amount)
+{
+    for (int i = 0; i < amount; i++) {
+        uint32_t grey = 70 + (uint32_t)(Random() * 60);
+        Emit(px + (Random() - 0.5f) * 10, py + (Random() - 0.5f) * 10, (Random() - 0.5f) * 20,
+             -10 - Random() * 20, 1.5f + Random() * 1.5f, 4 + Random() * 3, 8, -15,
+             grey << 24 | grey << 16 | grey << 8 | 0x90);
+    }
+}
+
+// A short-lived puff left behind a moving bullet
+void TParticles::Trail(float px, float py)
+{
+    Emit(px, py, (Random() - 0.5f) * 6, (Random() - 0.5f) * 6, 0.3f + Random() * 0.2f, 2, 6, 0,
+         0xC8C8C870);
+}
+
+/****************************************************************************
+ * One pass over every particle, all float fields and restrict pointers, so
+ * it vectorizes like the bullet step.
+ ***************************************************************************/
+static void UpdateKernel(int n, float dt, float drag, float *__restrict px, float *__restrict py,
+                         float *__restrict pvx, float *__restrict pvy, float *__restrict page,
+                         float *__restrict psize, const float *__restrict pgrow,
+                         const float *__restrict plift)
+{
+    for (int i = 0; i < n; i++) {
+        pvx[i] *= drag;
+        pvy[i] = pvy[i] * drag + plift[i] * dt;
+        px[i] += pvx[i] * dt;
+        py[i] += pvy[i] * dt;
+        page[i] += dt;
+        psize[i] += pgrow[i] * dt;
+    }
+}
+
+void TParticles::Update(float dt)
+{
+    UpdateKernel(count, dt, std::exp(-PARTICLE_DRAG * dt), x.data(), y.data(), vx.data(), vy.data(),
+                 age.data(), size.data(), grow.data(), lift.data());
+    for (int i = 0; i < count;) {
+        if (age[i] < life[i]) {
+            i++;
+            continue;
+        }
+        const int last = --count;
+        x[i] = x[last];
+        y[i] = y[last];
+        vx[i] = vx[last];
+        vy[i] = vy[last];
+        age[i] = age[last];
+        life[i] = life[last];
+        size[i] = size[last];
+        grow[i] = grow[last];
+        lift[i] = lift[last];
+        color[i] = color[last];
+    }
+}
+
+int TParticles::BuildQuads(float scale, float offsetX, float offsetY,
+                           TParticleVerts &verts, TParticleIndices &indices) const
+{
+    verts.resize((size_t)count * 4);
+    // The index pattern never changes, so only the part not yet made is added
+    for (int q = (int)indices.size() / 6; q < count; q++) {
+        const int v = q * 4;
+        indices.insert(indices.end(), {v, v + 1, v + 2, v + 2, v + 1, v + 3});
+    }
+    for (int i = 0; i < count; i++) {
+        const uint32_t c = color[i];
+        const float fade = std::max(0.0f, 1.0f - age[i] / life[i]);
+        const uint8_t r = (uint8_t)(c >> 24), g = (uint8_t)(c >> 16), b = (uint8_t)(c >> 8);
+        const uint8_t a = (uint8_t)((float)(c & 0xFF) * fade);
+        const float half = size[i] * scale * 0.5f;
+        const float cx = offsetX + x[i] * scale, cy = offsetY + y[i] * scale;
+        TParticleVertex *q = &verts[(size_t)i * 4];
+        q[0] = {cx - half, cy - half, r, g, b, a, 0, 0};
+        q[1] = {cx + half, cy - half, r, g, b, a, 0, 0};
+        q[2] = {cx - half, cy + half, r, g, b, a, 0, 0};
+        q[3] = {cx + half, cy + half, r, g, b, a, 0, 0};
+    }
+    return count;
+}
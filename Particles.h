@@ -0,0 +1,67 @@
+//
+// Decorative particles: debris, smoke and bullet trails.
+//
+
+#ifndef TANKS2_PARTICLES_H
+#define TANKS2_PARTICLES_H
+
+#include <cstdint>
+#include "Memory.h"
+
+const int PARTICLE_CAPACITY = 1 << 17;
+
+// Laid out like SDL_Vertex, so the front end can pass an array of them
+// straight to SDL_RenderGeometry without copying
+struct TParticleVertex {
+    float x, y;
+    uint8_t r, g, b, a;
+    float u, v;
+};
+
+using TParticleVerts = TTagVector<TParticleVertex, MEM_PARTICLES>;
+using TParticleIndices = TTagVector<int, MEM_PARTICLES>;
+
+/****************************************************************************
+ * A fixed pool of particles, one array per field. Nothing is allocated
+ * after construction; when the pool is full new particles are dropped.
+ * Update() moves every particle in one branch-free pass the compiler
+ * vectorizes, then removes the expired ones by moving the last particle
+ * into their place, since drawing order does not matter for them.
+ *
+ * Particles are pure decoration and live on the window side. They have
+ * their own random numbers and never touch a match, so the simulation
+ * stays the same with or without them.
+ ***************************************************************************/
+class TParticles {
+public:
+    explicit TParticles(int capacity = PARTICLE_CAPACITY);
+
+    int Count() const { return count; }
+    int Capacity() const { return (int)x.size(); }
+    void Clear() { count = 0; }
+
+    // Effects, at a position in play area coordinates. Colours are 0xRRGGBB.
+    void Debris(float px, float py, int amount, uint32_t rgb);
+    void Smoke(float px, float py, int amount);
+    void Trail(float px, float py);
+
+    // Advance by dt seconds
+    void Update(float dt);
+    // Fill verts with four corners per particle, mapped to the window by
+    // scale and offset, and indices with two triangles each. Returns the
+    // number of particles written.
+    int BuildQuads(float scale, float offsetX, float offsetY, TParticleVerts &verts,
+                   TParticleIndices &indices) const;
+
+private:
+    void Emit(float px, float py, float pvx, float pvy, float plife, float psize, float pgrow,
+              float plift, uint32_t rgba);
+    float Random(); // 0 to 1
+
+    int count = 0;
+    uint32_t rnd = 12345;
+    TTagVector<float, MEM_PARTICLES> x, y, vx, vy, age, life, size, grow, lift;
+    TTagVector<uint32_t, MEM_PARTICLES> color; // 0xRRGGBBAA at birth, fading out with age
+};
+
+#endif //TANKS2_PARTICLES_H
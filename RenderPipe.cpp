@@ -0,0 +1,112 @@
+//
+// Hand-off of finished ticks from the simulation thread to the renderer.
+//
+
+#include "RenderPipe.h"
+#include <algorithm>
+#include <cstdio>
+
+static void CopyScreen(const TItemList &from, int screen, TRenderList &to)
+{
+    to.clear();
+    for (const TItemRec &item : from)
+        if (item.screen == screen)
+            to.push_back(item);
+}
+
+// The live bullets are turned into items only here, for the screen shown
+static void CopyScreen(const TBullets &from, int screen, TRenderList &to)
+{
+    to.clear();
+    for (size_t i = 0; i < from.Size(); i++)
+        if (from.screen[i] == screen)
+            to.push_back(from.Item(i));
+}
+
+/****************************************************************************
+ * Counting sort of n items, screenOf(i) and itemAt(i) giving the screen and
+ * the item of the i-th, so lists and the bullet arrays share it.
+ ***************************************************************************/
+template <typename TScreenOf, typename TItemAt>
+static void FillBuckets(TScreenBuckets &b, size_t n, int screenCount, TScreenOf screenOf,
+                        TItemAt itemAt)
+{
+    // Count, then turn the counts into the end of each screen's range
+    b.start.assign(screenCount + 1, 0);
+    for (size_t i = 0; i < n; i++)
+        b.start[screenOf(i)]++;
+    for (int s = 1; s <= screenCount; s++)
+        b.start[s] += b.start[s - 1];
+    // Fill each range from its end, which leaves start[s] at its beginning
+    // and keeps the items of a screen in their original order
+    b.items.resize(n);
+    for (size_t i = n; i-- > 0;)
+        b.items[--b.start[screenOf(i)]] = itemAt(i);
+}
+
+void TScreenBuckets::Fill(const TItemList &from, int screenCount)
+{
+    FillBuckets(*this, from.size(), screenCount, [&](size_t i) { return from[i].screen; },
+                [&](size_t i) { return from[i]; });
+}
+
+void TScreenBuckets::Fill(const TBullets &from, int screenCount)
+{
+    FillBuckets(*this, from.Size(), screenCount, [&](size_t i) { return from.screen[i]; },
+                [&](size_t i) { return from.Item(i); });
+}
+
+void CaptureFrame(const Match &match, TRenderFrame &frame, bool allScreens)
+{
+    frame.curScrn = match.curScrn;
+    frame.screenCount = match.ScreenCount();
+    frame.score = match.score;
+    frame.result = match.CheckGameOver();
+    frame.wallsVersion = match.wallsVersion;
+    CopyScreen(match.tanksList, match.curScrn, frame.tanks);
+    CopyScreen(match.bullets, match.curScrn, frame.bullets);
+    CopyScreen(match.explosionList, match.curScrn, frame.explosions);
+    CopyScreen(match.blocksList, match.curScrn, frame.blocks);
+    CopyScreen(match.treeList, match.curScrn, frame.trees);
+    frame.events.assign(match.events.begin(), match.events.end());
+
+    frame.allScreens = allScreens;
+    if (!allScreens)
+        return;
+    const int screens = match.ScreenCount();
+    frame.screenCols = match.screenCols;
+    frame.screenRows = match.screenRows;
+    frame.allTanks.Fill(match.tanksList, screens);
+    frame.allBullets.Fill(match.bullets, screens);
+    frame.allExplosions.Fill(match.explosionList, screens);
+    if (frame.allWallsVersion != match.wallsVersion || frame.allBlocks.Screens() != screens) {
+        frame.allBlocks.Fill(match.blocksList, screens);
+        frame.allTrees.Fill(match.treeList, screens);
+        frame.allWallsVersion = match.wallsVersion;
+    }
+}
+
+void TPipelineStats::Shown(const TRenderFrame &frame, double renderMs)
+{
+    double latency = std::chrono::duration<double, std::milli>(TRenderClock::now() -
+                                                                frame.published).count();
+    if (shown > 0 && frame.tick > lastTick + 1)
+        skipped += frame.tick - lastTick - 1;
+    lastTick = frame.tick;
+    shown++;
+    latencySum += latency;
+    latencyMax = std::max(latencyMax, latency);
+    simSum += frame.simMs;
+    renderSum += renderMs;
+}
+
+void TPipelineStats::Format(char *buf, size_t size) const
+{
+    if (shown == 0) {
+        snprintf(buf, size, "no frames shown");
+        return;
+    }
+    snprintf(buf, size, "%ld frames shown, %ld ticks never shown; tick %.2f ms, draw %.2f ms, "
+             "tick to screen %.1f ms average, %.1f ms worst",
+             shown, skipped, simSum / shown, renderSum / shown, latencySum / shown, latencyMax);
+}
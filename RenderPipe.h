@@ -0,0 +1,145 @@
+//
+// Hand-off of finished ticks from the simulation thread to the renderer.
+//
+
+#ifndef TANKS2_RENDERPIPE_H
+#define TANKS2_RENDERPIPE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "Match.h"
+
+using TRenderClock = std::chrono::steady_clock;
+// Lists in render frames, counted as render memory
+using TRenderList = TTagVector<TItemRec, MEM_RENDER>;
+
+/****************************************************************************
+ * Items of every screen grouped by screen, screen s being [Begin(s), End(s)).
+ * Filled with a counting sort, two linear passes whatever the number of
+ * screens, so a view of all screens touches each item once per frame.
+ ***************************************************************************/
+struct TScreenBuckets {
+    TRenderList items;
+    TTagVector<int, MEM_RENDER> start; // screenCount + 1 offsets into items
+
+    void Fill(const TItemList &from, int screenCount);
+    void Fill(const TBullets &from, int screenCount);
+    int Screens() const { return start.empty() ? 0 : (int)start.size() - 1; }
+    const TItemRec *Begin(int s) const { return items.data() + start[s]; }
+    const TItemRec *End(int s) const { return items.data() + start[s + 1]; }
+};
+
+/****************************************************************************
+ * What the renderer needs from one tick: everything on the screen being
+ * shown plus the status bar. Filled by the simulation thread and never
+ * changed once published, so drawing needs no access to the Match.
+ ***************************************************************************/
+struct TRenderFrame {
+    uint32_t tick = 0;
+    int curScrn = 0;
+    int screenCount = 0;
+    double score = 0;
+    int result = 0;      // CheckGameOver() after the tick
+    uint32_t wallsVersion = 0; // The match's, changes whenever its walls do
+    bool synced = true;  // False while a network client waits for the server
+    // Items on curScrn only
+    TRenderList tanks, bullets, explosions, blocks, trees;
+    TTagVector<TGameEvent, MEM_RENDER> events; // Of this tick, all screens
+
+    // Every screen, only filled when captured for an overview
+    bool allScreens = false;
+    int screenCols = 0, screenRows = 0;
+    TScreenBuckets allTanks, allBullets, allExplosions;
+    // Walls and trees are only copied again when the match rebuilt its walls
+    uint32_t allWallsVersion = 0;
+    TScreenBuckets allBlocks, allTrees;
+
+    TRenderClock::time_point published; // When the tick finished
+    double simMs = 0;                     // Cost of the tick
+};
+
+// Copy the current screen of a match into a frame, reusing its storage.
+// With allScreens every screen is copied as well.
+void CaptureFrame(const Match &match, TRenderFrame &frame, bool allScreens = false);
+
+/****************************************************************************
+ * Lock-free triple buffer for one producer and one consumer. The producer
+ * fills Back() and publishes it; the consumer picks up the newest published
+ * slot, if any, and draws Front() for as long as it likes. Neither side
+ * ever waits for the other. Frames the consumer was too slow to pick up
+ * are overwritten.
+ ***************************************************************************/
+template <typename T>
+class TTripleBuffer {
+public:
+    T &Back() { return slots[back]; }
+    void Publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+    // Take the newest published slot. False if nothing new was published.
+    bool Acquire()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T &Front() const { return slots[front]; }
+
+private:
+    static const int INDEX = 3, FRESH = 4;
+    T slots[3];
+    int back = 0, front = 1;        // Owned by the producer / consumer
+    std::atomic<int> middle{2};     // Slot index, FRESH when not yet taken
+};
+
+/****************************************************************************
+ * Single producer, single consumer queue of bytes, used for key presses
+ * going to the simulation thread. Push() drops the byte when full.
+ ***************************************************************************/
+class TByteQueue {
+public:
+    bool Push(uint8_t b)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= SIZE)
+            return false;
+        data[t % SIZE] = b;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    bool Pop(uint8_t &b)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        b = data[h % SIZE];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static const uint32_t SIZE = 256;
+    uint8_t data[SIZE];
+    std::atomic<uint32_t> head{0}, tail{0};
+};
+
+/****************************************************************************
+ * Latency accounting for the pipeline. Called by the renderer once a frame
+ * is on screen; latency runs from the end of its tick to that point.
+ ***************************************************************************/
+class TPipelineStats {
+public:
+    void Shown(const TRenderFrame &frame, double renderMs);
+    // One line summary, e.g. for the log on exit
+    void Format(char *buf, size_t size) const;
+
+private:
+    long shown = 0, skipped = 0;
+    uint32_t lastTick = 0;
+    double latencySum = 0, latencyMax = 0;
+    double simSum = 0, renderSum = 0;
+};
+
+#endif //TANKS2_RENDERPIPE_H
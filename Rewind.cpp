@@ -0,0 +1,172 @@
+//
+// Rewind history of world states.
+//
+
+#include "Rewind.h"
+#include "Snapshot.h"
+#include <chrono>
+#include <cstring>
+
+/****************************************************************************
+ * budgetBytes  - Size of the history ring. Old history is dropped, one
+ *                keyframe group at a time, to stay within it.
+ * keyframeInterval - Ticks between full snapshots. This bounds the number
+ *                of deltas replayed by a rewind.
+ * maxFrames    - Maximum number of ticks kept.
+ ***************************************************************************/
+TRewindBuffer::TRewindBuffer(size_t budgetBytes, int keyframeInterval, int maxFrames)
+    : ring(budgetBytes), frames(maxFrames > 0 ? maxFrames : 1),
+      keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1)
+{
+}
+
+/****************************************************************************
+ * Forget all history, e.g. when a new game is started.
+ ***************************************************************************/
+void TRewindBuffer::Clear()
+{
+    firstFrame = 0;
+    frameCount = 0;
+    sinceKeyframe = 0;
+    writePos = 0;
+    bytesUsed = 0;
+    prevState.clear();
+}
+
+/****************************************************************************
+ * Average stored bytes per tick of history.
+ ***************************************************************************/
+double TRewindBuffer::BytesPerTick() const
+{
+    return frameCount > 0 ? (double)bytesUsed / frameCount : 0.0;
+}
+
+/****************************************************************************
+ * Record the state at the end of a tick.
+ ***************************************************************************/
+void TRewindBuffer::Record(const TWorld &world)
+{
+    SaveSnapshot(world, curState, 0);
+
+    bool keyframe = (frameCount == 0) || (sinceKeyframe + 1 >= keyframeInterval);
+    if (!keyframe) {
+        EncodeSnapshotDelta(prevState.data(), prevState.size(), curState.data(), curState.size(), encoded);
+        if (Store(encoded.data(), encoded.size(), false))
+            sinceKeyframe++;
+        else
+            keyframe = true; // The delta's keyframe would have been dropped
+    }
+    if (keyframe) {
+        if (Store(curState.data(), curState.size(), true))
+            sinceKeyframe = 0;
+        else
+            Clear(); // Larger than the whole budget
+    }
+    prevState.swap(curState);
+}
+
+/****************************************************************************
+ * Restore the state recorded the given number of ticks before the latest
+ * one. History newer than the restored tick is discarded, so recording
+ * continues from there. Rewinding further than the history reaches
+ * restores the oldest tick kept.
+ ***************************************************************************/
+bool TRewindBuffer::Rewind(TWorld &world, int ticks)
+{
+    if (frameCount == 0)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+
+    int target = frameCount - 1 - (ticks > 0 ? ticks : 0);
+    if (target < 0)
+        target = 0;
+    int key = target;
+    while (!FrameAt(key).keyframe)
+        key--;
+
+    const TFrame &keyFrame = FrameAt(key);
+    curState.assign(ring.data() + keyFrame.offset, ring.data() + keyFrame.offset + keyFrame.size);
+    for (int i = key + 1; i <= target; i++) {
+        const TFrame &frame = FrameAt(i);
+        ApplySnapshotDelta(curState, ring.data() + frame.offset, frame.size);
+    }
+    if (!RestoreSnapshot(world, curState.data(), curState.size()))
+        return false;
+
+    // Drop the newer history
+    for (int i = target + 1; i < frameCount; i++)
+        bytesUsed -= FrameAt(i).size;
+    const TFrame &last = FrameAt(target);
+    writePos = last.offset + last.size;
+    frameCount = target + 1;
+    sinceKeyframe = target - key;
+    prevState.swap(curState);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    lastRewindUs = std::chrono::duration<double, std::micro>(elapsed).count();
+    return true;
+}
+
+/****************************************************************************
+ * Drop the oldest keyframe together with the deltas that depend on it.
+ ***************************************************************************/
+void TRewindBuffer::DropOldestGroup()
+{
+    do {
+        bytesUsed -= FrameAt(0).size;
+        firstFrame = (firstFrame + 1) % (int)frames.size();
+        frameCount--;
+    } while (frameCount > 0 && !FrameAt(0).keyframe);
+}
+
+/****************************************************************************
+ * Copy a frame into the ring, dropping old history to make room. A delta is
+ * refused if making room would drop the keyframe it is based on.
+ ***************************************************************************/
+bool TRewindBuffer::Store(const uint8_t *data, size_t size, bool keyframe)
+{
+    if (size > ring.size())
+        return false;
+
+    int groups = 0;
+    for (int i = 0; i < frameCount; i++)
+        groups += FrameAt(i).keyframe ? 1 : 0;
+
+    auto dropGroup = [&]() {
+        if (!keyframe && groups <= 1)
+            return false;
+        DropOldestGroup();
+        groups--;
+        return true;
+    };
+
+    if (frameCount == (int)frames.size() && !dropGroup())
+        return false;
+
+    size_t pos = writePos;
+    if (pos + size > ring.size()) {
+        // Wrap around; frames stored past writePos are the oldest ones.
+        while (frameCount > 0 && FrameAt(0).offset >= pos)
+            if (!dropGroup())
+                return false;
+        pos = 0;
+    }
+    while (frameCount > 0) {
+        const TFrame &oldest = FrameAt(0);
+        bool overlaps = (oldest.offset < pos + size) && (pos < oldest.offset + oldest.size);
+        if (!overlaps)
+            break;
+        if (!dropGroup())
+            return false;
+    }
+
+    memcpy(ring.data() + pos, data, size);
+    TFrame &frame = frames[(firstFrame + frameCount) % frames.size()];
+    frame.offset = (uint32_t)pos;
+    frame.size = (uint32_t)size;
+    frame.keyframe = keyframe;
+    frameCount++;
+    bytesUsed += size;
+    writePos = pos + size;
+    return true;
+}
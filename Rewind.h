@@ -0,0 +1,64 @@
+//
+// Rewind history of world states.
+//
+
+#ifndef TANKS2_REWIND_H
+#define TANKS2_REWIND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Memory.h"
+#include "World.h"
+
+class Match;
+
+/****************************************************************************
+ * Ring buffer of per-tick world states kept within a fixed memory budget.
+ * Every keyframeInterval ticks a full snapshot of the moving entities is
+ * stored; the ticks in between hold only the 32 bit words that changed
+ * since the previous tick (see EncodeSnapshotDelta). Walls and trees are
+ * not recorded.
+ ***************************************************************************/
+class TRewindBuffer {
+public:
+    explicit TRewindBuffer(size_t budgetBytes = 2 * 1024 * 1024, int keyframeInterval = 14,
+                           int maxFrames = 8192);
+
+    void Clear();
+    void Record(const TWorld &world);
+    void Record(const Match &match) = delete; // Record match.Synced()
+    bool Rewind(TWorld &world, int ticks);
+
+    int Depth() const { return frameCount; }
+    size_t BytesUsed() const { return bytesUsed; }
+    size_t Budget() const { return ring.size(); }
+    double BytesPerTick() const;
+    double LastRewindMicros() const { return lastRewindUs; }
+
+private:
+    struct TFrame {
+        uint32_t offset;
+        uint32_t size;
+        bool keyframe;
+    };
+
+    TTagVector<uint8_t, MEM_REWIND> ring;
+    TTagVector<TFrame, MEM_REWIND> frames;
+    int keyframeInterval;
+    int firstFrame = 0;     // Oldest frame in the frames ring
+    int frameCount = 0;
+    int sinceKeyframe = 0;
+    size_t writePos = 0;
+    size_t bytesUsed = 0;
+    double lastRewindUs = 0;
+    std::vector<uint8_t> prevState;
+    std::vector<uint8_t> curState;
+    std::vector<uint8_t> encoded;
+
+    const TFrame &FrameAt(int n) const { return frames[(firstFrame + n) % frames.size()]; }
+    void DropOldestGroup();
+    bool Store(const uint8_t *data, size_t size, bool keyframe);
+};
+
+#endif //TANKS2_REWIND_H
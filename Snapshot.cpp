@@ -0,0 +1,316 @@
+//
+// Versioned binary snapshots of the game world.
+//
+
+#include "Snapshot.h"
+#include "Match.h"
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+static_assert(sizeof(TSnapshotHeader) == 64, "Snapshot header layout changed");
+static_assert(sizeof(TItemRec) == 28, "TItemRec layout changed, bump SNAPSHOT_VERSION");
+static_assert(std::is_trivially_copyable<TItemRec>::value, "TItemRec must be trivially copyable");
+
+const int LIST_COUNT = 5;
+const int DYNAMIC_LIST_COUNT = 3; // bullets, tanks, explosions
+
+/****************************************************************************
+ * Lists in the order they appear in the snapshot.
+ ***************************************************************************/
+static void GetLists(const TWorld &world, const TItemList *lists[LIST_COUNT])
+{
+    lists[0] = &world.bulletList;
+    lists[1] = &world.tanksList;
+    lists[2] = &world.explosionList;
+    lists[3] = &world.blocksList;
+    lists[4] = &world.treeList;
+}
+
+/****************************************************************************
+ * Number of bytes SaveSnapshot() will write for the given world.
+ ***************************************************************************/
+size_t SnapshotSize(const TWorld &world, uint16_t flags)
+{
+    const TItemList *lists[LIST_COUNT];
+    GetLists(world, lists);
+    int listCount = (flags & SNAP_STATIC) ? LIST_COUNT : DYNAMIC_LIST_COUNT;
+
+    size_t size = sizeof(TSnapshotHeader);
+    for (int i = 0; i < listCount; i++)
+        size += lists[i]->size() * sizeof(TItemRec);
+    return size;
+}
+
+/****************************************************************************
+ * Write the world into one contiguous buffer. The buffer is resized to fit,
+ * so reusing the same buffer avoids any allocation once it has grown.
+ * Returns the number of bytes written.
+ ***************************************************************************/
+size_t SaveSnapshot(const TWorld &world, std::vector<uint8_t> &buffer, uint16_t flags)
+{
+    const TItemList *lists[LIST_COUNT];
+    GetLists(world, lists);
+    int listCount = (flags & SNAP_STATIC) ? LIST_COUNT : DYNAMIC_LIST_COUNT;
+
+    size_t size = SnapshotSize(world, flags);
+    buffer.resize(size);
+
+    TSnapshotHeader header = {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.flags = flags;
+    header.totalSize = (uint32_t)size;
+    header.rngState = world.rngState;
+    header.score = world.score;
+    header.curScrn = world.curScrn;
+    header.blueCount = world.blueCount;
+    header.redCount = world.redCount;
+    header.leftCnt = (int16_t)world.leftCnt;
+    header.rightCnt = (int16_t)world.rightCnt;
+    header.screenCols = (int16_t)world.screenCols;
+    header.screenRows = (int16_t)world.screenRows;
+    for (int i = 0; i < listCount; i++)
+        header.counts[i] = (uint32_t)lists[i]->size();
+
+    uint8_t *p = buffer.data();
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    for (int i = 0; i < listCount; i++) {
+        size_t bytes = lists[i]->size() * sizeof(TItemRec);
+        if (bytes > 0)
+            memcpy(p, lists[i]->data(), bytes);
+        p += bytes;
+    }
+    return size;
+}
+
+/****************************************************************************
+ * Whether a record of list i can be used as an index where the game uses
+ * it: screens into per-screen tables, directions and animation frames into
+ * the sprite sheets and the shot offsets.
+ ***************************************************************************/
+static bool ValidRecord(int list, const TItemRec &r, int screens)
+{
+    if (r.screen < 0 || r.screen >= screens)
+        return false;
+    switch (list) {
+    case 0: // Bullets
+        return r.directionIdx >= 0 && r.directionIdx < DIR_COUNT;
+    case 1: // Tanks
+        if (r.color == DeadTank)
+            return r.directionIdx >= 0 && r.directionIdx < DEAD_COUNT;
+        return (r.color == BlueTank || r.color == RedTank) && r.directionIdx >= 0 &&
+               r.directionIdx < DIR_COUNT;
+    case 2: // Explosions
+        return r.directionIdx >= 0 && r.directionIdx < EXP_COUNT;
+    default: // Walls and trees only use the screen
+        return true;
+    }
+}
+
+/****************************************************************************
+ * Load a snapshot back into the world. The lists are resized in place, so
+ * no entity is allocated individually; once the vectors have enough
+ * capacity the restore does not allocate at all.
+ * Returns false, leaving the world untouched, if the data is not a valid
+ * snapshot of this version or any record is out of range for the map it
+ * describes.
+ ***************************************************************************/
+bool RestoreSnapshot(TWorld &world, const uint8_t *data, size_t size)
+{
+    TSnapshotHeader header;
+    if (data == nullptr || size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+        return false;
+
+    int listCount = (header.flags & SNAP_STATIC) ? LIST_COUNT : DYNAMIC_LIST_COUNT;
+    uint64_t expected = sizeof(header);
+    for (int i = 0; i < listCount; i++)
+        expected += (uint64_t)header.counts[i] * sizeof(TItemRec);
+    if (expected != header.totalSize || expected > size)
+        return false;
+    if ((header.flags & SNAP_STATIC) && (header.screenCols < 1 || header.screenRows < 1))
+        return false;
+    const int screens = (header.flags & SNAP_STATIC) ? header.screenCols * header.screenRows
+                                                     : world.ScreenCount();
+    if (header.curScrn < 0 || header.curScrn >= screens)
+        return false;
+    const uint8_t *rec = data + sizeof(header);
+    for (int i = 0; i < listCount; i++) {
+        for (uint32_t k = 0; k < header.counts[i]; k++, rec += sizeof(TItemRec)) {
+            TItemRec r;
+            memcpy(&r, rec, sizeof(r));
+            if (!ValidRecord(i, r, screens))
+                return false;
+        }
+    }
+
+    TItemList *lists[LIST_COUNT] = {
+        &world.bulletList, &world.tanksList, &world.explosionList,
+        &world.blocksList, &world.treeList
+    };
+    const uint8_t *p = data + sizeof(header);
+    for (int i = 0; i < listCount; i++) {
+        size_t bytes = header.counts[i] * sizeof(TItemRec);
+        lists[i]->resize(header.counts[i]);
+        if (bytes > 0)
+            memcpy(lists[i]->data(), p, bytes);
+        p += bytes;
+    }
+
+    world.rngState = header.rngState;
+    world.score = header.score;
+    world.curScrn = header.curScrn;
+    world.blueCount = header.blueCount;
+    world.redCount = header.redCount;
+    world.leftCnt = header.leftCnt;
+    world.rightCnt = header.rightCnt;
+    if (header.flags & SNAP_STATIC) {
+        world.screenCols = header.screenCols;
+        world.screenRows = header.screenRows;
+    }
+    return true;
+}
+
+/****************************************************************************
+ * 64 bit FNV-1a hash of a snapshot. Two worlds that hash the same are in
+ * the same state, which is what desync detection compares.
+ ***************************************************************************/
+uint64_t SnapshotHash(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+/****************************************************************************
+ * Hash of the complete world state.
+ ***************************************************************************/
+uint64_t WorldHash(const TWorld &world)
+{
+    static thread_local std::vector<uint8_t> buffer;
+    size_t size = SaveSnapshot(world, buffer);
+    return SnapshotHash(buffer.data(), size);
+}
+
+/****************************************************************************
+ * Encode the difference between two snapshots of the same world.
+ * Layout: uint32 new size, then runs of
+ *   uint16 unchanged words, uint16 changed words, changed words XOR previous
+ * Words past the end of the previous snapshot are XORed against zero, so an
+ * empty previous snapshot gives a full encoding.
+ ***************************************************************************/
+void EncodeSnapshotDelta(const uint8_t *prev, size_t prevSize, const uint8_t *cur, size_t curSize,
+                         std::vector<uint8_t> &delta)
+{
+    const size_t words = curSize / 4;
+    const size_t prevWords = prevSize / 4;
+    auto word = [](const uint8_t *p, size_t i) {
+        uint32_t w;
+        memcpy(&w, p + i * 4, 4);
+        return w;
+    };
+    auto put = [&delta](const void *p, size_t n) {
+        const uint8_t *b = (const uint8_t *)p;
+        delta.insert(delta.end(), b, b + n);
+    };
+
+    delta.clear();
+    uint32_t newSize = (uint32_t)curSize;
+    put(&newSize, 4);
+
+    size_t i = 0;
+    while (i < words) {
+        uint16_t skip = 0;
+        while (i < words && skip < 0xFFFF && word(cur, i) == (i < prevWords ? word(prev, i) : 0)) {
+            skip++;
+            i++;
+        }
+        size_t countPos = delta.size() + 2;
+        uint16_t count = 0;
+        put(&skip, 2);
+        put(&count, 2);
+        while (i < words && count < 0xFFFF) {
+            uint32_t x = word(cur, i) ^ (i < prevWords ? word(prev, i) : 0);
+            if (x == 0)
+                break;
+            put(&x, 4);
+            count++;
+            i++;
+        }
+        memcpy(delta.data() + countPos, &count, 2);
+    }
+}
+
+/****************************************************************************
+ * Turn the previous snapshot held in state into the next one. Returns false
+ * if the delta is malformed; it may come from the network.
+ ***************************************************************************/
+bool ApplySnapshotDelta(std::vector<uint8_t> &state, const uint8_t *delta, size_t size)
+{
+    const uint32_t maxSize = 64 * 1024 * 1024;
+    uint32_t newSize;
+    if (size < 4)
+        return false;
+    memcpy(&newSize, delta, 4);
+    if (newSize > maxSize || (newSize % 4) != 0)
+        return false;
+    state.resize(newSize);
+
+    const size_t words = newSize / 4;
+    size_t p = 4;
+    size_t i = 0;
+    while (p + 4 <= size) {
+        uint16_t skip, count;
+        memcpy(&skip, delta + p, 2);
+        memcpy(&count, delta + p + 2, 2);
+        p += 4;
+        i += skip;
+        if (i + count > words || p + (size_t)count * 4 > size)
+            return false;
+        for (uint16_t n = 0; n < count; n++, i++, p += 4) {
+            uint32_t w, x;
+            memcpy(&w, state.data() + i * 4, 4);
+            memcpy(&x, delta + p, 4);
+            w ^= x;
+            memcpy(state.data() + i * 4, &w, 4);
+        }
+    }
+    return p == size;
+}
+
+/****************************************************************************
+ * Quick-save helpers.
+ ***************************************************************************/
+bool SaveSnapshotFile(const char *fileName, const TWorld &world)
+{
+    std::vector<uint8_t> buffer;
+    size_t size = SaveSnapshot(world, buffer);
+
+    FILE *f = fopen(fileName, "wb");
+    if (f == nullptr)
+        return false;
+    bool ok = fwrite(buffer.data(), 1, size, f) == size;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+bool LoadSnapshotFile(const char *fileName, TWorld &world)
+{
+    FILE *f = fopen(fileName, "rb");
+    if (f == nullptr)
+        return false;
+    std::vector<uint8_t> buffer;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        buffer.insert(buffer.end(), chunk, chunk + n);
+    fclose(f);
+    return RestoreSnapshot(world, buffer.data(), buffer.size());
+}
@@ -0,0 +1,56 @@
+//
+// Versioned binary snapshots of the game world.
+//
+
+#ifndef TANKS2_SNAPSHOT_H
+#define TANKS2_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "World.h"
+
+const uint32_t SNAPSHOT_MAGIC = 0x534B4E54; // "TNKS"
+const uint16_t SNAPSHOT_VERSION = 3;
+
+// Snapshot flags
+const uint16_t SNAP_STATIC = 0x0001; // Walls and trees are included
+
+/****************************************************************************
+ * Fixed 64 byte header. It is followed by the entity arrays in the order
+ * bullets, tanks, explosions, blocks, trees, each stored as raw TItemRec.
+ ***************************************************************************/
+struct TSnapshotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t totalSize;
+    uint32_t rngState;
+    double score;
+    int32_t curScrn;
+    int32_t blueCount, redCount;
+    int16_t leftCnt, rightCnt;
+    int16_t screenCols, screenRows; // Only read with SNAP_STATIC
+    uint32_t counts[5];
+};
+
+size_t SnapshotSize(const TWorld &world, uint16_t flags = SNAP_STATIC);
+size_t SaveSnapshot(const TWorld &world, std::vector<uint8_t> &buffer, uint16_t flags = SNAP_STATIC);
+bool RestoreSnapshot(TWorld &world, const uint8_t *data, size_t size);
+uint64_t SnapshotHash(const uint8_t *data, size_t size);
+uint64_t WorldHash(const TWorld &world);
+void EncodeSnapshotDelta(const uint8_t *prev, size_t prevSize, const uint8_t *cur, size_t curSize,
+                         std::vector<uint8_t> &delta);
+bool ApplySnapshotDelta(std::vector<uint8_t> &state, const uint8_t *delta, size_t size);
+bool SaveSnapshotFile(const char *fileName, const TWorld &world);
+bool LoadSnapshotFile(const char *fileName, TWorld &world);
+
+// A Match keeps its bullets elsewhere and its bulletList is stale until
+// synced, so it is saved and hashed through Match::Synced() only
+class Match;
+size_t SnapshotSize(const Match &match, uint16_t flags = SNAP_STATIC) = delete;
+size_t SaveSnapshot(const Match &match, std::vector<uint8_t> &buffer, uint16_t flags = SNAP_STATIC) = delete;
+uint64_t WorldHash(const Match &match) = delete;
+bool SaveSnapshotFile(const char *fileName, const Match &match) = delete;
+
+#endif //TANKS2_SNAPSHOT_H
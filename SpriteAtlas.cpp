@@ -0,0 +1,239 @@
+//
+// Sprite sheets scaled once to the size they are drawn at.
+//
+
+#include "SpriteAtlas.h"
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <chrono>
+
+static const TSpriteSheet *const Sheets[SPR_COUNT] = {
+    &SPRITE_BLUE_TANK, &SPRITE_RED_TANK, &SPRITE_DEAD_TANK,
+    &SPRITE_EXPLOSION, &SPRITE_BLOCK, &SPRITE_TREE
+};
+
+TViewScale TViewScale::Fit(int outW, int outH, int logicalW, int logicalH, bool smooth)
+{
+    TViewScale view;
+    view.scale = std::min((double)outW / logicalW, (double)outH / logicalH);
+    if (!smooth && view.scale >= 1)
+        view.scale = std::floor(view.scale);
+    else
+        view.scale = std::max(1.0, std::floor(view.scale * 16)) / 16;
+    view.offsetX = (outW - (int)std::lround(logicalW * view.scale)) / 2;
+    view.offsetY = (outH - (int)std::lround(logicalH * view.scale)) / 2;
+    return view;
+}
+
+TSpriteAtlas::~TSpriteAtlas()
+{
+    // Textures go with their renderer, only the surfaces are ours
+    for (TScaledSet &set : sets)
+        for (SDL_Surface *s : set.sheets)
+            SDL_FreeSurface(s);
+    for (SDL_Surface *s : original)
+        SDL_FreeSurface(s);
+}
+
+const char *TSpriteAtlas::File(TSpriteId id)
+{
+    return Sheets[id]->file;
+}
+
+SDL_Surface *TSpriteAtlas::Decode(TSpriteId id)
+{
+    const TSpriteSheet &sheet = *Sheets[id];
+    SDL_Surface *loaded = IMG_Load(sheet.file);
+    if (loaded == nullptr) {
+        SDL_Log("Failed to load %s: %s", sheet.file, IMG_GetError());
+        return nullptr;
+    }
+    if (loaded->w != sheet.width || loaded->h != sheet.height) {
+        SDL_Log("%s is %dx%d, expected %dx%d", sheet.file, loaded->w, loaded->h,
+                sheet.width, sheet.height);
+        SDL_FreeSurface(loaded);
+        return nullptr;
+    }
+    SDL_Surface *converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(loaded);
+    return converted;
+}
+
+bool TSpriteAtlas::Load()
+{
+    for (int id = 0; id < SPR_COUNT; id++) {
+        original[id] = Decode((TSpriteId)id);
+        if (original[id] == nullptr)
+            return false;
+    }
+    SetScale(1, false);
+    return true;
+}
+
+/****************************************************************************
+ * Take a newly decoded sheet and rescale it in every kept set. The other
+ * sheets stay as they are.
+ ***************************************************************************/
+void TSpriteAtlas::Replace(TSpriteId id, SDL_Surface *decoded)
+{
+    SDL_FreeSurface(original[id]);
+    original[id] = decoded;
+    for (TScaledSet &set : sets) {
+        SDL_FreeSurface(set.sheets[id]);
+        if (set.textures[id] != nullptr)
+            SDL_DestroyTexture(set.textures[id]);
+        set.textures[id] = nullptr;
+        ScaleSheet(id, set);
+    }
+}
+
+static inline Uint32 PixelAt(const SDL_Surface *s, int x, int y)
+{
+    return ((const Uint32 *)((const Uint8 *)s->pixels + y * s->pitch))[x];
+}
+
+/****************************************************************************
+ * Scale one frame of an ARGB8888 sheet into another. Bilinear filtering
+ * works on premultiplied colour so transparent pixels do not darken edges.
+ ***************************************************************************/
+static void ScaleFrame(const SDL_Surface *src, const SDL_Rect &from, SDL_Surface *dst,
+                       const SDL_Rect &to, bool smooth)
+{
+    const double sx = (double)from.w / to.w;
+    const double sy = (double)from.h / to.h;
+    for (int dy = 0; dy < to.h; dy++) {
+        Uint32 *out = (Uint32 *)((Uint8 *)dst->pixels + (to.y + dy) * dst->pitch) + to.x;
+        const double fy = (dy + 0.5) * sy - 0.5;
+        for (int dx = 0; dx < to.w; dx++) {
+            if (!smooth) {
+                int x = std::min(from.w - 1, (int)((dx + 0.5) * sx));
+                int y = std::min(from.h - 1, (int)((dy + 0.5) * sy));
+                out[dx] = PixelAt(src, from.x + x, from.y + y);
+                continue;
+            }
+            const double fx = (dx + 0.5) * sx - 0.5;
+            int x0 = std::clamp((int)std::floor(fx), 0, from.w - 1);
+            int y0 = std::clamp((int)std::floor(fy), 0, from.h - 1);
+            int x1 = std::min(x0 + 1, from.w - 1), y1 = std::min(y0 + 1, from.h - 1);
+            double wx = std::clamp(fx - x0, 0.0, 1.0), wy = std::clamp(fy - y0, 0.0, 1.0);
+            const Uint32 p[4] = {PixelAt(src, from.x + x0, from.y + y0), PixelAt(src, from.x + x1, from.y + y0),
+                                 PixelAt(src, from.x + x0, from.y + y1), PixelAt(src, from.x + x1, from.y + y1)};
+            const double w[4] = {(1 - wx) * (1 - wy), wx * (1 - wy), (1 - wx) * wy, wx * wy};
+            double a = 0, r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++) {
+                double pa = (p[i] >> 24) * w[i];
+                a += pa;
+                r += ((p[i] >> 16) & 0xFF) * pa;
+                g += ((p[i] >> 8) & 0xFF) * pa;
+                b += (p[i] & 0xFF) * pa;
+            }
+            if (a < 0.5) {
+                out[dx] = 0;
+                continue;
+            }
+            out[dx] = ((Uint32)std::lround(a) << 24) | ((Uint32)std::lround(r / a) << 16) |
+                      ((Uint32)std::lround(g / a) << 8) | (Uint32)std::lround(b / a);
+        }
+    }
+}
+
+/****************************************************************************
+ * Switch to the sheets for a scale, making them when they are not one of
+ * the two kept sets. A new set takes the place of the one not in use.
+ ***************************************************************************/
+void TSpriteAtlas::SetScale(double scale, bool smooth)
+{
+    for (size_t i = 0; i < sets.size(); i++) {
+        if (std::fabs(sets[i].scale - scale) < 1e-9 && sets[i].smooth == smooth) {
+            current = (int)i;
+            return;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    TScaledSet set = {};
+    set.scale = scale;
+    set.smooth = smooth;
+    for (int id = 0; id < SPR_COUNT; id++)
+        ScaleSheet((TSpriteId)id, set);
+    if (sets.size() < 2) {
+        sets.push_back(set);
+        current = (int)sets.size() - 1;
+    } else {
+        current = 1 - current;
+        FreeSet(sets[current]);
+        sets[current] = set;
+    }
+    buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TSpriteAtlas::ScaleSheet(TSpriteId id, TScaledSet &set)
+{
+    const TSpriteSheet &sheet = *Sheets[id];
+    const int rows = (sheet.frames + sheet.columns - 1) / sheet.columns;
+    const int fw = std::max(1, (int)std::lround(sheet.frameWidth * set.scale));
+    const int fh = std::max(1, (int)std::lround(sheet.frameHeight * set.scale));
+    set.sheets[id] = nullptr;
+    SDL_Surface *out = SDL_CreateRGBSurfaceWithFormat(0, fw * sheet.columns, fh * rows, 32,
+                                                      SDL_PIXELFORMAT_ARGB8888);
+    if (out == nullptr)
+        return;
+    SDL_LockSurface(out);
+    SDL_LockSurface(original[id]);
+    for (int f = 0; f < sheet.frames; f++) {
+        int c = f % sheet.columns, r = f / sheet.columns;
+        SDL_Rect from = {c * sheet.frameWidth, r * sheet.frameHeight, sheet.frameWidth, sheet.frameHeight};
+        SDL_Rect to = {c * fw, r * fh, fw, fh};
+        ScaleFrame(original[id], from, out, to, set.smooth);
+    }
+    SDL_UnlockSurface(original[id]);
+    SDL_UnlockSurface(out);
+    SDL_SetSurfaceBlendMode(out, SDL_BLENDMODE_BLEND);
+    set.sheets[id] = out;
+    set.frameW[id] = fw;
+    set.frameH[id] = fh;
+}
+
+void TSpriteAtlas::FreeSet(TScaledSet &set)
+{
+    for (int id = 0; id < SPR_COUNT; id++) {
+        SDL_FreeSurface(set.sheets[id]);
+        if (set.textures[id] != nullptr)
+            SDL_DestroyTexture(set.textures[id]); // Its renderer is still there, see Texture()
+        set.sheets[id] = nullptr;
+        set.textures[id] = nullptr;
+    }
+}
+
+SDL_Texture *TSpriteAtlas::Texture(SDL_Renderer *renderer, TSpriteId id)
+{
+    TScaledSet &set = sets[current];
+    if (set.renderer != renderer) {
+        for (SDL_Texture *&t : set.textures)
+            t = nullptr; // Belonged to a renderer that is gone
+        set.renderer = renderer;
+    }
+    if (set.textures[id] == nullptr && set.sheets[id] != nullptr)
+        set.textures[id] = SDL_CreateTextureFromSurface(renderer, set.sheets[id]);
+    return set.textures[id];
+}
+
+void TSpriteAtlas::ReleaseTextures()
+{
+    for (TScaledSet &set : sets) {
+        for (SDL_Texture *&t : set.textures) {
+            if (t != nullptr)
+                SDL_DestroyTexture(t);
+            t = nullptr;
+        }
+        set.renderer = nullptr;
+    }
+}
+
+SDL_Rect TSpriteAtlas::Frame(TSpriteId id, int frame) const
+{
+    const TScaledSet &set = sets[current];
+    const int columns = Sheets[id]->columns;
+    return {(frame % columns) * set.frameW[id], (frame / columns) * set.frameH[id],
+            set.frameW[id], set.frameH[id]};
+}
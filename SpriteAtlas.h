@@ -0,0 +1,98 @@
+//
+// Sprite sheets scaled once to the size they are drawn at.
+//
+
+#ifndef TANKS2_SPRITEATLAS_H
+#define TANKS2_SPRITEATLAS_H
+
+#include <SDL2/SDL.h>
+#include <cmath>
+#include <vector>
+#include "SpriteInfo.h"
+
+enum TSpriteId { SPR_BLUE_TANK, SPR_RED_TANK, SPR_DEAD_TANK, SPR_EXPLOSION, SPR_BLOCK, SPR_TREE,
+                 SPR_COUNT };
+
+/****************************************************************************
+ * Mapping from the game's fixed logical screen to the pixels of the window.
+ * The logical screen is scaled evenly and centred, with black bars filling
+ * the rest.
+ ***************************************************************************/
+struct TViewScale {
+    double scale = 1;
+    int offsetX = 0, offsetY = 0;
+
+    int X(int x) const { return offsetX + (int)std::lround(x * scale); }
+    int Y(int y) const { return offsetY + (int)std::lround(y * scale); }
+    // Edges are mapped rather than sizes scaled, so neighbours never leave gaps
+    SDL_Rect Rect(int x, int y, int w, int h) const
+    {
+        int x1 = X(x), y1 = Y(y);
+        return {x1, y1, X(x + w) - x1, Y(y + h) - y1};
+    }
+    // Largest scale at which the logical size fits the output. Without
+    // smoothing only whole multiples are used so pixels stay square, and
+    // other scales go down in steps of 1/16 so resizing a window by hand
+    // does not make a new set of sprites for every pixel.
+    static TViewScale Fit(int outW, int outH, int logicalW, int logicalH, bool smooth);
+};
+
+/****************************************************************************
+ * The game's sprite sheets, loaded once and then rescaled whenever the draw
+ * scale changes: each frame is scaled on its own, nearest neighbour or
+ * bilinear, into a new sheet. Drawing then copies pixels one to one; a
+ * frame never has to be scaled while it is drawn. The sheets of the scale
+ * before are kept as well, so going back to the last window size, e.g.
+ * leaving full screen, costs nothing; older ones are freed.
+ *
+ * Textures for the GPU renderer are made from the scaled sheets on first
+ * use.
+ ***************************************************************************/
+class TSpriteAtlas {
+public:
+    TSpriteAtlas() = default;
+    ~TSpriteAtlas();
+    TSpriteAtlas(const TSpriteAtlas &) = delete;
+    TSpriteAtlas &operator=(const TSpriteAtlas &) = delete;
+
+    // Read the images. False if one is missing or differs from SpriteInfo.h.
+    bool Load();
+    // Image file of a sheet
+    static const char *File(TSpriteId id);
+    // Read one image, checked against SpriteInfo.h. Touches nothing else,
+    // so it may run on any thread.
+    static SDL_Surface *Decode(TSpriteId id);
+    // Use a decoded image from now on, rescaled at every kept scale. Takes
+    // the surface.
+    void Replace(TSpriteId id, SDL_Surface *decoded);
+    void SetScale(double scale, bool smooth);
+    double Scale() const { return sets.empty() ? 1 : sets[current].scale; }
+
+    SDL_Surface *Surface(TSpriteId id) const { return sets[current].sheets[id]; }
+    SDL_Texture *Texture(SDL_Renderer *renderer, TSpriteId id);
+    // Destroy the textures, before their renderer goes
+    void ReleaseTextures();
+    // Where one animation frame is in the scaled sheet
+    SDL_Rect Frame(TSpriteId id, int frame) const;
+
+    double BuildMs() const { return buildMs; }
+
+private:
+    struct TScaledSet {
+        double scale;
+        bool smooth;
+        int frameW[SPR_COUNT], frameH[SPR_COUNT];
+        SDL_Surface *sheets[SPR_COUNT];
+        SDL_Texture *textures[SPR_COUNT];
+        SDL_Renderer *renderer; // Owner of the textures
+    };
+    void ScaleSheet(TSpriteId id, TScaledSet &set);
+    static void FreeSet(TScaledSet &set);
+
+    SDL_Surface *original[SPR_COUNT] = {};
+    std::vector<TScaledSet> sets; // The current scale and the one before
+    int current = 0;
+    double buildMs = 0; // Time spent making the last new set
+};
+
+#endif //TANKS2_SPRITEATLAS_H
@@ -0,0 +1,31 @@
+//
+// Sprite sheet sizes and tank geometry. Generated from images/sprites.txt
+// by cmake/SpriteInfo.cmake; do not edit, rebuild the sprite_info target.
+//
+
+#ifndef TANKS2_SPRITEINFO_H
+#define TANKS2_SPRITEINFO_H
+
+struct TSpriteSheet {
+    const char *file;
+    int width, height;           // Whole image
+    int frameWidth, frameHeight;
+    int frames, columns;
+};
+
+constexpr TSpriteSheet SPRITE_BLUE_TANK = {"images/TankSpriteBlue.png", 258, 32, 32, 32, 8, 8};
+constexpr TSpriteSheet SPRITE_RED_TANK = {"images/TankSpriteRed.png", 258, 32, 32, 32, 8, 8};
+constexpr TSpriteSheet SPRITE_DEAD_TANK = {"images/deadTankSprite.png", 66, 32, 32, 32, 2, 2};
+constexpr TSpriteSheet SPRITE_EXPLOSION = {"images/ExplosionSprite.png", 73, 24, 24, 24, 3, 3};
+constexpr TSpriteSheet SPRITE_BLOCK = {"images/Bricks.png", 13, 11, 13, 11, 1, 1};
+constexpr TSpriteSheet SPRITE_TREE = {"images/Tree1.png", 38, 36, 38, 36, 1, 1};
+
+// Step for each tank direction, 0 is up and they go clockwise
+constexpr int SPRITE_DIR_X[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+constexpr int SPRITE_DIR_Y[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+// Where a shot leaves the tank, relative to its top left corner
+constexpr int SPRITE_MUZZLE_X[8] = {16, 32, 32, 32, 16, 0, 0, 0};
+constexpr int SPRITE_MUZZLE_Y[8] = {0, 0, 16, 32, 32, 32, 16, 0};
+
+#endif //TANKS2_SPRITEINFO_H
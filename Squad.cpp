@@ -0,0 +1,119 @@
+//
+// Red tanks on a screen working as a squad.
+//
+
+#include "Squad.h"
+#include <cstdlib>
+
+// Bit layout of TSquadMemory in a tank's ai field
+const int MEM_X_BITS = SQUAD_COORD_BITS, MEM_Y_BITS = SQUAD_COORD_BITS;
+const int MEM_AGE_BITS = 3, MEM_DIR_BITS = 3, MEM_COUNT_BITS = 2;
+const int MEM_Y_SHIFT = MEM_X_BITS;
+const int MEM_AGE_SHIFT = MEM_Y_SHIFT + MEM_Y_BITS;
+const int MEM_DIR_SHIFT = MEM_AGE_SHIFT + MEM_AGE_BITS;
+const int MEM_COUNT_SHIFT = MEM_DIR_SHIFT + MEM_DIR_BITS;
+const int MEM_KNOWN_BIT = MEM_COUNT_SHIFT + MEM_COUNT_BITS;
+const int MEM_ENGAGING_BIT = MEM_KNOWN_BIT + 1;
+const int MEM_STARTED_BIT = MEM_ENGAGING_BIT + 1;
+static_assert(MEM_STARTED_BIT < 32, "Squad memory must fit the ai field");
+static_assert(THINK_TICKS <= 1 << MEM_COUNT_BITS && MEMORY_THINKS < 1 << MEM_AGE_BITS,
+              "Squad timings must fit their fields");
+
+static int Field(uint32_t v, int shift, int bits)
+{
+    return (int)((v >> shift) & ((1u << bits) - 1));
+}
+
+static uint32_t Put(int value, int shift, int bits)
+{
+    return ((uint32_t)value & ((1u << bits) - 1)) << shift;
+}
+
+TSquadMemory TSquadMemory::Unpack(uint32_t v)
+{
+    TSquadMemory m;
+    m.seenX = Field(v, 0, MEM_X_BITS);
+    m.seenY = Field(v, MEM_Y_SHIFT, MEM_Y_BITS);
+    m.age = Field(v, MEM_AGE_SHIFT, MEM_AGE_BITS);
+    m.desiredDir = Field(v, MEM_DIR_SHIFT, MEM_DIR_BITS);
+    m.countdown = Field(v, MEM_COUNT_SHIFT, MEM_COUNT_BITS);
+    m.known = (v >> MEM_KNOWN_BIT) & 1;
+    m.engaging = (v >> MEM_ENGAGING_BIT) & 1;
+    m.started = (v >> MEM_STARTED_BIT) & 1;
+    return m;
+}
+
+uint32_t TSquadMemory::Pack() const
+{
+    return Put(seenX, 0, MEM_X_BITS) | Put(seenY, MEM_Y_SHIFT, MEM_Y_BITS) |
+           Put(age, MEM_AGE_SHIFT, MEM_AGE_BITS) | Put(desiredDir, MEM_DIR_SHIFT, MEM_DIR_BITS) |
+           Put(countdown, MEM_COUNT_SHIFT, MEM_COUNT_BITS) | (uint32_t)known << MEM_KNOWN_BIT |
+           (uint32_t)engaging << MEM_ENGAGING_BIT | (uint32_t)started << MEM_STARTED_BIT;
+}
+
+void TSquads::Build(const TItemList &tanks, int screens, int redColor)
+{
+    if ((int)boards.size() != screens) {
+        boards.assign(screens, TSquadBoard());
+        stamp.assign(screens, 0);
+        epoch = 0;
+    }
+    epoch++;
+    roles.resize(tanks.size());
+    for (size_t i = 0; i < tanks.size(); i++) {
+        const TItemRec &t = tanks[i];
+        roles[i] = ROLE_CHASE;
+        if (t.color != redColor || (unsigned)t.screen >= (unsigned)screens)
+            continue;
+        TSquadBoard &b = boards[t.screen];
+        if (stamp[t.screen] != epoch) {
+            stamp[t.screen] = epoch;
+            b = TSquadBoard();
+        }
+        roles[i] = (uint8_t)(b.members % ROLE_COUNT);
+        b.members++;
+        // The freshest sighting any member holds
+        const TSquadMemory m = TSquadMemory::Unpack(t.ai);
+        if (m.known && (!b.known || m.age < b.age)) {
+            b.known = true;
+            b.seenX = m.seenX;
+            b.seenY = m.seenY;
+            b.age = m.age;
+        }
+    }
+}
+
+void TSquads::Report(int screen, int x, int y)
+{
+    if (TSquadBoard *b = Board(screen)) {
+        b->known = true;
+        b->seenX = x;
+        b->seenY = y;
+        b->age = 0;
+    }
+}
+
+/****************************************************************************
+ * Headings run clockwise from straight up, as in SpriteInfo.h. A vector is
+ * straight when it is within about 22.5 degrees of an axis (tan 22.5 is
+ * close to 5 / 12), diagonal otherwise.
+ ***************************************************************************/
+int HeadingTo(int dx, int dy)
+{
+    const int ax = abs(dx), ay = abs(dy);
+    if (ax * 12 < ay * 5)
+        return dy < 0 ? 0 : 4;
+    if (ay * 12 < ax * 5)
+        return dx > 0 ? 2 : 6;
+    if (dx > 0)
+        return dy < 0 ? 1 : 3;
+    return dy < 0 ? 7 : 5;
+}
+
+int TurnToward(int dir, int want)
+{
+    const int diff = (want - dir + 8) % 8;
+    if (diff == 0)
+        return dir;
+    return diff <= 4 ? (dir + 1) % 8 : (dir + 7) % 8;
+}
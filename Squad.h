@@ -0,0 +1,83 @@
+//
+// Red tanks on a screen working as a squad.
+//
+
+#ifndef TANKS2_SQUAD_H
+#define TANKS2_SQUAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Item.h"
+
+const int THINK_TICKS = 4;    // A red tank thinks once in this many ticks
+const int MEMORY_THINKS = 7;  // Thinks a sighting lasts
+const int ENGAGE_PIXELS = 110; // Close enough to stop and fire
+const int FLANK_PIXELS = 140;  // How far to the side flankers aim
+const int ARRIVE_PIXELS = 40;
+const int SQUAD_COORD_BITS = 10; // A sighting's x and y are below 1 << SQUAD_COORD_BITS
+
+/****************************************************************************
+ * What one red tank remembers between ticks. It is packed into the tank's
+ * ai field, so it is saved, hashed and rewound with the world and every
+ * copy of a match, server or client, thinks alike.
+ ***************************************************************************/
+struct TSquadMemory {
+    bool started = false;  // Has thought at least once
+    bool known = false;    // seenX, seenY hold a sighting of the player
+    bool engaging = false; // Holding position and turning to fire
+    int seenX = 0, seenY = 0;
+    int age = 0;           // Thinks since the sighting
+    int desiredDir = 0;    // Heading the tank turns toward between thinks
+    int countdown = 0;     // Ticks until it thinks again
+
+    static TSquadMemory Unpack(uint32_t ai);
+    uint32_t Pack() const;
+};
+
+enum TSquadRole { ROLE_CHASE, ROLE_FLANK_LEFT, ROLE_FLANK_RIGHT, ROLE_COUNT };
+
+// A screen's shared view, gathered from its members at the start of a tick
+struct TSquadBoard {
+    int members = 0;
+    bool known = false;
+    int seenX = 0, seenY = 0;
+    int age = 0;
+};
+
+/****************************************************************************
+ * The blackboards of every screen and the role of every red tank. Build()
+ * is O(tanks) like TTankGrid: boards are stamped rather than cleared, so a
+ * map of a thousand screens costs nothing extra. Roles go round the
+ * squad in list order, chaser first, so a squad of three or more comes at
+ * the player from the front and both sides.
+ *
+ * A member that sees the player during the tick writes it to the board
+ * with Report(), and members that think after it pick it up the same
+ * tick.
+ ***************************************************************************/
+class TSquads {
+public:
+    void Build(const TItemList &tanks, int screens, int redColor);
+
+    TSquadBoard *Board(int screen)
+    {
+        return (unsigned)screen < (unsigned)boards.size() && stamp[screen] == epoch ? &boards[screen]
+                                                                                   : nullptr;
+    }
+    TSquadRole Role(int idx) const { return (TSquadRole)roles[idx]; }
+    void Report(int screen, int x, int y);
+
+private:
+    std::vector<TSquadBoard> boards;
+    std::vector<uint32_t> stamp; // boards[] is valid only when stamp == epoch
+    std::vector<uint8_t> roles;  // Per tank
+    uint32_t epoch = 0;
+};
+
+// The one of the eight headings closest to dx, dy, without floating point
+int HeadingTo(int dx, int dy);
+// Turn one step from dir toward want, the short way round
+int TurnToward(int dir, int want);
+
+#endif //TANKS2_SQUAD_H
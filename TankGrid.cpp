@@ -0,0 +1,79 @@
+//
+// Broad phase for tank collision: tanks bucketed by screen and cell.
+//
+
+#include "TankGrid.h"
+
+int TTankGrid::CellOf(const TItemRec &tank) const
+{
+    if ((unsigned)tank.screen >= (unsigned)screens)
+        return -1;
+    return (tank.screen * rows + Clamp(tank.y / CELL, rows)) * cols + Clamp(tank.x / CELL, cols);
+}
+
+void TTankGrid::Link(int idx, int cell)
+{
+    cellOf[idx] = cell;
+    prev[idx] = -1;
+    next[idx] = -1;
+    if (cell < 0)
+        return;
+    if (stamp[cell] != epoch) {
+        stamp[cell] = epoch;
+        head[cell] = -1;
+    }
+    next[idx] = head[cell];
+    if (head[cell] >= 0)
+        prev[head[cell]] = idx;
+    head[cell] = idx;
+}
+
+void TTankGrid::Unlink(int idx)
+{
+    int cell = cellOf[idx];
+    if (cell < 0)
+        return;
+    if (prev[idx] >= 0)
+        next[prev[idx]] = next[idx];
+    else
+        head[cell] = next[idx];
+    if (next[idx] >= 0)
+        prev[next[idx]] = prev[idx];
+}
+
+void TTankGrid::Build(const TItemList &tanks, int screens, int width, int height,
+                      int tankW, int tankH)
+{
+    int newCols = (width + CELL - 1) / CELL;
+    int newRows = (height + CELL - 1) / CELL;
+    size_t cells = (size_t)screens * newCols * newRows;
+    if (cells != head.size()) {
+        head.assign(cells, -1);
+        stamp.assign(cells, 0);
+        epoch = 0;
+    }
+    this->screens = screens;
+    cols = newCols;
+    rows = newRows;
+    this->tankW = tankW;
+    this->tankH = tankH;
+    if (++epoch == 0) { // Wrapped, old stamps could match again
+        stamp.assign(cells, 0);
+        epoch = 1;
+    }
+
+    next.resize(tanks.size());
+    prev.resize(tanks.size());
+    cellOf.resize(tanks.size());
+    for (int i = (int)tanks.size() - 1; i >= 0; i--)
+        Link(i, CellOf(tanks[i]));
+}
+
+void TTankGrid::Move(int idx, const TItemRec &tank)
+{
+    int cell = CellOf(tank);
+    if (cell == cellOf[idx])
+        return;
+    Unlink(idx);
+    Link(idx, cell);
+}
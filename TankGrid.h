@@ -0,0 +1,63 @@
+//
+// Broad phase for tank collision: tanks bucketed by screen and cell.
+//
+
+#ifndef TANKS2_TANKGRID_H
+#define TANKS2_TANKGRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Item.h"
+
+/****************************************************************************
+ * Uniform grid of CELL x CELL pixel cells on every screen. Each tank is
+ * linked into the cell holding its top left corner, so the tanks that can
+ * touch an area are found by walking the few cells around it, however many
+ * tanks the map holds.
+ *
+ * Build() is O(tanks): cells are stamped with the build number instead of
+ * being cleared. After a tank moves, Move() relinks it.
+ ***************************************************************************/
+class TTankGrid {
+public:
+    static const int CELL = 64;
+
+    void Build(const TItemList &tanks, int screens, int width, int height,
+               int tankW, int tankH);
+    void Move(int idx, const TItemRec &tank);
+
+    // Call fn(idx) for every tank whose box may overlap x1..x2, y1..y2
+    // (inclusive) on the screen
+    template <typename F>
+    void ForEachNear(int screen, int x1, int y1, int x2, int y2, F &&fn) const
+    {
+        if ((unsigned)screen >= (unsigned)screens)
+            return;
+        int c1 = Clamp((x1 - tankW + 1) / CELL, cols), c2 = Clamp(x2 / CELL, cols);
+        int r1 = Clamp((y1 - tankH + 1) / CELL, rows), r2 = Clamp(y2 / CELL, rows);
+        for (int r = r1; r <= r2; r++) {
+            for (int c = c1; c <= c2; c++) {
+                int cell = (screen * rows + r) * cols + c;
+                if (stamp[cell] != epoch)
+                    continue;
+                for (int i = head[cell]; i >= 0; i = next[i])
+                    fn(i);
+            }
+        }
+    }
+
+private:
+    static int Clamp(int v, int n) { return v < 0 ? 0 : (v >= n ? n - 1 : v); }
+    int CellOf(const TItemRec &tank) const;
+    void Link(int idx, int cell);
+    void Unlink(int idx);
+
+    int screens = 0, cols = 1, rows = 1;
+    int tankW = 0, tankH = 0;
+    uint32_t epoch = 0;
+    TTagVector<int, MEM_WORLD> head;
+    TTagVector<uint32_t, MEM_WORLD> stamp; // head[] is valid only when stamp == epoch
+    TTagVector<int, MEM_WORLD> next, prev, cellOf;
+};
+
+#endif //TANKS2_TANKGRID_H
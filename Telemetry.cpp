@@ -0,0 +1,248 @@
+//
+// Gameplay and performance events streamed to a file or socket.
+//
+
+#include "Telemetry.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __unix__
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+const char *const TelemetryTypeNames[TEL_TYPE_COUNT] = {
+    "none", "shot", "hit", "wall_hit", "death", "screen", "tick"};
+
+std::atomic<bool> telemetryOn{false};
+
+const int DRAIN_MS = 10;
+const size_t BATCH = 1024; // Records written at once
+
+size_t TTelemetryRing::PopMany(TTelemetryRecord *out, size_t max)
+{
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t n = tail.load(std::memory_order_acquire) - h;
+    if (n > max)
+        n = (uint32_t)max;
+    for (uint32_t i = 0; i < n; i++)
+        out[i] = data[(h + i) % SIZE];
+    head.store(h + n, std::memory_order_release);
+    return n;
+}
+
+/****************************************************************************
+ * The sink's state. Rings are made on demand and kept until the program
+ * ends, so a thread that emits after a restart still has a valid ring.
+ ***************************************************************************/
+namespace {
+struct TSink {
+    std::mutex ringsLock;
+    std::vector<std::unique_ptr<TTelemetryRing>> rings;
+
+    std::string path;
+    bool socket = false;
+    int64_t rotateBytes = 0;
+    int keep = 0;
+    int fd = -1;
+    TTelemetryHeader header{};
+
+    std::thread drain;
+    std::atomic<bool> quit{false};
+
+    std::atomic<int64_t> written{0}, lost{0}, bytes{0};
+    std::atomic<int> rotations{0}, failures{0};
+
+    ~TSink() { TelemetryStop(); }
+};
+
+TSink sink;
+thread_local TTelemetryRing *threadRing = nullptr;
+}
+
+static bool WriteAll(int fd, const void *data, size_t size)
+{
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+#ifdef __unix__
+        ssize_t n = sink.socket ? send(fd, p, size, MSG_NOSIGNAL) : write(fd, p, size);
+#else
+        ssize_t n = write(fd, p, size);
+#endif
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool OpenSink()
+{
+    if (sink.socket) {
+#ifdef __unix__
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (sink.path.size() >= sizeof(addr.sun_path))
+            return false;
+        strcpy(addr.sun_path, sink.path.c_str());
+        sink.fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sink.fd >= 0 && connect(sink.fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(sink.fd);
+            sink.fd = -1;
+        }
+#endif
+    } else {
+        sink.fd = open(sink.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (sink.fd < 0)
+        return false;
+    sink.bytes = 0;
+    if (!WriteAll(sink.fd, &sink.header, sizeof(sink.header))) {
+        close(sink.fd);
+        sink.fd = -1;
+        return false;
+    }
+    sink.bytes = sizeof(sink.header);
+    return true;
+}
+
+// Shift name.1 ... name.(keep - 1) up by one and start a new name
+static void Rotate()
+{
+    close(sink.fd);
+    sink.fd = -1;
+    for (int i = sink.keep - 1; i >= 1; i--) {
+        const std::string from = sink.path + "." + std::to_string(i);
+        rename(from.c_str(), (sink.path + "." + std::to_string(i + 1)).c_str());
+    }
+    if (sink.keep > 0 && rename(sink.path.c_str(), (sink.path + ".1").c_str()) != 0)
+        sink.failures++;
+    sink.rotations++;
+    if (!OpenSink())
+        sink.failures++;
+}
+
+/****************************************************************************
+ * The drain thread. A sink that failed stays closed; what reaches it after
+ * that is counted as lost so the rings never back up.
+ ***************************************************************************/
+static void DrainRings(std::vector<TTelemetryRecord> &batch)
+{
+    std::vector<TTelemetryRing *> rings;
+    {
+        std::lock_guard<std::mutex> guard(sink.ringsLock);
+        for (auto &r : sink.rings)
+            rings.push_back(r.get());
+    }
+    for (TTelemetryRing *ring : rings) {
+        size_t n;
+        while ((n = ring->PopMany(batch.data(), batch.size())) > 0) {
+            const size_t size = n * sizeof(TTelemetryRecord);
+            if (sink.fd >= 0 && WriteAll(sink.fd, batch.data(), size)) {
+                sink.written += (int64_t)n;
+                sink.bytes += (int64_t)size;
+                if (!sink.socket && sink.bytes >= sink.rotateBytes)
+                    Rotate();
+            } else {
+                if (sink.fd >= 0) {
+                    sink.failures++;
+                    close(sink.fd);
+                    sink.fd = -1;
+                }
+                sink.lost += (int64_t)n;
+            }
+        }
+    }
+}
+
+static void Drain()
+{
+    std::vector<TTelemetryRecord> batch(BATCH);
+    while (!sink.quit) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_MS));
+        DrainRings(batch);
+    }
+    DrainRings(batch);
+}
+
+bool TelemetryStart(const char *target, int64_t rotateBytes, int keep)
+{
+    TelemetryStop();
+    sink.socket = strncmp(target, "unix:", 5) == 0;
+    sink.path = sink.socket ? target + 5 : target;
+    sink.rotateBytes = rotateBytes > (int64_t)sizeof(TTelemetryHeader) ? rotateBytes : 1 << 20;
+    sink.keep = keep;
+    memcpy(sink.header.magic, "TKTL", 4);
+    sink.header.version = TELEMETRY_VERSION;
+    sink.header.recordSize = sizeof(TTelemetryRecord);
+    sink.header.startMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!OpenSink()) {
+        sink.failures++;
+        return false;
+    }
+    sink.quit = false;
+    sink.drain = std::thread(Drain);
+    telemetryOn = true;
+    return true;
+}
+
+void TelemetryStop()
+{
+    telemetryOn = false;
+    if (!sink.drain.joinable())
+        return;
+    sink.quit = true;
+    sink.drain.join();
+    if (sink.fd >= 0)
+        close(sink.fd);
+    sink.fd = -1;
+}
+
+/****************************************************************************
+ * Out of line so the inline check stays small. The first event of a thread
+ * makes its ring, under the lock; every later one is a plain push.
+ ***************************************************************************/
+void TelemetryPush(const TTelemetryRecord &r)
+{
+    if (threadRing == nullptr) {
+        std::lock_guard<std::mutex> guard(sink.ringsLock);
+        sink.rings.push_back(std::make_unique<TTelemetryRing>());
+        threadRing = sink.rings.back().get();
+    }
+    threadRing->Push(r);
+}
+
+TTelemetryStats TelemetryStats()
+{
+    TTelemetryStats s;
+    s.written = sink.written;
+    s.dropped = sink.lost;
+    {
+        std::lock_guard<std::mutex> guard(sink.ringsLock);
+        for (auto &r : sink.rings)
+            s.dropped += r->Dropped();
+    }
+    s.bytes = sink.bytes;
+    s.rotations = sink.rotations;
+    s.failures = sink.failures;
+    return s;
+}
+
+void TelemetryFormat(char *buf, size_t size)
+{
+    TTelemetryStats s = TelemetryStats();
+    snprintf(buf, size, "%lld records written, %lld dropped, %d rotations, %d failures",
+             (long long)s.written, (long long)s.dropped, s.rotations, s.failures);
+}
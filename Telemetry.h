@@ -0,0 +1,125 @@
+//
+// Gameplay and performance events streamed to a file or socket.
+//
+
+#ifndef TANKS2_TELEMETRY_H
+#define TANKS2_TELEMETRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum TTelemetryType : uint16_t {
+    TEL_SHOT = 1,  // tank fired, x, y where the bullet starts, a = direction
+    TEL_HIT,       // tank hit at x, y, a = its colour before, dead tanks included
+    TEL_WALL_HIT,  // tank = -1, bullet stopped by a wall at x, y
+    TEL_DEATH,     // tank destroyed at x, y, a = its colour
+    TEL_SCREEN,    // tank went through a door to screen, a = the screen it left
+    TEL_TICK,      // tank = -1, screen followed or -1, x = tanks alive, y = bullets,
+                   // a = tick time in us
+    TEL_TYPE_COUNT
+};
+
+extern const char *const TelemetryTypeNames[TEL_TYPE_COUNT];
+
+// One event. Written to the sink as is, so the layout is the file format.
+struct TTelemetryRecord {
+    uint32_t tick;
+    uint16_t type;   // TTelemetryType
+    uint16_t source; // Which match, e.g. its number on a server
+    int32_t tank;
+    int32_t screen;
+    int32_t x, y;
+    int32_t a, b;
+};
+static_assert(sizeof(TTelemetryRecord) == 32, "Telemetry records are 32 bytes on disk");
+
+// Start of every file and of the socket stream
+struct TTelemetryHeader {
+    char magic[4];      // "TKTL"
+    uint16_t version;
+    uint16_t recordSize;
+    int64_t startMs;    // Unix time the sink was started, in ms
+};
+static_assert(sizeof(TTelemetryHeader) == 16, "Telemetry header is 16 bytes on disk");
+
+const uint16_t TELEMETRY_VERSION = 1;
+
+/****************************************************************************
+ * A ring of records with one producer and one consumer, the same scheme as
+ * TByteQueue except that the producer keeps its own copy of head, so most
+ * pushes touch only its own cache lines. Push never waits: a full ring
+ * drops the record and counts it.
+ ***************************************************************************/
+class TTelemetryRing {
+public:
+    static const uint32_t SIZE = 8192; // A power of two
+
+    bool Push(const TTelemetryRecord &r)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - headSeen >= SIZE) {
+            // Only look at the consumer's line when the ring seems full
+            headSeen = head.load(std::memory_order_acquire);
+            if (t - headSeen >= SIZE) {
+                dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        data[t % SIZE] = r;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    // Take up to max records, oldest first
+    size_t PopMany(TTelemetryRecord *out, size_t max);
+    long Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    TTelemetryRecord data[SIZE];
+    alignas(64) std::atomic<uint32_t> head{0};
+    alignas(64) std::atomic<uint32_t> tail{0};
+    uint32_t headSeen = 0; // The producer's last look at head
+    std::atomic<long> dropped{0};
+};
+
+/****************************************************************************
+ * The events of every thread go to one sink. Each thread that emits gets a
+ * ring of its own the first time it does, so every ring has exactly one
+ * producer; a background thread drains them all every few milliseconds and
+ * writes the records out in batches.
+ *
+ * The target is a file name or "unix:" followed by the path of a listening
+ * Unix stream socket. A file is rotated once it grows past rotateBytes:
+ * name becomes name.1, name.1 becomes name.2 and so on up to keep files.
+ *
+ * While the sink is stopped TelemetryEmit() is one relaxed load and a
+ * branch. Records carry the tick rather than a clock reading, which keeps
+ * an event at a few nanoseconds; the header has the wall clock start time.
+ ***************************************************************************/
+bool TelemetryStart(const char *target, int64_t rotateBytes = 64 << 20, int keep = 3);
+// Drain what is left and close the sink. Emitting threads should be done.
+void TelemetryStop();
+
+extern std::atomic<bool> telemetryOn;
+
+void TelemetryPush(const TTelemetryRecord &r);
+
+inline void TelemetryEmit(TTelemetryType type, uint16_t source, uint32_t tick, int tank,
+                          int screen, int x, int y, int a = 0, int b = 0)
+{
+    if (!telemetryOn.load(std::memory_order_relaxed))
+        return;
+    TelemetryPush({tick, type, source, tank, screen, x, y, a, b});
+}
+
+struct TTelemetryStats {
+    int64_t written;   // Records handed to the file or socket
+    int64_t dropped;   // Records lost to full rings or a failed sink
+    int64_t bytes;     // Written to the current file
+    int rotations;
+    int failures;      // Opens, writes or renames that failed
+};
+TTelemetryStats TelemetryStats();
+void TelemetryFormat(char *buf, size_t size);
+
+#endif //TANKS2_TELEMETRY_H
@@ -0,0 +1,80 @@
+//
+// Fixed set of worker threads for data parallel loops.
+//
+
+#include "ThreadPool.h"
+
+TThreadPool::TThreadPool(int threads)
+{
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&TThreadPool::WorkerLoop, this);
+}
+
+TThreadPool::~TThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : workers)
+        t.join();
+}
+
+/****************************************************************************
+ * Take indices until there are none left.
+ ***************************************************************************/
+void TThreadPool::RunItems()
+{
+    for (int i = nextItem.fetch_add(1); i < jobCount; i = nextItem.fetch_add(1))
+        (*job)(i);
+}
+
+void TThreadPool::ParallelFor(int count, const std::function<void(int)> &fn)
+{
+    if (count <= 0)
+        return;
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = &fn;
+        jobCount = count;
+        nextItem.store(0);
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    RunItems();
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this] { return busy == 0; });
+    job = nullptr;
+} // ParallelFor
+
+void TThreadPool::WorkerLoop()
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        RunItems();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0)
+                done.notify_one();
+        }
+    }
+} // WorkerLoop
@@ -0,0 +1,47 @@
+//
+// Fixed set of worker threads for data parallel loops.
+//
+
+#ifndef TANKS2_THREADPOOL_H
+#define TANKS2_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/****************************************************************************
+ * ParallelFor(count, fn) calls fn(i) once for every i in [0, count) and
+ * returns when all calls are done. Indices are handed out one at a time, so
+ * slow items do not hold up a whole slice. The calling thread works too,
+ * so a pool of one thread has no workers and runs everything inline.
+ ***************************************************************************/
+class TThreadPool {
+public:
+    explicit TThreadPool(int threads = 0); // 0 - one per hardware thread
+    ~TThreadPool();
+    TThreadPool(const TThreadPool &) = delete;
+    TThreadPool &operator=(const TThreadPool &) = delete;
+
+    int Threads() const { return (int)workers.size() + 1; }
+    void ParallelFor(int count, const std::function<void(int)> &fn);
+
+private:
+    void WorkerLoop();
+    void RunItems();
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int)> *job = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextItem{0};
+    int busy = 0;          // Workers still inside the current job
+    unsigned generation = 0;
+    bool stopping = false;
+};
+
+#endif //TANKS2_THREADPOOL_H
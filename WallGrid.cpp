@@ -0,0 +1,157 @@
+//
+// Packed bitmap of wall coverage for fast collision queries.
+//
+
+#include "WallGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/****************************************************************************
+ * Cell boundaries along one axis, and the cell of every pixel on it.
+ * Returns the number of cells.
+ ***************************************************************************/
+static int BuildAxis(TArena &arena, uint8_t *edge, int size, const int *&startsOut,
+                     const uint16_t *&cellOfOut)
+{
+    edge[0] = 1;
+    edge[size] = 1;
+    int count = 0;
+    for (int p = 0; p <= size; p++)
+        count += edge[p];
+    int *starts = arena.AllocArray<int>(count);
+    for (int p = 0, n = 0; p <= size; p++)
+        if (edge[p])
+            starts[n++] = p;
+    uint16_t *cellOf = arena.AllocArray<uint16_t>(size);
+    int cell = 0;
+    for (int p = 0; p < size; p++) {
+        if (p >= starts[cell + 1])
+            cell++;
+        cellOf[p] = (uint16_t)cell;
+    }
+    startsOut = starts;
+    cellOfOut = cellOf;
+    return count - 1;
+}
+
+/****************************************************************************
+ * Rebuild from the wall list.
+ * Parameters:
+ *   blocks          - Walls; each covers blockW x blockH pixels at x, y.
+ *   screens         - Number of screens in the map.
+ *   width, height   - Size of a screen.
+ ***************************************************************************/
+void TWallGrid::Build(const TItemList &blocks, int screens, int width, int height,
+                      int blockW, int blockH)
+{
+    this->width = width;
+    this->height = height;
+    this->screens = screens;
+
+    auto clampX = [&](int v) { return std::min(std::max(v, 0), width); };
+    auto clampY = [&](int v) { return std::min(std::max(v, 0), height); };
+    std::vector<uint8_t> xEdge(width + 1), yEdge(height + 1);
+    xEdge[0] = xEdge[width] = yEdge[0] = yEdge[height] = 1;
+    for (const TItemRec &b : blocks) {
+        xEdge[clampX(b.x)] = xEdge[clampX(b.x + blockW)] = 1;
+        yEdge[clampY(b.y)] = yEdge[clampY(b.y + blockH)] = 1;
+    }
+    // The edges give the size of every table, so the previous level's go
+    // all at once and the new ones fit one chunk exactly
+    const int xCount = (int)std::count(xEdge.begin(), xEdge.end(), 1);
+    const int yCount = (int)std::count(yEdge.begin(), yEdge.end(), 1);
+    const size_t wordCount = (size_t)screens * (yCount - 1) * ((xCount - 1 + 63) / 64);
+    arena.Reset((xCount + yCount) * sizeof(int) + (width + height) * sizeof(uint16_t) +
+                wordCount * sizeof(uint64_t) + 3 * alignof(uint64_t));
+
+    cols = BuildAxis(arena, xEdge.data(), width, xs, colOf);
+    rows = BuildAxis(arena, yEdge.data(), height, ys, rowOf);
+    words = (cols + 63) / 64;
+
+    uint64_t *grid = arena.AllocArray<uint64_t>(wordCount);
+    std::fill(grid, grid + wordCount, 0);
+    bits = grid;
+    for (const TItemRec &b : blocks) {
+        int x1 = clampX(b.x), x2 = clampX(b.x + blockW);
+        int y1 = clampY(b.y), y2 = clampY(b.y + blockH);
+        if (x1 == x2 || y1 == y2 || (unsigned)b.screen >= (unsigned)screens)
+            continue;
+        int c1 = colOf[x1], c2 = colOf[x2 - 1];
+        for (int r = rowOf[y1]; r <= rowOf[y2 - 1]; r++) {
+            uint64_t *row = &grid[((size_t)b.screen * rows + r) * words];
+            for (int c = c1; c <= c2; c++)
+                row[c >> 6] |= 1ull << (c & 63);
+        }
+    }
+} // Build
+
+/****************************************************************************
+ * Any set bit from cell c1 to c2 of one row.
+ ***************************************************************************/
+bool TWallGrid::RowSpan(int screen, int r, int c1, int c2) const
+{
+    const uint64_t *row = &bits[((size_t)screen * rows + r) * words];
+    int w1 = c1 >> 6, w2 = c2 >> 6;
+    uint64_t first = ~0ull << (c1 & 63);
+    uint64_t last = ~0ull >> (63 - (c2 & 63));
+    if (w1 == w2)
+        return (row[w1] & first & last) != 0;
+    if (row[w1] & first)
+        return true;
+    for (int w = w1 + 1; w < w2; w++)
+        if (row[w])
+            return true;
+    return (row[w2] & last) != 0;
+}
+
+bool TWallGrid::SpanBlocked(int screen, int y, int x1, int x2) const
+{
+    if (x1 > x2)
+        std::swap(x1, x2);
+    x1 = std::max(x1, 0);
+    x2 = std::min(x2, width - 1);
+    if (x1 > x2 || (unsigned)y >= (unsigned)height || (unsigned)screen >= (unsigned)screens)
+        return false;
+    return RowSpan(screen, rowOf[y], colOf[x1], colOf[x2]);
+}
+
+bool TWallGrid::RectBlocked(int screen, int x, int y, int w, int h) const
+{
+    int x1 = std::max(x, 0), x2 = std::min(x + w, width) - 1;
+    int y1 = std::max(y, 0), y2 = std::min(y + h, height) - 1;
+    if (x1 > x2 || y1 > y2 || (unsigned)screen >= (unsigned)screens)
+        return false;
+    for (int r = rowOf[y1]; r <= rowOf[y2]; r++)
+        if (RowSpan(screen, r, colOf[x1], colOf[x2]))
+            return true;
+    return false;
+}
+
+/****************************************************************************
+ * Walk the line one band of cell rows at a time; within a band the line
+ * covers a single run of pixels, which is tested as a span.
+ ***************************************************************************/
+bool TWallGrid::LineOfSight(int screen, int x1, int y1, int x2, int y2) const
+{
+    if (y1 > y2) {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+    }
+    if (y1 == y2)
+        return !SpanBlocked(screen, y1, x1, x2);
+    const int top = std::max(y1, 0), bottom = std::min(y2, height - 1);
+    const double slope = (double)(x2 - x1) / (y2 - y1);
+    const double xMin = std::min(x1, x2), xMax = std::max(x1, x2);
+    for (int ya = top; ya <= bottom;) {
+        int yb = std::min(ys[rowOf[ya] + 1] - 1, bottom);
+        // x where the line enters and leaves the band; each pixel row
+        // reaches half a row above and below its centre
+        double xa = std::clamp(x1 + slope * (ya - 0.5 - y1), xMin, xMax);
+        double xb = std::clamp(x1 + slope * (yb + 0.5 - y1), xMin, xMax);
+        if (SpanBlocked(screen, ya, (int)std::lround(xa), (int)std::lround(xb)))
+            return false;
+        ya = yb + 1;
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+//
+// Packed bitmap of wall coverage for fast collision queries.
+//
+
+#ifndef TANKS2_WALLGRID_H
+#define TANKS2_WALLGRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Item.h"
+#include "Memory.h"
+
+/****************************************************************************
+ * Which pixels of each screen are covered by a wall, stored as one bit per
+ * cell of a compressed grid. The grid lines are the left/right and
+ * top/bottom edges of all walls, so each cell is either wholly inside walls
+ * or wholly outside, and the answers are exact to the pixel. Lookup tables
+ * turn a pixel coordinate into a cell in one step.
+ *
+ * Walls on a tile grid give one cell per tile, so a generated screen of
+ * 61 x 50 tiles takes about 50 64-bit words, 400 bytes. The axis tables
+ * are shared by all screens.
+ *
+ * Spans and rectangles are tested a 64-bit word at a time.
+ *
+ * All tables live in a level arena that Build() resets to the size they
+ * need, so a new level replaces the old one's memory in one go without
+ * freeing piece by piece, and a small map holds a few KB rather than a
+ * default-sized chunk.
+ ***************************************************************************/
+class TWallGrid {
+public:
+    void Build(const TItemList &blocks, int screens, int width, int height,
+               int blockW, int blockH);
+
+    bool Blocked(int screen, int x, int y) const
+    {
+        if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height ||
+            (unsigned)screen >= (unsigned)screens)
+            return false;
+        int c = colOf[x];
+        const uint64_t *row = &bits[((size_t)screen * rows + rowOf[y]) * words];
+        return (row[c >> 6] >> (c & 63)) & 1;
+    }
+    // Any wall on row y between x1 and x2 inclusive
+    bool SpanBlocked(int screen, int y, int x1, int x2) const;
+    // Any wall inside the w x h rectangle at x, y
+    bool RectBlocked(int screen, int x, int y, int w, int h) const;
+    // No wall on the straight line between the two points
+    bool LineOfSight(int screen, int x1, int y1, int x2, int y2) const;
+
+    size_t MemoryBytes() const { return arena.Used(); }
+
+private:
+    bool RowSpan(int screen, int r, int c1, int c2) const;
+
+    int width = 0, height = 0, screens = 0;
+    int cols = 0, rows = 0, words = 0; // Cells per screen, words per cell row
+    TArena arena{MEM_LEVEL, 0}; // Sized by Build()
+    const int *xs = nullptr, *ys = nullptr; // Pixel where each cell column / row starts
+    const uint16_t *colOf = nullptr, *rowOf = nullptr;
+    const uint64_t *bits = nullptr;         // [screen][row][word]
+};
+
+#endif //TANKS2_WALLGRID_H
@@ -0,0 +1,50 @@
+//
+// Whole-world simulation state.
+//
+
+#ifndef TANKS2_WORLD_H
+#define TANKS2_WORLD_H
+
+#include <cstdint>
+#include <vector>
+#include "Item.h"
+
+/****************************************************************************
+ * Everything needed to reproduce a match lives here so that it can be
+ * saved, restored and hashed as one unit. Entities are stored by value,
+ * which lets a snapshot be copied back into the existing storage.
+ ***************************************************************************/
+struct TWorld {
+    TItemList bulletList; // In a Match only a copy of its live bullets, see Match::Synced()
+    TItemList tanksList;
+    TItemList explosionList;
+    TItemList blocksList;
+    TItemList treeList;
+    int curScrn = 0;
+    // Screens are laid out in a grid, numbered row by row
+    int screenCols = 2, screenRows = 2;
+    int blueCount = 0, redCount = 0;
+    int leftCnt = 0, rightCnt = 0;
+    uint32_t rngState = 1;
+    double score = 0;
+
+    int ScreenCount() const { return screenCols * screenRows; }
+};
+
+// Player actions, one bit each. A tick's input is a combination of these.
+const uint8_t ACT_RIGHT = 0x01;   // Rotate right
+const uint8_t ACT_LEFT = 0x02;    // Rotate left
+const uint8_t ACT_FORWARD = 0x04; // Move forward
+const uint8_t ACT_FIRE = 0x08;    // Shoot
+
+/****************************************************************************
+ * Random number in the range 0..0x7FFF. The generator state is part of the
+ * world so that a restored snapshot replays identically.
+ ***************************************************************************/
+inline int WorldRand(TWorld &world)
+{
+    world.rngState = world.rngState * 1103515245u + 12345u;
+    return (int)((world.rngState >> 16) & 0x7FFF);
+}
+
+#endif //TANKS2_WORLD_H
@@ -0,0 +1,126 @@
+# Generate SpriteInfo.h from images/sprites.txt and the image files.
+#   cmake -DSOURCE_DIR=<repo> -P cmake/SpriteInfo.cmake
+# The sizes of the PNG files are read from their headers, so the game can
+# use them as compile time constants.
+
+if(NOT SOURCE_DIR)
+    get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+endif()
+
+# Width and height from the IHDR chunk of a PNG file
+function(png_size file out_w out_h)
+    file(READ "${file}" header OFFSET 12 LIMIT 12 HEX)
+    string(SUBSTRING "${header}" 0 8 chunk)
+    if(NOT chunk STREQUAL "49484452")
+        message(FATAL_ERROR "${file} is not a PNG file")
+    endif()
+    string(SUBSTRING "${header}" 8 8 w)
+    string(SUBSTRING "${header}" 16 8 h)
+    math(EXPR w "0x${w}")
+    math(EXPR h "0x${h}")
+    set(${out_w} ${w} PARENT_SCOPE)
+    set(${out_h} ${h} PARENT_SCOPE)
+endfunction()
+
+set(sheets "")
+file(STRINGS "${SOURCE_DIR}/images/sprites.txt" lines)
+foreach(line IN LISTS lines)
+    if(line MATCHES "^[ \t]*(#|$)")
+        continue()
+    endif()
+    string(REGEX MATCHALL "[^ \t]+" f "${line}")
+    list(LENGTH f n)
+    if(NOT n EQUAL 6)
+        message(FATAL_ERROR "sprites.txt: bad line '${line}'")
+    endif()
+    list(GET f 0 name)
+    list(GET f 1 image)
+    list(GET f 2 fw)
+    list(GET f 3 fh)
+    list(GET f 4 frames)
+    list(GET f 5 columns)
+
+    png_size("${SOURCE_DIR}/images/${image}" w h)
+    if(fw EQUAL 0)
+        set(fw ${w})
+    endif()
+    if(fh EQUAL 0)
+        set(fh ${h})
+    endif()
+    math(EXPR rows "(${frames} + ${columns} - 1) / ${columns}")
+    math(EXPR needW "${fw} * ${columns}")
+    math(EXPR needH "${fh} * ${rows}")
+    if(w LESS needW OR h LESS needH)
+        message(FATAL_ERROR "${image} is ${w}x${h}, too small for ${frames} frames of ${fw}x${fh}")
+    endif()
+    set(SPRITE_${name}_W ${fw})
+    set(SPRITE_${name}_H ${fh})
+    set(SPRITE_${name}_FRAMES ${frames})
+
+    string(APPEND sheets "constexpr TSpriteSheet SPRITE_${name} = {\"images/${image}\", ${w}, ${h}, ${fw}, ${fh}, ${frames}, ${columns}};\n")
+endforeach()
+
+foreach(name BLUE_TANK RED_TANK DEAD_TANK EXPLOSION BLOCK TREE)
+    if(NOT DEFINED SPRITE_${name}_W)
+        message(FATAL_ERROR "sprites.txt has no ${name} entry")
+    endif()
+endforeach()
+if(NOT SPRITE_BLUE_TANK_FRAMES EQUAL 8 OR NOT SPRITE_RED_TANK_FRAMES EQUAL 8)
+    message(FATAL_ERROR "Tank sheets need one frame for each of the 8 directions")
+endif()
+
+# Directions go clockwise from up. A shot leaves from the middle of the
+# tank edge it faces, or from the corner on a diagonal.
+set(dirX 0 1 1 1 0 -1 -1 -1)
+set(dirY -1 -1 0 1 1 1 0 -1)
+set(muzzleX "")
+set(muzzleY "")
+foreach(d RANGE 7)
+    list(GET dirX ${d} dx)
+    list(GET dirY ${d} dy)
+    math(EXPR mx "(${dx} + 1) * ${SPRITE_BLUE_TANK_W} / 2")
+    math(EXPR my "(${dy} + 1) * ${SPRITE_BLUE_TANK_H} / 2")
+    list(APPEND muzzleX ${mx})
+    list(APPEND muzzleY ${my})
+endforeach()
+string(REPLACE ";" ", " dirX "${dirX}")
+string(REPLACE ";" ", " dirY "${dirY}")
+string(REPLACE ";" ", " muzzleX "${muzzleX}")
+string(REPLACE ";" ", " muzzleY "${muzzleY}")
+
+set(out "${SOURCE_DIR}/SpriteInfo.h")
+set(text "//
+// Sprite sheet sizes and tank geometry. Generated from images/sprites.txt
+// by cmake/SpriteInfo.cmake; do not edit, rebuild the sprite_info target.
+//
+
+#ifndef TANKS2_SPRITEINFO_H
+#define TANKS2_SPRITEINFO_H
+
+struct TSpriteSheet {
+    const char *file;
+    int width, height;           // Whole image
+    int frameWidth, frameHeight;
+    int frames, columns;
+};
+
+${sheets}
+// Step for each tank direction, 0 is up and they go clockwise
+constexpr int SPRITE_DIR_X[8] = {${dirX}};
+constexpr int SPRITE_DIR_Y[8] = {${dirY}};
+
+// Where a shot leaves the tank, relative to its top left corner
+constexpr int SPRITE_MUZZLE_X[8] = {${muzzleX}};
+constexpr int SPRITE_MUZZLE_Y[8] = {${muzzleY}};
+
+#endif //TANKS2_SPRITEINFO_H
+")
+
+# Leave the file alone when nothing changed so it does not trigger a rebuild
+if(EXISTS "${out}")
+    file(READ "${out}" old)
+endif()
+if(NOT old STREQUAL text)
+    file(WRITE "${out}" "${text}")
+    message(STATUS "Wrote ${out}")
+endif()
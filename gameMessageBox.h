@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include "DrawText.h"
+#include "Panel.h"
 
 #ifndef TANKS2_GAMEMESSAGEBOX_H
 #define TANKS2_GAMEMESSAGEBOX_H
@@ -16,12 +17,17 @@ const SDL_Color forColor = {0x00, 0x00, 0x1F, 0xFF};
 class gameMessageBox : DrawText {
 private:
    TTF_Font* font;
+   TPanel panel; // The last message, ready to draw again
 public:
 
     gameMessageBox();
     virtual ~gameMessageBox();
 
-    void ShowMessageBox(SDL_Renderer *renderer, const std::string& text, int x, int y, int w, int h) const;
+    TTF_Font *Font() const { return font; }
+    // Drop the cached message, e.g. before its renderer goes
+    void Invalidate() { panel.Invalidate(); }
+
+    void ShowMessageBox(SDL_Renderer *renderer, const std::string& text, int x, int y, int w, int h);
 
     void displayMultilineMessage(SDL_Renderer* renderer, const std::string& message,
         int x, int y, int width, int height, SDL_Color textColor=forColor, SDL_Color backgroundColor=backColor);
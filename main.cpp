@@ -26,96 +26,137 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "DrawText.h"
 #include "gameMessageBox.h"
 #include "Item.h"
-
-const int WINDOW_WIDTH = 800;
-const int WINDOW_HEIGHT = 600;
-const int BlueTank = 1;
-const int RedTank = 2;
-const int DeadTank = 3;
-const int DIR_COUNT = 8;
-const int EXP_COUNT = 3;
-const int DEAD_COUNT = 2;
-const int GoodGuyIdx = 0;
-const int FPS = 14;
-const int FRAME_DELAY = 1000/FPS;
-//const int FRAME_DELAY = 1000;
-
-int width = WINDOW_WIDTH;
-int height = WINDOW_HEIGHT - 40; // Leave space for score display
-SDL_Texture *blueTanks;
-SDL_Texture *redTanks;
-SDL_Texture *deadTanks;
-SDL_Texture *explosions;
-int ShotStartX[DIR_COUNT];
-int ShotStartY[DIR_COUNT];
-
-const int tankWidth = 32;
-const int tankHeight = 32;
-const int explosionWidth = 24;
-const int explosionHeight = 24;
-int tankGroupWidth = tankWidth*8;
-int blockWidth = 16;
-int blockHeight = 16;
-int treeWidth = 16;
-int treeHeight = 16;
-
-int  MaxX, MaxY;
-SDL_Texture *BlockImage;
-SDL_Texture *TreeImage;
-Mix_Chunk *popSound;
-
-int blueCount, redCount;
-int leftCnt=0;
-int rightCnt=0;
-std::vector<std::shared_ptr<TItemRec>> bulletList;
-std::vector<std::shared_ptr<TItemRec>> tanksList;
-std::vector<std::shared_ptr<TItemRec>> explosionList;
-std::vector<std::shared_ptr<TItemRec>> blocksList;
-std::vector<std::shared_ptr<TItemRec>> treeList;
-int curScrn;
+#include "Match.h"
+#include "Snapshot.h"
+#include "Rewind.h"
+#include "Net.h"
+#include "DirtyRenderer.h"
+#include "FrameExport.h"
+#include "MapGen.h"
+#include "RenderPipe.h"
+#include "SpriteAtlas.h"
+#include "Overview.h"
+#include "Particles.h"
+#include "Pacer.h"
+#include "Memory.h"
+#include "Panel.h"
+#include "HighScores.h"
+#include "Telemetry.h"
+#include "FileWatcher.h"
+#include "Audio.h"
+#include <cstddef>
+
+const int WINDOW_WIDTH = PLAY_WIDTH;
+const int WINDOW_HEIGHT = PLAY_HEIGHT + 40; // Leave space for score display
+const int REWIND_SECONDS = 3;
+
+int width = PLAY_WIDTH;
+int height = PLAY_HEIGHT;
+// Sprites at the size they are drawn, and where the game sits in the window
+TSpriteAtlas atlas;
+TViewScale view;
+bool smoothScaling = false; // Allow fractional scales, filtered
+// What the play area shows. M cycles through them.
+enum TViewMode { VIEW_SCREEN, VIEW_MINIMAP, VIEW_OVERVIEW } viewMode = VIEW_SCREEN;
+std::unique_ptr<TOverview> overview;
+// Debris and smoke over the play screen, window thread only
+TParticles particles;
+TParticleVerts particleVerts;
+TParticleIndices particleIndices;
+bool particlesOn = true;
+int particleScreen = -1; // Screen the particles belong to
+bool profilerOn = false;  // F3: memory per tag and frame costs over the game
+// Esc menu over the game; a local game waits while it is open
+std::unique_ptr<TPanel> gameMenu;
+bool gameMenuOpen = false;
+enum { MENU_RESUME, MENU_QUICKSAVE, MENU_QUICKLOAD, MENU_QUIT };
+static_assert(sizeof(TParticleVertex) == sizeof(SDL_Vertex) &&
+              offsetof(TParticleVertex, r) == offsetof(SDL_Vertex, color) &&
+              offsetof(TParticleVertex, u) == offsetof(SDL_Vertex, tex_coord),
+              "TParticleVertex must match SDL_Vertex");
+TAudio audio; // Played from SimThread(), which sees every tick's events
+
+// The match shown in the window
+Match match;
 char sUserName[40]; // Plenty for user
+// Best scores, kept in HighScoreFile by a thread of their own
+const char *HighScoreFile = "highscores.dat";
+std::unique_ptr<THighScores> highScores;
+std::unique_ptr<TPanel> scoreBoard;
+TTF_Font *scoreBoardFont = nullptr;
+int newHighScore = -1; // Rank of the score just entered
+// --watch: sprites and the --load level are reloaded when they change
+std::unique_ptr<TFileWatcher> watcher;
+std::mutex levelLock;
+std::shared_ptr<TWorld> pendingLevel; // Taken by SimThread() before its next tick
+std::shared_ptr<const TWorld> roundLevel; // The --load level, where every new round starts
+const char *QuickSaveFile = "quicksave.tnk";
+// Keyframe once a second, within a 2 MB budget.
+TRewindBuffer rewindBuffer(2 * 1024 * 1024, FPS);
+std::unique_ptr<TNetClient> netClient;
+std::unique_ptr<TDirtyRenderer> dirtyRenderer; // Set when drawing in software
+bool netSynced = false;     // A server state has been received
+uint8_t pendingAction = 0;  // Input collected for the next network tick
+
+// The simulation runs on its own thread while the window thread draws.
+// Finished ticks go to the window through renderFrames, key presses go the
+// other way through inputQueue.
+TTripleBuffer<TRenderFrame> renderFrames;
+TByteQueue inputQueue;
+TPipelineStats pipeStats;
+std::atomic<bool> simQuit{false};
+std::atomic<bool> simHold{false}; // Set to stop ticking, e.g. for the menu
+std::atomic<bool> simHeld{false}; // The thread has stopped; match is free
+std::atomic<bool> captureAll{false}; // Frames carry every screen, for the overview
+TFramePacer simPacer(FPS);   // Used by SimThread() only until it is joined
+// Queued next to the ACT_ bits
+const uint8_t CMD_QUICKSAVE = 0x40;
+const uint8_t CMD_QUICKLOAD = 0x80;
 
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 
-enum GameStates {ePlaying, eDrawMenu, eDoMenu,  eQuit} gameState;
+enum GameStates {ePlaying, eEnterName, eDrawMenu, eDoMenu,  eQuit} gameState;
 
-double score = 0;
 bool done = false;
 std::unique_ptr<DrawText> drawText;
 
 void InitGame();
+void NewRound();
 void ClearScreen();
 void FreeResources();
 bool ProgramIsRunning();
-void InitImages();
-void InitLists();
-void InitShotOffset();
-void InitScrn1();
-void InitScrn2();
-void InitScrn3();
-void InitScrn4();
+bool InitImages();
 void CheckKeyPress(bool &running, SDL_Event event);
 char GetKeyboardChar();
-void UpdateGame();
-void MoveTank(int tankIdx, int cnt);
-int MoveTopLeft(int pos, int cnt);
-int MoveBtmRight(int pos, int cnt, int max_val);
-void NewScreenCheck(int tankIdx);
-int CheckGameOver();
-void ChkCollisions();
-bool chkBump(int x, int y);
-bool TankCollision(int x,int y, int *idx);
-bool WallCollision(int x, int y, int *idx);
-bool Collision(int x, int y, int x1, int y1, int x2, int y2);
-bool AimingAtTarget(int idx);
-void badGuyRoutine(int tankIdx);
-void PaintGame();
-void ShowScore();
+void PlayEvents();
+void PaintGame(const TRenderFrame &frame);
+void ShowScore(const TRenderFrame &frame);
+void SetViewMode(TViewMode mode);
+void UpdateParticles(const TRenderFrame &frame, float dt);
+void DrawParticles();
+void DrawProfiler(const TRenderFrame &frame);
+void OpenGameMenu(bool open);
+void ShowHighScores(int x, int y, int w, int h);
+void StartWatcher(const char *levelFile);
+void GameMenuKey(bool &running, SDL_Keycode key);
+void UpdateView();
+void ShowMessage(gameMessageBox *box, const std::string &message, int x, int y, int w, int h);
+int RunDrawBench(int w, int h);
+void QuickSave();
+void QuickLoad();
+int RunServer(uint16_t port, const TLinkSim &link);
+int RunBotClient();
+int RunExport(const char *target, const char *loadFile, int frames);
+uint8_t BotAction();
+void NetClientTick(uint8_t action);
+void SimThread();
+void HoldSim();
 
 
 /*******************************************************************************
@@ -123,14 +164,13 @@ void ShowScore();
 *******************************************************************************/
 void FreeResources()
 {
-    explosionList.clear();
-    bulletList.clear();
-    tanksList.clear();
-    blocksList.clear();
-    treeList.clear();
-    // Free the pop sound
-    Mix_FreeChunk(popSound);
-    popSound = NULL;
+    match.explosionList.clear();
+    match.bulletList.clear();
+    match.bullets.Clear();
+    match.tanksList.clear();
+    match.blocksList.clear();
+    match.treeList.clear();
+    audio.Close();
 } // FreeResources
 
 /*************************************************************************************************
@@ -138,6 +178,129 @@ void FreeResources()
  ************************************************************************************************/
 int main(int argc, char* argv[]) {
     static int result = 0;
+    bool serverMode = false;
+    bool botMode = false;
+    bool softwareRender = false;
+    uint16_t port = NET_DEFAULT_PORT;
+    const char *connectHost = nullptr;
+    const char *exportTarget = nullptr;
+    const char *loadFile = nullptr;
+    int exportFrames = FPS * 60;
+    int windowW = WINDOW_WIDTH, windowH = WINDOW_HEIGHT;
+    Uint32 windowFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+    int benchW = 0, benchH = 0;
+    bool watchFiles = false;
+    const char *musicFile = nullptr;
+    const char *telemetryTarget = nullptr;
+    TLinkSim link;
+
+    // Networking options:
+    //   --server [port]        Run a headless authoritative server
+    //   --connect host[:port]  Join a server
+    //   --bot                  With --connect, play headless with random input
+    //   --lag ms, --jitter ms, --loss percent   Simulate a poor network
+    //   --software             Use the software renderer (dirty rectangles)
+    //   --map CxR[:seed]       Play on a generated map of C x R screens
+    // Display:
+    //   --window WxH           Initial window size; the game scales to fit
+    //   --fullscreen           Fill the desktop
+    //   --smooth               Scale by any factor with filtering, not just whole ones
+    //   --drawbench WxH        Time offscreen drawing at that size against 800x600
+    //   --minimap              Show all screens small in the status bar (M cycles)
+    //   --overview             Show all screens tiled instead of the current one
+    //   --no-particles         No debris, smoke or bullet trails
+    //   --watch                Reload sprites and the --load level when they change
+    //   --music file           Background music, streamed (ogg, mp3, wav...)
+    //   --telemetry target     Stream game events to a file or unix:socket
+    // Export:
+    //   --export target        Draw a match offscreen to PNG files or raw video
+    //   --frames n             Frames to export (default one minute)
+    //   --load file            Start from a saved snapshot (also when playing)
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc) && (argv[i + 1][0] != '-');
+        if (arg == "--server") {
+            serverMode = true;
+            if (hasValue)
+                port = (uint16_t)atoi(argv[++i]);
+        } else if (arg == "--connect" && hasValue) {
+            static std::string host;
+            host = argv[++i];
+            if (size_t colon = host.find(':'); colon != std::string::npos) {
+                port = (uint16_t)atoi(host.c_str() + colon + 1);
+                host.resize(colon);
+            }
+            connectHost = host.c_str();
+        } else if (arg == "--bot") {
+            botMode = true;
+        } else if (arg == "--lag" && hasValue) {
+            link.latencyMs = atoi(argv[++i]);
+        } else if (arg == "--jitter" && hasValue) {
+            link.jitterMs = atoi(argv[++i]);
+        } else if (arg == "--loss" && hasValue) {
+            link.lossPercent = atoi(argv[++i]);
+        } else if (arg == "--software") {
+            softwareRender = true;
+        } else if (arg == "--map" && hasValue) {
+            if (!ParseMapSize(argv[++i], match.mapCols, match.mapRows, match.mapSeed)) {
+                fprintf(stderr, "Expected --map COLSxROWS[:seed]\n");
+                return 1;
+            }
+        } else if (arg == "--export" && i + 1 < argc) {
+            exportTarget = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            exportFrames = atoi(argv[++i]);
+        } else if (arg == "--load" && hasValue) {
+            loadFile = argv[++i];
+        } else if (arg == "--window" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &windowW, &windowH) != 2 || windowW <= 0 || windowH <= 0) {
+                fprintf(stderr, "Expected --window WIDTHxHEIGHT\n");
+                return 1;
+            }
+        } else if (arg == "--fullscreen") {
+            windowFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+        } else if (arg == "--smooth") {
+            smoothScaling = true;
+        } else if (arg == "--minimap") {
+            viewMode = VIEW_MINIMAP;
+        } else if (arg == "--overview") {
+            viewMode = VIEW_OVERVIEW;
+        } else if (arg == "--no-particles") {
+            particlesOn = false;
+        } else if (arg == "--watch") {
+            watchFiles = true;
+        } else if (arg == "--music" && hasValue) {
+            musicFile = argv[++i];
+        } else if (arg == "--telemetry" && hasValue) {
+            telemetryTarget = argv[++i];
+        } else if (arg == "--drawbench" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &benchW, &benchH) != 2 || benchW <= 0 || benchH <= 0) {
+                fprintf(stderr, "Expected --drawbench WIDTHxHEIGHT\n");
+                return 1;
+            }
+        }
+    }
+
+    if (telemetryTarget != nullptr && !TelemetryStart(telemetryTarget))
+        fprintf(stderr, "Unable to open telemetry sink %s\n", telemetryTarget);
+
+    if (serverMode)
+        return RunServer(port, link);
+    if (exportTarget != nullptr)
+        return RunExport(exportTarget, loadFile, exportFrames);
+    if (benchW > 0)
+        return RunDrawBench(benchW, benchH);
+    if (connectHost != nullptr) {
+        netClient = std::make_unique<TNetClient>();
+        netClient->link = link;
+        if (!netClient->Connect(connectHost, port)) {
+            fprintf(stderr, "Unable to reach %s:%d\n", connectHost, port);
+            return 1;
+        }
+        if (botMode)
+            return RunBotClient();
+    }
+
     drawText = std::make_unique<DrawText>();
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
@@ -146,15 +309,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+    if (!audio.Open())
         return 1;
-    }
+    if (musicFile != nullptr)
+        audio.PlayMusic(musicFile);
 
     // Create a window
     SDL_Window* window = SDL_CreateWindow("Tank Invasion",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+        windowW, windowH, windowFlags);
     if (window == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
             "Unable to create window: %s", SDL_GetError());
@@ -164,79 +327,252 @@ int main(int argc, char* argv[]) {
 
     std::string strWinner = "You have defeated the invaders!\n\n";
     std::string strLost = "Your tank has been destroyed.\n\n";
+    std::string strRewind = "Rewind " + std::to_string(REWIND_SECONDS) + " seconds? (R)\n";
     std::string strAgain =  "Play again? (Y/N)";
 
 
     char msg[40];
     auto *msgBox = new gameMessageBox();
+    highScores = std::make_unique<THighScores>(HighScoreFile); // Loads while we set up
+    scoreBoardFont = TTF_OpenFont("fonts/Vera.ttf", 16);
+    scoreBoard = std::make_unique<TPanel>(scoreBoardFont, forColor, backColor);
+    gameMenu = std::make_unique<TPanel>(msgBox->Font(), forColor, backColor);
+    gameMenu->SetMenu("Paused", {"Resume", "Quick-save (F5)", "Quick-load (F9)", "Quit"}, 300, 230);
 
     // Create a renderer
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1,
+                                  softwareRender ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
     if (renderer == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to create renderer: %s", SDL_GetError());
         SDL_DestroyWindow(window);
         SDL_Quit();
         return 1;
     }
-
+    if (!InitImages()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "The images do not match SpriteInfo.h");
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+    // No GPU: draw only what changed straight into the window surface
+    if (SDL_RendererInfo info; SDL_GetRendererInfo(renderer, &info) == 0 &&
+                               (info.flags & SDL_RENDERER_SOFTWARE))
+        dirtyRenderer = std::make_unique<TDirtyRenderer>(window, atlas);
+    overview = std::make_unique<TOverview>(atlas);
+    SetViewMode(viewMode);
+    UpdateView();
     InitGame();
+    if (loadFile != nullptr && !netClient) {
+        if (LoadSnapshotFile(loadFile, match)) {
+            match.RebuildWalls();
+            match.LoadBullets();
+            roundLevel = std::make_shared<const TWorld>(match);
+        } else
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to load %s", loadFile);
+    }
+    if (watchFiles)
+        StartWatcher(netClient ? nullptr : loadFile);
+    std::thread simThread(SimThread);
     // Game loop
     SDL_Event event;
     bool running = true;
     gameState = ePlaying;
+    TFramePacer menuPacer(FPS); // The menu's own loop; play is paced by SimThread()
     while (running) {
-        long int oldTime = SDL_GetTicks(); //We will use this later to see how long it took to update the frame
+        bool presented = false;
+        FrameArena().Reset(); // Scratch from the last frame is finished with
+        if (watcher)
+            watcher->ApplyReady(); // Between frames, so nothing is half drawn
 
         switch (gameState) {
-            case ePlaying:
+            case ePlaying: {
                 // Handle events
                 while (SDL_PollEvent(&event)) {
                     if (event.type == SDL_QUIT) {
                         running = false;
                     } else if (event.type == SDL_KEYDOWN) {
                         CheckKeyPress(running, event);
+                    } else if (event.type == SDL_WINDOWEVENT &&
+                               event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                        UpdateView();
                     }
                 }
 
-                // Update game state (this is where your game logic would go)
-                UpdateGame();
-                // ...
-
-                // Render the scene
-                SDL_SetRenderDrawColor(renderer, 200, 150, 110, 255); // Set background color to blue
-                SDL_RenderClear(renderer); // Clear the renderer
+                // Draw the newest finished tick, if there is one. While the
+                // menu holds the game the last one is drawn again under it.
+                const bool fresh = renderFrames.Acquire();
+                if (!fresh) {
+                    SDL_Delay(gameMenuOpen ? 1000 / FPS : 1);
+                    if (!gameMenuOpen)
+                        continue;
+                }
+                const TRenderFrame &frame = renderFrames.Front();
+                Uint64 drawStart = SDL_GetPerformanceCounter();
+                static Uint64 lastDraw = drawStart;
+                if (fresh)
+                    UpdateParticles(frame, std::min(0.1f, (float)(drawStart - lastDraw) /
+                                                          (float)SDL_GetPerformanceFrequency()));
+                lastDraw = drawStart;
+                if (viewMode == VIEW_OVERVIEW && frame.allScreens) {
+                    ClearScreen();
+                    overview->Draw(renderer, frame, view.Rect(0, 0, PLAY_WIDTH, PLAY_HEIGHT), true);
+                    ShowScore(frame);
+                } else if (dirtyRenderer && viewMode == VIEW_SCREEN && particles.Count() == 0 &&
+                           !profilerOn && !gameMenuOpen) {
+                    char s[20];
+                    sprintf(s, "Score: %4.1f", frame.score);
+                    dirtyRenderer->Draw(frame, *drawText, s);
+                    presented = true;
+                } else {
+                    SDL_SetRenderDrawColor(renderer, 200, 150, 110, 255); // Set background color to blue
+                    SDL_RenderClear(renderer); // Clear the renderer
 
-                // ... (draw game objects here)
-                PaintGame();
+                    // ... (draw game objects here)
+                    PaintGame(frame);
 
-                ShowScore();
-                result = CheckGameOver();
-                if (result > 0)
+                    ShowScore(frame);
+                    if (viewMode == VIEW_MINIMAP)
+                        overview->Draw(renderer, frame, view.Rect(4, PLAY_HEIGHT + 2, 400, 36), false);
+                    if (dirtyRenderer)
+                        dirtyRenderer->Invalidate(); // Its picture of the window is stale now
+                }
+                if (profilerOn && !presented)
+                    DrawProfiler(frame);
+                if (gameMenuOpen)
+                    gameMenu->Draw(renderer, view.Rect((width - 300) / 2, (height - 230) / 2, 300, 230));
+                result = frame.result;
+                if (netClient) {
+                    // The server starts the next round by itself
+                    int x = width / 6;
+                    if (!frame.synced || result > 0) {
+                        if (!frame.synced)
+                            ShowMessage(msgBox, "Connecting...", x, height / 4, width - x * 2, height / 6);
+                        else
+                            ShowMessage(msgBox, "Round over.\n\nWaiting for the next round",
+                                        x, height / 4, width - x * 2, height / 4);
+                        if (dirtyRenderer)
+                            dirtyRenderer->Invalidate();
+                        presented = false;
+                    }
+                } else if (result > 0) {
+                    // The simulation holds itself
+                    newHighScore = -1;
+                    if (result == 1 && highScores->Qualifies(frame.score)) {
+                        SDL_StartTextInput();
+                        gameState = eEnterName;
+                    } else {
+                        gameState = eDrawMenu;
+                    }
+                    gameMenuOpen = false;
+                    menuPacer.Restart();
+                }
+                if (!presented)
+                    SDL_RenderPresent(renderer);
+                if (fresh)
+                    pipeStats.Shown(frame, (double)(SDL_GetPerformanceCounter() - drawStart) * 1000.0 /
+                                           SDL_GetPerformanceFrequency());
+                continue; // Paced by the simulation
+            }
+            case eEnterName: {
+                // Drawn every frame; the box is only laid out again when the name changes
+                bool entered = false;
+                while (SDL_PollEvent(&event)) {
+                    const size_t len = strlen(sUserName);
+                    if (event.type == SDL_QUIT) {
+                        running = false;
+                    } else if (event.type == SDL_WINDOWEVENT &&
+                               event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                        UpdateView();
+                    } else if (event.type == SDL_TEXTINPUT) {
+                        // Printable ASCII only; the font has nothing else
+                        size_t n = len;
+                        for (const char *c = event.text.text; *c && n < HIGH_SCORE_NAME - 1; c++)
+                            if (*c >= ' ' && *c <= '~')
+                                sUserName[n++] = *c;
+                        sUserName[n] = 0;
+                    } else if (event.type == SDL_KEYDOWN) {
+                        const SDL_Keycode key = event.key.keysym.sym;
+                        if (key == SDLK_BACKSPACE && len > 0)
+                            sUserName[len - 1] = 0;
+                        else if (key == SDLK_RETURN && len > 0)
+                            entered = true;
+                        else if (key == SDLK_ESCAPE)
+                            gameState = eDrawMenu; // Not recorded
+                    }
+                }
+                if (entered) {
+                    newHighScore = highScores->Add(sUserName, renderFrames.Front().score);
                     gameState = eDrawMenu;
+                }
+                if (gameState != eEnterName) {
+                    SDL_StopTextInput();
+                    break;
+                }
+                PaintGame(renderFrames.Front());
+                ShowScore(renderFrames.Front());
+                std::string s = "You made the high score table!\n\n";
+                sprintf(msg, "Your score: %4.1f\n\n", renderFrames.Front().score);
+                s += msg;
+                s += "Name: " + std::string(sUserName) + "_\n\nEnter to save, Esc to skip";
+                int x = width / 6;
+                ShowMessage(msgBox, s, x, height / 4, width - x * 2, height / 2);
                 break;
+            }
             case eDrawMenu: {
+                menuPacer.Restart();
+                if (dirtyRenderer)
+                    dirtyRenderer->Invalidate(); // The box covers the screen until the next game
                 std::string s;
                 if (result == 1) {
-                    sprintf(msg, "\nYour score: %4.1f", score);
+                    sprintf(msg, "\nYour score: %4.1f\n\n", renderFrames.Front().score);
                     s = strWinner + msg + strAgain;
                 } else {
-                    s = strLost + strAgain;
+                    s = strLost + strRewind + strAgain;
                 }
 
                 int x = width / 6;
                 int w = width - x * 2;
-                msgBox->displayMultilineMessage(renderer, s, x, height / 4, w, height / 3);
+                if (highScores->Count() > 0) {
+                    // Room for the table under the box
+                    const int boxY = height / 10, boxH = height / 3;
+                    ShowMessage(msgBox, s, x, boxY, w, boxH);
+                    ShowHighScores(x, boxY + boxH + 8, w, height - (boxY + boxH + 8) - 12);
+                } else {
+                    ShowMessage(msgBox, s, x, height / 4, w, height / 3);
+                }
                 gameState = eDoMenu;
                 break;
             }
             case eDoMenu:
                 while (SDL_PollEvent(&event)) {
+                    if (event.type == SDL_WINDOWEVENT &&
+                        event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                        // The last frame is still there, draw it again under the box
+                        UpdateView();
+                        PaintGame(renderFrames.Front());
+                        ShowScore(renderFrames.Front());
+                        gameState = eDrawMenu;
+                        break;
+                    }
                     if (event.type == SDL_KEYDOWN) {
                         if (const SDL_Keycode key = event.key.keysym.sym; key == SDLK_y) {
-                            InitLists();
-                            curScrn = 0;
+                            HoldSim();
+                            NewRound();
+                            simHold = false;
                             gameState = ePlaying;
                             break;
+                        } else if (key == SDLK_r && result == 2) {
+                            HoldSim();
+                            if (rewindBuffer.Rewind(match, REWIND_SECONDS * FPS)) {
+                                match.LoadBullets();
+                                SDL_Log("Rewind: %.1f us, %d ticks of history kept, %.1f KB per second",
+                                        rewindBuffer.LastRewindMicros(), rewindBuffer.Depth(),
+                                        rewindBuffer.BytesPerTick() * FPS / 1024.0);
+                                simHold = false;
+                                gameState = ePlaying;
+                            }
+                            break;
                         } else if (key == SDLK_n) {
                             gameState = eQuit;
                             break;
@@ -249,15 +585,44 @@ int main(int argc, char* argv[]) {
                 running = false;
                 break;
         }
-        SDL_RenderPresent(renderer); // Present the rendered frame
-        // Limit frame rate
-        //Don't delay if we do not need to
-        if (const long frameTime = SDL_GetTicks() - oldTime; frameTime < FRAME_DELAY)
-            SDL_Delay(FRAME_DELAY - frameTime); //Delay
+        if (!presented)
+            SDL_RenderPresent(renderer); // Present the rendered frame
+        menuPacer.Wait();
+    }
+
+    simQuit = true;
+    simThread.join();
+    char stats[4096];
+    pipeStats.Format(stats, sizeof(stats));
+    SDL_Log("Pipeline: %s", stats);
+    simPacer.Format(stats, sizeof(stats));
+    SDL_Log("Tick pacing: %s", stats);
+    audio.Format(stats, sizeof(stats));
+    SDL_Log("Audio: %s", stats);
+    if (telemetryOn) {
+        TelemetryStop();
+        TelemetryFormat(stats, sizeof(stats));
+        SDL_Log("Telemetry: %s", stats);
+    }
+
+    if (watcher) {
+        SDL_Log("Hot reload: %d files, last %.1f ms, mean %.1f ms, worst %.1f ms from change to swap",
+                watcher->Reloads(), watcher->LastMs(), watcher->MeanMs(), watcher->WorstMs());
+        watcher.reset();
     }
 
     // Clean up
     delete msgBox;
+    gameMenu.reset();
+    scoreBoard.reset();
+    TTF_CloseFont(scoreBoardFont);
+    if (highScores->Failures() > 0)
+        SDL_Log("High scores: %d reads or writes of %s failed", highScores->Failures(), HighScoreFile);
+    highScores.reset(); // Waits for the last write
+    dirtyRenderer.reset();
+    overview.reset();
+    atlas.ReleaseTextures();
+    audio.Close();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -270,1336 +635,736 @@ int main(int argc, char* argv[]) {
 ****************************************************************************/
 void InitGame()
 {
-    InitImages();
-    InitLists();
-    InitShotOffset();
-    MaxX = width - tankWidth;
-    MaxY = height - tankHeight;
+    match.InitLists();
     /* initialize random seed: */
-    srand (time(NULL));
-
-    popSound = Mix_LoadWAV("sounds/explosion_x.wav");
-    if (popSound == NULL) {
-        printf("Failed to load pop sound! SDL_mixer Error: %s\n", Mix_GetError());
-    }
-    curScrn = 0;
+    match.rngState = (uint32_t)time(NULL);
+    match.curScrn = 0;
     sUserName[0] = 0; // clear the name
-} // InitGame
 
-/*****************************************************************************
-* Shot should start after canon barrel. This routin sets the offset relative
-* to the tank image based on the direction.
-*****************************************************************************/
-void InitShotOffset()
-{
-    // Up
-    ShotStartX[0] = tankWidth / 2;
-    ShotStartY[0] = 0;
-    // Up/Right
-    ShotStartX[1] = tankWidth;
-    ShotStartY[1] = 0;
-    // Right
-    ShotStartX[2] = tankWidth;
-    ShotStartY[2] = tankHeight / 2;
-    // Rignt/Down
-    ShotStartX[3] = tankWidth;
-    ShotStartY[3] = tankHeight;
-    // Down
-    ShotStartX[4] = tankWidth / 2;
-    ShotStartY[4] = tankHeight;
-    // Down/Left
-    ShotStartX[5] = 0;
-    ShotStartY[5] = tankHeight;
-    // Left
-    ShotStartX[6] = 0;
-    ShotStartY[6] = tankHeight / 2;
-    // Left/Up
-    ShotStartX[7] = 0;
-    ShotStartY[7] = 0;
-}
+    if (renderer == nullptr)
+        return; // Headless, no sound either
+
+    audio.LoadSounds();
+} // InitGame
 
 /******************************************************************************
-* Read the image files.
+* Read the image files. Returns false if any is missing or has changed size
+* since SpriteInfo.h was generated.
 ******************************************************************************/
-void InitImages()
+bool InitImages()
 {
-    // Init Tank Images
-    blueTanks = IMG_LoadTexture(renderer, "images/TankSpriteBlue.png");
-    redTanks = IMG_LoadTexture(renderer, "images/TankSpriteRed.png");
-    deadTanks = IMG_LoadTexture(renderer, "images/deadTankSprite.png");
-    explosions = IMG_LoadTexture(renderer, "images/ExplosionSprite.png");
-
-    Uint32 format;
-    int access;
-    BlockImage = IMG_LoadTexture(renderer, "images/Bricks.png");
-    SDL_QueryTexture(BlockImage, &format, &access, &blockWidth, &blockHeight);
-    TreeImage = IMG_LoadTexture(renderer, "images/Tree1.png");
-    SDL_QueryTexture(TreeImage, &format, &access, &treeWidth, &treeHeight);
+    return atlas.Load();
 }
 
 /******************************************************************************
-* Clear all lists and counters. Reset the screens
+* Fit the game to the current output size: pick the scale, rescale the
+* sprites and the score font to it. Called at start and on every resize.
 ******************************************************************************/
-void InitLists()
+void UpdateView()
 {
-    explosionList.clear();
-    bulletList.clear();
-    tanksList.clear();
-    blocksList.clear();
-    treeList.clear();
-    blueCount = 1;
-    redCount  = 8;
-    score = 1000.0;
-    InitScrn1();
-    InitScrn2();
-    InitScrn3();
-    InitScrn4();
+    int w = WINDOW_WIDTH, h = WINDOW_HEIGHT;
+    if (renderer != nullptr)
+        SDL_GetRendererOutputSize(renderer, &w, &h); // Pixels, also on high DPI screens
+    view = TViewScale::Fit(w, h, WINDOW_WIDTH, WINDOW_HEIGHT, smoothScaling);
+    atlas.SetScale(view.scale, smoothScaling);
+    drawText->setFontSize((int)std::lround(22 * view.scale));
+    if (dirtyRenderer)
+        dirtyRenderer->SetView(view);
+    SDL_Log("Output %dx%d, scale %.2f, sprites scaled in %.1f ms", w, h, view.scale,
+            atlas.BuildMs());
 }
 
 /******************************************************************************
-* Procedure: InitScrn1;
-* Parameters: None
-* This function initializes screen [0], the top left game screen.
-*     ||
-* [0] ||  1
-* ==========
-*  2  ||  3
-*     ||
+* Message box in game coordinates. The box draws its own text, so it is
+* scaled by the renderer rather than rebuilt for each size.
 ******************************************************************************/
-void InitScrn1()
+void ShowMessage(gameMessageBox *box, const std::string &message, int x, int y, int w, int h)
 {
-    const int boxTop = 110;
-    const int boxLeft = 90;
-    const int boxH = 20; // blocks high
-    const int boxW = 20; // blocks wide
-    const int scrNo = 0;
-
-    std::shared_ptr<TItemRec> TnkPtr;
-    std::shared_ptr<TItemRec> ptRec;
-
-    int w = blockWidth;
-    int h = blockHeight;
-    int gate_y1 = (height / 4) + (blockHeight / 2);
-    int gate_y2 = gate_y1 * 2;
-    int gate_x1 = (width / 4) + (blockWidth / 2);
-    int gate_x2 = gate_x1 * 2;
-
-    int i = w;
-
-    blocksList.clear();
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = i;
-        ptRec->y = 0;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_x1) ||(i >= gate_x2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = i;
-            ptRec->y = height - h;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + w;
-    } while( i < (width - w));
-
-    i = 0;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = 0;
-        ptRec->y = i;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_y1) || (i >= gate_y2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = width - w;
-            ptRec->y = i;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + h;
-    } while( i < (height - h));
-
-    int x = boxLeft;
-    int y = boxTop;
-    for(i = 0; i < boxW; i++)
-    {
-        //top
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        // bottom
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = boxTop + (boxH * h);
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        x = x + w;
-    } // next i
+    const float k = (float)view.scale;
+    SDL_RenderSetScale(renderer, k, k);
+    box->displayMultilineMessage(renderer, message, x + (int)std::lround(view.offsetX / k),
+                                 y + (int)std::lround(view.offsetY / k), w, h);
+    SDL_RenderSetScale(renderer, 1, 1);
+}
 
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 4;
-    TnkPtr->color = BlueTank; // Good guy
-    TnkPtr->x = 20;
-    TnkPtr->y = 20;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 4;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = 150;
-    TnkPtr->y = 30;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 2;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = 160;
-    TnkPtr->y = 200;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 140;
-    ptRec->y = height / 2;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 60;
-    ptRec->y = (height / 2) + 110;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 50;
-    ptRec->y = (height / 2) - 220;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-    //*********************************************
-} // InitScrn1
 
 /******************************************************************************
-* Procedure: InitScrn2;
-* Parameters: None
-* This function initializes screen [1], the top right game screen.
-*     ||
-*  0  || [1]
-* ==========
-*  2  ||  3
-*     ||
+* The high score table in a box, the score just entered marked.
 ******************************************************************************/
-void InitScrn2()
+void ShowHighScores(int x, int y, int w, int h)
 {
-    const int boxTop = 110;
-    const int boxLeft = 90;
-    const int boxH = 20; // blocks high
-    const int boxW = 20; // blocks wide
-    const int scrNo = 1;
-
-    std::shared_ptr<TItemRec> TnkPtr;
-    std::shared_ptr<TItemRec> ptRec;
-
-    int w = blockWidth;
-    int h = blockHeight;
-    int gate_y1 = (height / 4) + (blockHeight / 2);
-    int gate_y2 = gate_y1 * 2;
-    int gate_x1 = (width / 4) + (blockWidth / 2);
-    int gate_x2 = gate_x1 * 2;
-
-    int i = w;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = i;
-        ptRec->y = 0;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_x1) ||(i >= gate_x2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = i;
-            ptRec->y = height - h;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + w;
-    } while( i < (width - w));
-
-    i = 0;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = width - w;
-        ptRec->y = i;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_y1) || (i >= gate_y2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = 0;
-            ptRec->y = i;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + h;
-    } while( i < (height - h));
-
-    int x = boxLeft;
-    int y = boxTop;
-    for(i = 0; i < boxW; i++)
-    {
-        //top
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        // bottom
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x + (boxW * w);
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        y = y + h;
-    } // next i
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 4;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = width - 40;
-    TnkPtr->y = 30;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 2;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = 160;
-    TnkPtr->y = 200;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 40;
-    ptRec->y = height / 2;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 60;
-    ptRec->y = (height / 2) + 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 50;
-    ptRec->y = (height / 2) + 15;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 4) - 20;
-    ptRec->y = (height / 4) + 20;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 3) - 60;
-    ptRec->y = (height / 4) + 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 3) - 50;
-    ptRec->y = (height / 4) + 15;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-    //***********************************************}
-} // void InitScrn2()
+    std::vector<std::string> lines;
+    for (int i = 0; i < highScores->Count(); i++) {
+        THighScore e = highScores->At(i);
+        char line[64];
+        snprintf(line, sizeof(line), "%2d.  %s  %.1f", i + 1, e.name, e.tenths / 10.0);
+        lines.emplace_back(line);
+    }
+    scoreBoard->SetMenu("High scores", lines, w, h);
+    scoreBoard->Select(newHighScore);
+    scoreBoard->Draw(renderer, view.Rect(x, y, w, h));
+}
 
 /******************************************************************************
-* Procedure: InitScrn3;
-* Parameters: None
-* This function initializes screen[2], the bottom left game screen.
-*
-*     ||
-*  0  ||  1
-* ==========
-* [2] ||  3
-*     ||
+* Watch the sprite sheets and the level file. Files are read and decoded on
+* the watcher's thread; sprites are swapped in between frames, a level by
+* SimThread() between ticks.
 ******************************************************************************/
-void InitScrn3()
+void StartWatcher(const char *levelFile)
 {
-    const int boxTop = 115;
-    const int boxLeft = 90;
-    const int boxH = 18; // blocks high
-    const int boxW = 22; // blocks wide
-    const int scrNo = 2;
-
-    std::shared_ptr<TItemRec> TnkPtr;
-    std::shared_ptr<TItemRec> ptRec;
-
-    int w = blockWidth;
-    int h = blockHeight;
-    int gate_y1 = (height / 4) + (blockHeight / 2);
-    int gate_y2 = gate_y1 * 2;
-    int gate_x1 = (width / 4) + (blockWidth / 2);
-    int gate_x2 = gate_x1 * 2;
-
-    int i = w;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = i;
-        ptRec->y = height - h;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_x1) ||(i >= gate_x2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = i;
-            ptRec->y = 0;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + w;
-    } while( i < (width - w));
-
-    i = 0;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = 0;
-        ptRec->y = i;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_y1) || (i >= gate_y2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = width - w;
-            ptRec->y = i;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + h;
-    } while( i < (height - h));
-
-    int x = boxLeft;
-    int y = boxTop;
-    for(i = 0; i < boxW; i++)
-    {
-        //top
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        // bottom
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x + (boxW * w);
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        y = y + h;
-    } // next i
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 4;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = width - 40;
-    TnkPtr->y = 30;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 2;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = 160;
-    TnkPtr->y = height - 60;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 45;
-    ptRec->y = (height / 2) - 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 60;
-    ptRec->y = (height / 2) + 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 50;
-    ptRec->y = (height / 2) + 15;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 4) - 20;
-    ptRec->y = (height / 4) + 20;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 3) - 60;
-    ptRec->y = (height / 4) + 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 3) - 50;
-    ptRec->y = (height / 4) + 15;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-    //***********************************************}
-} // InitScrn3()
+    watcher = std::make_unique<TFileWatcher>();
+    for (int i = 0; i < SPR_COUNT; i++) {
+        const TSpriteId id = (TSpriteId)i;
+        watcher->Watch(TSpriteAtlas::File(id), [id](const std::string &) -> TFileWatcher::TSwap {
+            SDL_Surface *decoded = TSpriteAtlas::Decode(id);
+            if (decoded == nullptr)
+                return nullptr; // Keep the old one until the file is fixed
+            return [id, decoded] {
+                atlas.Replace(id, decoded);
+                overview->Invalidate();
+                if (dirtyRenderer)
+                    dirtyRenderer->Invalidate();
+                SDL_Log("Reloaded %s", TSpriteAtlas::File(id));
+            };
+        });
+    }
+    if (levelFile != nullptr) {
+        watcher->Watch(levelFile, [](const std::string &path) -> TFileWatcher::TSwap {
+            auto level = std::make_shared<TWorld>();
+            if (!LoadSnapshotFile(path.c_str(), *level)) {
+                SDL_Log("%s is not a level, keeping the current one", path.c_str());
+                return nullptr;
+            }
+            return [level, path] {
+                std::lock_guard<std::mutex> guard(levelLock);
+                pendingLevel = level;
+                SDL_Log("Reloaded %s", path.c_str());
+            };
+        });
+    }
+    if (!watcher->Start()) {
+        SDL_Log("Watching files is not supported here");
+        watcher.reset();
+    }
+}
 
 /******************************************************************************
-* Procedure: InitScrn4;
-* Parameters: None
-* This function initializes screen [3], the bottom right game screen.
-*
-*     ||
-*  0  ||  1
-* ==========
-*  2  || [3]
-*     ||
+* Switch what the play area shows. Every screen is only captured while a
+* view needs it; frames already on the way are drawn the old way.
 ******************************************************************************/
-void InitScrn4()
+void SetViewMode(TViewMode mode)
 {
-    const int boxTop = 110;
-    const int boxLeft = 110;
-    const int boxH = 18; // blocks high
-    const int boxW = 18; // blocks wide
-    const int scrNo = 3;
-
-    std::shared_ptr<TItemRec> TnkPtr;
-    std::shared_ptr<TItemRec> ptRec;
-
-    int w = blockWidth;
-    int h = blockHeight;
-    int gate_y1 = (height / 4) + (h / 2);
-    int gate_y2 = gate_y1 * 2;
-    int gate_x1 = (width / 4) + (w / 2);
-    int gate_x2 = gate_x1 * 2;
-
-    int i = w;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = i;
-        ptRec->y = height - h;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_x1) ||(i >= gate_x2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = i;
-            ptRec->y = 0;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + w;
-    } while( i < (width - w));
-
-    i = 0;
-    do{
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = width - w;
-        ptRec->y = i;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        if((i < gate_y1) || (i >= gate_y2))
-        {
-            ptRec = std::make_shared<TItemRec>();
-            ptRec->x = 0;
-            ptRec->y = i;
-            ptRec->screen = scrNo;
-            blocksList.push_back(ptRec);
-        }
-        i = i + h;
-    } while( i < (height - h));
-
-    int x = boxLeft;
-    int y = boxTop;
-    for(i = 0; i < boxW; i++)
-    {
-        //top
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        // bottom
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = boxTop + (boxH * h);;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        x = x + w;
-    } // next i
-
-    x = boxLeft;
-    for(i = 0; i < boxH; i++)
-    {
-        //top
-        ptRec = std::make_shared<TItemRec>();
-        ptRec->x = x;
-        ptRec->y = y;
-        ptRec->screen = scrNo;
-        blocksList.push_back(ptRec);
-        y = y + h;
-    } // next i
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 4;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = width - 40;
-    TnkPtr->y = 30;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    TnkPtr = std::make_shared<TItemRec>();
-    TnkPtr->directionIdx = 2;
-    TnkPtr->color = RedTank; // Bad guy
-    TnkPtr->x = 160;
-    TnkPtr->y = height - 60;
-    TnkPtr->screen = scrNo;
-    tanksList.push_back(TnkPtr);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 45;
-    ptRec->y = (height / 2) - 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 60;
-    ptRec->y = (height / 2) + 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 2) - 50;
-    ptRec->y = (height / 2) + 15;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 4) - 20;
-    ptRec->y = (height / 4) + 20;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 3) - 60;
-    ptRec->y = (height / 4) + 10;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-
-    ptRec = std::make_shared<TItemRec>();
-    ptRec->x = (width / 3) - 50;
-    ptRec->y = (height / 4) + 15;
-    ptRec->screen = scrNo;
-    treeList.push_back(ptRec);
-    //***********************************************}
-} // InitScrn4()
+    viewMode = mode;
+    captureAll = mode != VIEW_SCREEN;
+    if (dirtyRenderer)
+        dirtyRenderer->Invalidate(); // Drawn through the renderer meanwhile
+}
 
 /******************************************************************************
 * CheckKeyPress
 * Key down event handler.
 ******************************************************************************/
 void CheckKeyPress(bool &running, SDL_Event event) {
-    std::shared_ptr<TItemRec> tnkPtr(tanksList[GoodGuyIdx]);
-    bool pnt = false;
+    if (gameMenuOpen) {
+        GameMenuKey(running, event.key.keysym.sym);
+        return;
+    }
+    uint8_t action = 0;
     if (event.key.keysym.scancode == SDL_SCANCODE_RIGHT) {
-        tnkPtr->directionIdx = tnkPtr->directionIdx + 1;
-        if (tnkPtr->directionIdx >= DIR_COUNT)
-            tnkPtr->directionIdx = 0;
-        pnt = true;
+        action = ACT_RIGHT;
     } else if (event.key.keysym.scancode == SDL_SCANCODE_LEFT) {
-        tnkPtr->directionIdx = tnkPtr->directionIdx - 1;
-        if (tnkPtr->directionIdx < 0)
-            tnkPtr->directionIdx = DIR_COUNT - 1;
-        pnt = true;
+        action = ACT_LEFT;
     } else if (event.key.keysym.scancode == SDL_SCANCODE_UP) {
-        MoveTank(GoodGuyIdx, 3);
-        pnt = true;
+        action = ACT_FORWARD;
     } else if (event.key.keysym.scancode == SDL_SCANCODE_SPACE) {
-        std::shared_ptr<TItemRec> brPtr(new TItemRec);
-        brPtr->directionIdx = tnkPtr->directionIdx;
-        brPtr->dist = 0;
-        brPtr->x = tnkPtr->x + ShotStartX[tnkPtr->directionIdx];
-        brPtr->y = tnkPtr->y + ShotStartY[tnkPtr->directionIdx];
-        brPtr->screen = curScrn;
-        bulletList.push_back(brPtr);
-        pnt = true;
+        action = ACT_FIRE;
+    } else if (event.key.keysym.scancode == SDL_SCANCODE_F5) {
+        action = CMD_QUICKSAVE;
+    } else if (event.key.keysym.scancode == SDL_SCANCODE_F9) {
+        action = CMD_QUICKLOAD;
+    } else if (event.key.keysym.scancode == SDL_SCANCODE_M) {
+        SetViewMode((TViewMode)((viewMode + 1) % 3));
+    } else if (event.key.keysym.scancode == SDL_SCANCODE_F3) {
+        profilerOn = !profilerOn;
     } else if (event.key.keysym.scancode == SDL_SCANCODE_ESCAPE) {
-        running = false;
-    }
-    if (pnt) {
-        rightCnt = 0;
-        leftCnt = 0;
+        OpenGameMenu(true);
     }
+    if (action != 0)
+        inputQueue.Push(action); // Applied by SimThread() on its next tick
 }
 
-
-char GetKeyboardChar()
+/******************************************************************************
+* Show or hide the Esc menu. A local game is held meanwhile; a networked
+* one goes on, since the server does not wait.
+******************************************************************************/
+void OpenGameMenu(bool open)
 {
-    char c = ' ';
-    const Uint8 *key = SDL_GetKeyboardState(NULL);
-    if(key[SDLK_y])
-        c = 'Y';
-    else if(key[SDLK_n])
-        c= 'N';
-    return c;
-} // GetKeyboardChar
-
-void move_bullets() {
-    const int moveCnt = 6;
-    // Move bullets
-    for (auto it = bulletList.begin(); it != bulletList.end();) {
-        std::shared_ptr<TItemRec> brPtr = *it;
-        // track the distance the bullet moved
-        brPtr->dist = brPtr->dist + moveCnt;
-        bool bullet_done = false;
-        switch (brPtr->directionIdx) {
-            case 0: // Up
-                if ((brPtr->y - moveCnt) > 1)
-                    brPtr->y = brPtr->y - moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 1: // Up / right
-                if ((brPtr->y - moveCnt) > 1)
-                    brPtr->y = brPtr->y - moveCnt;
-                else
-                    bullet_done = true;
-                if ((brPtr->x + moveCnt) < width)
-                    brPtr->x = brPtr->x + moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 2: // right
-                if ((brPtr->x + moveCnt) < width)
-                    brPtr->x = brPtr->x + moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 3: // down / right
-                if ((brPtr->y + moveCnt) < height)
-                    brPtr->y = brPtr->y + moveCnt;
-                else
-                    bullet_done = true;
-                if ((brPtr->x + moveCnt) < width)
-                    brPtr->x = brPtr->x + moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 4: // Down
-                if ((brPtr->y + moveCnt) < height)
-                    brPtr->y = brPtr->y + moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 5: // Down / left
-                if ((brPtr->y + moveCnt) < height)
-                    brPtr->y = brPtr->y + moveCnt;
-                else
-                    bullet_done = true;
-                if ((brPtr->x - moveCnt) > 1)
-                    brPtr->x = brPtr->x - moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 6: // Left
-                if ((brPtr->x - moveCnt) > 1)
-                    brPtr->x = brPtr->x - moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            case 7: // Up / Left
-                if ((brPtr->y - moveCnt) > 1)
-                    brPtr->y = brPtr->y - moveCnt;
-                else
-                    bullet_done = true;
-                if ((brPtr->x - moveCnt) > 1)
-                    brPtr->x = brPtr->x - moveCnt;
-                else
-                    bullet_done = true;
-                break;
-            default:
-                break;
-        } // end switch
-        if (bullet_done) {
-            it = bulletList.erase(it);
-        } else {
-            ++it;
-        }
-    } // next bullet
+    gameMenuOpen = open;
+    if (!netClient)
+        simHold = open;
+    if (open) {
+        gameMenu->Select(MENU_RESUME);
+        if (dirtyRenderer)
+            dirtyRenderer->Invalidate();
+    }
 }
 
-void animate_explosions() {
-    // Animate explosions
-    for(int i = (int)explosionList.size()-1; i>=0; i--)
-    {
-        std::shared_ptr<TItemRec> ExpRec(explosionList[i]);
-        ExpRec->directionIdx++;
-        if(ExpRec->directionIdx >= EXP_COUNT)
-        {
-            explosionList.erase (explosionList.begin()+i);
-        }
+void GameMenuKey(bool &running, SDL_Keycode key)
+{
+    if (key == SDLK_ESCAPE) {
+        OpenGameMenu(false);
+    } else if (key == SDLK_UP || key == SDLK_DOWN) {
+        gameMenu->MoveSelection(key == SDLK_UP ? -1 : 1);
+    } else if (key == SDLK_RETURN || key == SDLK_SPACE) {
+        const int item = gameMenu->Selected();
+        OpenGameMenu(false);
+        if (item == MENU_QUICKSAVE)
+            inputQueue.Push(CMD_QUICKSAVE);
+        else if (item == MENU_QUICKLOAD)
+            inputQueue.Push(CMD_QUICKLOAD);
+        else if (item == MENU_QUIT)
+            running = false;
     }
 }
 
-/****************************************************************************
-* Summary: Update all game objects.
-****************************************************************************/
-void UpdateGame()
+/******************************************************************************
+* SimThread
+* Simulation side of the pipeline. Ticks at FPS, applies the queued input
+* and publishes a render frame after every tick, so drawing and presenting
+* never hold up the game. After a local game ends it holds until the menu
+* has set up the next one.
+******************************************************************************/
+void SimThread()
 {
-    char s[20];
-    //bool done;
-
-    move_bullets();
-    animate_explosions();
-
-    blueCount = 0;
-    redCount = 0;
-    for(int i = tanksList.size()-1; i >= 0; i--)
-    {
-        std::shared_ptr<TItemRec> TnkPtr(tanksList[i]);
+    uint32_t tick = 0;
+    simPacer.Restart();
+    while (!simQuit) {
+        if (simHold) {
+            simHeld = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            simPacer.Restart();
+            continue;
+        }
+        simHeld = false;
 
-        if (TnkPtr->color == DeadTank)
+        TRenderClock::time_point start = TRenderClock::now();
+        std::shared_ptr<TWorld> level;
         {
-             TnkPtr->directionIdx++;
-             if(TnkPtr->directionIdx >= DEAD_COUNT)
-                TnkPtr->directionIdx = 0;
+            std::lock_guard<std::mutex> guard(levelLock);
+            level.swap(pendingLevel);
         }
-        else if(TnkPtr->color == BlueTank)
-            blueCount++;
-        else if(TnkPtr->color == RedTank)
-        {
-            redCount++;
-            badGuyRoutine(i);
+        if (level && !netClient) { // The server owns an online match
+            static_cast<TWorld &>(match) = *level;
+            match.RebuildWalls();
+            match.LoadBullets();
+            rewindBuffer.Clear();
+            roundLevel = std::move(level);
         }
-    } // next i
-    if(score > 0)
-        score -= 0.1;
-
-     ChkCollisions();
-    //Image1.Repaint;
-    CheckGameOver();
-}
+        for (uint8_t cmd; inputQueue.Pop(cmd);) {
+            if ((cmd == CMD_QUICKSAVE || cmd == CMD_QUICKLOAD) && netClient)
+                SDL_Log("Quick-save and quick-load are not available online"); // The server owns the match
+            else if (cmd == CMD_QUICKSAVE)
+                QuickSave();
+            else if (cmd == CMD_QUICKLOAD)
+                QuickLoad();
+            else if (netClient)
+                pendingAction |= cmd; // Sent and predicted on the next tick
+            else
+                match.ApplyAction(match.playerIdx, cmd);
+        }
+        if (netClient) {
+            NetClientTick(pendingAction);
+            pendingAction = 0;
+        } else {
+            match.UpdateGame();
+            rewindBuffer.Record(match.Synced());
+        }
+        PlayEvents();
+
+        TRenderFrame &frame = renderFrames.Back();
+        CaptureFrame(match, frame, captureAll);
+        frame.tick = ++tick;
+        frame.synced = !netClient || netSynced;
+        frame.published = TRenderClock::now();
+        frame.simMs = std::chrono::duration<double, std::milli>(frame.published - start).count();
+        TelemetryEmit(TEL_TICK, match.telemetrySource, match.tick, -1, match.curScrn,
+                      match.blueCount + match.redCount, (int)match.bullets.Size(),
+                      (int)std::lround(frame.simMs * 1000));
+        if (!netClient && frame.result > 0)
+            simHold = true; // Wait for the menu
+        renderFrames.Publish();
+        simPacer.Wait();
+    }
+} // SimThread
 
-/*****************************************************************************
-* Summary:
-* Parameters:
-*   tankIdx, Tank to be moved.
-*   cnt, Number of pixelsto move
-*****************************************************************************/
-void MoveTank(int tankIdx, int cnt)
+/******************************************************************************
+* Start a fresh round from the --load level, or from the screens of --map
+* when no level was loaded. The simulation thread must be held.
+******************************************************************************/
+void NewRound()
 {
-    std::shared_ptr<TItemRec> tnkPtr(tanksList[tankIdx]);
-    int x = tnkPtr->x;
-    int y = tnkPtr->y;
-    switch(tnkPtr->directionIdx)
-    {
-        case 0:
-            y = MoveTopLeft(tnkPtr->y, cnt);
-            break;
-        case 1:
-            y = MoveTopLeft(tnkPtr->y, cnt);
-            x = MoveBtmRight(tnkPtr->x, cnt, MaxX );
-            break;
-        case 2:
-            x = MoveBtmRight(tnkPtr->x, cnt, MaxX );
-            break;
-        case 3:
-            x = MoveBtmRight(tnkPtr->x, cnt, MaxX );
-            y = MoveBtmRight(tnkPtr->y, cnt, MaxY);
-            break;
-        case 4:
-            y = MoveBtmRight(tnkPtr->y, cnt, MaxY);
-            break;
-        case 5:
-            y = MoveBtmRight(tnkPtr->y, cnt, MaxY);
-            x = MoveTopLeft(tnkPtr->x, cnt);
-            break;
-        case 6:
-            x = MoveTopLeft(tnkPtr->x, cnt);
-            break;
-        case 7:
-            y = MoveTopLeft(tnkPtr->y, cnt);
-            x = MoveTopLeft(tnkPtr->x, cnt);
-            break;
-    } // end switch
-    int xt = tnkPtr->x + ShotStartX[tnkPtr->directionIdx];
-    int yt = tnkPtr->y + ShotStartY[tnkPtr->directionIdx];
-
-    if(!chkBump( xt,yt))
-    {
-        tnkPtr->x = x;
-        tnkPtr->y = y;
+    if (roundLevel) {
+        static_cast<TWorld &>(match) = *roundLevel;
+        match.RebuildWalls();
+        match.LoadBullets();
+    } else {
+        match.InitLists();
+        match.curScrn = 0;
     }
-    NewScreenCheck(tankIdx);
-} // MoveTank
-
-/*****************************************************************************
-* Summary:
-* Parameters:
-*****************************************************************************/
-int MoveTopLeft(int pos, int cnt)
+    rewindBuffer.Clear();
+} // NewRound
+
+/******************************************************************************
+* Stop the simulation thread so the window thread can change the match.
+* Clear simHold to let it go again.
+******************************************************************************/
+void HoldSim()
 {
-    pos = pos - cnt;
-    if(pos < 1)
-        pos = 0;
-    return pos;
+    simHold = true;
+    while (!simHeld)
+        SDL_Delay(1);
 }
 
-/*****************************************************************************
-* Summary:
-* Parameters:
-*****************************************************************************/
-int MoveBtmRight(int pos, int cnt, int max_val)
+/******************************************************************************
+* Save the whole match to the quick-save file.
+******************************************************************************/
+void QuickSave()
 {
-    pos = pos + cnt;
-    if(pos >= max_val)
-        pos = max_val - 1;
-    return pos;
-}
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool ok = SaveSnapshotFile(QuickSaveFile, match.Synced());
+    double us = (double)(SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+    if (ok)
+        SDL_Log("Quick-save: %zu bytes in %.1f us", SnapshotSize(match.Synced()), us);
+    else
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to write %s", QuickSaveFile);
+} // QuickSave
 
-/*****************************************************************************
-* Summary: When moving thru a door, mov tank to the new screen.
-*     ||
-*  0  ||  1
-* ==========
-*  2  ||  3
-*     ||
-* Parameters:
-*****************************************************************************/
-void NewScreenCheck(int tankIdx)
+/******************************************************************************
+* Restore the whole match from the quick-save file.
+******************************************************************************/
+void QuickLoad()
 {
-    std::shared_ptr<TItemRec> tnkPtr(tanksList[tankIdx]);
-    bool thruDoor = false;
-    if(tnkPtr->screen == 0)
-    {
-        if(tnkPtr->x >= (MaxX - 4))
-        {
-            tnkPtr->screen = 1;
-            tnkPtr->x = 5;
-            thruDoor = true;
-        }
-        else if(tnkPtr->y >= (MaxY - 4))
-        {
-            // Screen 3?
-            tnkPtr->screen = 2;
-            tnkPtr->y = 5;
-            thruDoor = true;
-        }
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool ok = LoadSnapshotFile(QuickSaveFile, match);
+    if (ok) {
+        match.RebuildWalls();
+        match.LoadBullets();
     }
-    else if(tnkPtr->screen == 1)
-    {
-        if(tnkPtr->x < 4)
-        {
-            tnkPtr->screen = 0;
-            tnkPtr->x = MaxX - (tankWidth + 1);
-            thruDoor = true;
-        }
-        else if(tnkPtr->y >= (MaxY - 4))
-        {
-            tnkPtr->screen = 3;
-            tnkPtr->y = 5;
-            thruDoor = true;
-        }
+    double us = (double)(SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+    if (ok)
+        SDL_Log("Quick-load: %zu bytes in %.1f us", SnapshotSize(match.Synced()), us);
+    else
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to load %s", QuickSaveFile);
+} // QuickLoad
+
+/******************************************************************************
+* Start a network round: fresh screens, then one tank per connected player.
+* The first player takes the usual blue tank.
+******************************************************************************/
+static void StartNetRound(TNetServer &server)
+{
+    match.InitLists();
+    for (int c = 0; c < server.ClientCount(); c++)
+        server.SetClientTank(c, c == 0 ? GoodGuyIdx : match.AddPlayerTank(c));
+}
+
+/******************************************************************************
+* RunServer
+* Headless authoritative server. Every tick it applies one input from each
+* client, runs UpdateGame() and sends the result to all clients. Bandwidth
+* per client and simulation cost per player are printed every 5 seconds.
+******************************************************************************/
+int RunServer(uint16_t port, const TLinkSim &link)
+{
+    const int statsTicks = FPS * 5;
+    const int roundOverTicks = FPS * 3;
+
+    SDL_Init(SDL_INIT_TIMER);
+    TNetServer server;
+    server.link = link;
+    if (!server.Open(port)) {
+        fprintf(stderr, "Unable to open UDP port %d\n", port);
+        return 1;
     }
-    else if(tnkPtr->screen == 2)
-    {
-        if(tnkPtr->y < 4)
-        {
-            tnkPtr->screen = 0;
-            tnkPtr->y = MaxY - (tankHeight + 1);
-            thruDoor = true;
+    printf("Server listening on UDP port %d\n", port);
+
+    match.playerIdx = -1; // No local player
+    InitGame();
+    server.mapCols = match.mapCols;
+    server.mapRows = match.mapRows;
+    server.mapSeed = match.mapSeed;
+    server.onJoin = [&server]() {
+        if (server.ClientCount() == 0) {
+            match.InitLists(); // First player gets a fresh round
+            return GoodGuyIdx;
         }
-        else if(tnkPtr->x >= (MaxX - 4))
-        {
-            tnkPtr->screen = 3;
-            tnkPtr->x = 5;
-            thruDoor = true;
+        return match.AddPlayerTank(server.ClientCount());
+    };
+    server.onLeave = [](int tankIdx) {
+        if (tankIdx >= 0 && tankIdx < (int)match.tanksList.size()) {
+            match.tanksList[tankIdx].color = DeadTank;
+            match.tanksList[tankIdx].directionIdx = 0;
         }
-    }
-    else if(tnkPtr->screen == 3)
-    {
-        if(tnkPtr->x < 4)
-        {
-            tnkPtr->screen = 2;
-            tnkPtr->x = MaxX - (tankWidth + 1);
-            thruDoor = true;
+    };
+
+    uint32_t tick = 0;
+    int roundOver = 0;
+    int statTicks = 0;
+    double tickUs = 0;
+    double playerTicks = 0;
+    uint64_t statBytes = 0;
+    TFramePacer pacer(FPS);
+    while (true) {
+        server.Poll();
+        int players = server.ClientCount();
+        if (players > 0) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int c = 0; c < players; c++)
+                match.ApplyAction(server.ClientTank(c), server.NextInput(c));
+            match.UpdateGame();
+            tickUs += (double)(SDL_GetPerformanceCounter() - start) * 1000000.0 / SDL_GetPerformanceFrequency();
+            playerTicks += players;
+
+            server.SendState(match.Synced(), ++tick);
+
+            if (match.CheckGameOver() == 0)
+                roundOver = 0;
+            else if (++roundOver >= roundOverTicks)
+                StartNetRound(server);
         }
-        else if(tnkPtr->y < 4)
-        {
-            tnkPtr->screen = 1;
-            tnkPtr->y = MaxY - (tankHeight + 1);
-            thruDoor = true;
+
+        if (++statTicks >= statsTicks) {
+            double seconds = (double)statTicks / FPS;
+            double perClient = players > 0 ? (server.BytesSent() - statBytes) / seconds / players : 0;
+            printf("clients %d, %.2f KB/s per client, tick %.1f us, %.1f us per player\n",
+                   players, perClient / 1024.0, tickUs / statTicks,
+                   playerTicks > 0 ? tickUs / playerTicks : 0.0);
+            fflush(stdout);
+            statBytes = server.BytesSent();
+            statTicks = 0;
+            tickUs = 0;
+            playerTicks = 0;
         }
+        pacer.Wait();
     }
-    if (thruDoor && (tnkPtr->color == BlueTank)) // Goog guy?
-        curScrn = tnkPtr->screen;
-}
+} // RunServer
 
-/*****************************************************************************
-*
-*****************************************************************************/
-int CheckGameOver()
+/******************************************************************************
+* NetClientTick
+* One client tick: build the server's map if ours differs, take the newest
+* server state, replay the inputs the server has not applied yet on top of
+* it, then send and predict this tick's input.
+******************************************************************************/
+void NetClientTick(uint8_t action)
 {
-    int rval = 0;
-    if(redCount < 1)
-    {
-        rval = 1;
+    uint32_t ackSeq = 0;
+    int tank = -1;
+
+    netClient->Poll();
+    if (netClient->MapCols() > 0 &&
+        (netClient->MapCols() != match.mapCols || netClient->MapRows() != match.mapRows ||
+         netClient->MapSeed() != match.mapSeed)) {
+        // Build the server's map; its states only carry the moving items
+        match.mapCols = netClient->MapCols();
+        match.mapRows = netClient->MapRows();
+        match.mapSeed = netClient->MapSeed();
+        match.InitLists();
     }
-    else if(blueCount < 1) // You loose
-    {
-        rval = 2;
+    if (netClient->TakeState(match, ackSeq, tank)) {
+        match.LoadBullets();
+        match.playerIdx = tank;
+        netSynced = true;
+        uint32_t last = netClient->LastSeq();
+        uint32_t first = ackSeq + 1;
+        if (last - ackSeq >= (uint32_t)NET_INPUT_WINDOW)
+            first = last - NET_INPUT_WINDOW + 1;
+        // Replayed ticks were already heard, their events are dropped
+        for (uint32_t seq = first; seq <= last; seq++) {
+            match.ApplyAction(match.playerIdx, netClient->InputAt(seq));
+            match.UpdateGame();
+        }
     }
-    return rval;
-}
+    if (!netSynced)
+        return;
 
-/*****************************************************************************
-* Summary:
-* Parameters: None
-*****************************************************************************/
-void ChkCollisions()
-{
-    int j=0;
-    for(int i = bulletList.size()-1; i >= 0;i--)
-    {
-        std::shared_ptr<TItemRec> brPtr(bulletList[i]);
-        std::shared_ptr<TItemRec> expRec(new TItemRec);
-        if(TankCollision(brPtr->x, brPtr->y, &j))
-        {
-            if(j >= 0 && j < tanksList.size())
-            {
-                std::shared_ptr<TItemRec> TnkPtr = tanksList[j];
-                expRec->x = brPtr->x - (explosionWidth / 2);
-                expRec->y = brPtr->y - (explosionHeight / 2);
-                expRec->directionIdx = 0;
-                expRec->screen = curScrn;
-                explosionList.push_back(expRec);
-                TnkPtr->color = DeadTank;
-                TnkPtr->directionIdx = 0;
-                bulletList.erase (bulletList.begin()+i);
-                // Play pop sound
-                Mix_PlayChannel(-1, popSound, 0);
-            }
-        }
-        else if(WallCollision(brPtr->x, brPtr->y, &j))
-        {
-            if(j >= 0 && j <  blocksList.size())
-            {
-                expRec->x = brPtr->x - (explosionWidth / 2);
-                expRec->y = brPtr->y - (explosionHeight / 2);
-                expRec->directionIdx = 0;
-                expRec->screen = curScrn;
-                explosionList.push_back(expRec);
-                bulletList.erase (bulletList.begin()+i);
-                // Play pop sound
-                Mix_PlayChannel(-1, popSound, 0);
-            }
-        }
-    } // next i
-}
+    netClient->SendInput(action);
+    match.ApplyAction(match.playerIdx, action);
+    match.UpdateGame();
+    if (match.playerIdx >= 0 && match.playerIdx < (int)match.tanksList.size())
+        match.curScrn = match.tanksList[match.playerIdx].screen;
+} // NetClientTick
 
-/*****************************************************************************
-* Summary:
-* Parameters:
-*****************************************************************************/
-bool chkBump(int x, int y)
+/******************************************************************************
+* RunBotClient
+* Headless client driving its tank with random input, for load testing a
+* server on one machine. Prints its bandwidth every 5 seconds.
+******************************************************************************/
+int RunBotClient()
 {
-    bool retVal = false;
-    int idx = 0;
+    const int statsTicks = FPS * 5;
 
-    return TankCollision(x,y,&idx) || WallCollision(x,y, &idx);
-}
+    SDL_Init(SDL_INIT_TIMER);
+    InitGame();
+    int statTicks = 0;
+    uint64_t statIn = 0, statOut = 0;
+    TFramePacer pacer(FPS);
+    while (true) {
+        NetClientTick(BotAction());
+
+        if (++statTicks >= statsTicks) {
+            double seconds = (double)statTicks / FPS;
+            printf("bot tank %d, in %.2f KB/s, out %.2f KB/s, game %d\n", match.playerIdx,
+                   (netClient->BytesReceived() - statIn) / seconds / 1024.0,
+                   (netClient->BytesSent() - statOut) / seconds / 1024.0, match.CheckGameOver());
+            fflush(stdout);
+            statIn = netClient->BytesReceived();
+            statOut = netClient->BytesSent();
+            statTicks = 0;
+        }
+        pacer.Wait();
+    }
+} // RunBotClient
 
-/*****************************************************************************
-* Summary: When moving thru a door, mov tank to the new screen.
-* Parameters:
-*****************************************************************************/
-bool TankCollision(int x,int y, int *idx)
+/******************************************************************************
+* BotAction
+* Random input for headless players: mostly driving, some turning and firing.
+******************************************************************************/
+uint8_t BotAction()
 {
-    bool retval = false;
+    const uint8_t actions[] = {ACT_FORWARD, ACT_FORWARD, ACT_FORWARD, ACT_RIGHT, ACT_LEFT, ACT_FIRE};
+    return actions[rand() % sizeof(actions)];
+} // BotAction
 
-    *idx = -1;
-    int i = tanksList.size() - 1;
-    while(i >=0)
-    {
-        std::shared_ptr<TItemRec> tnkPtr(tanksList[i]);
-        if(tnkPtr->screen == curScrn)
-        {
-            int x1 = tnkPtr->x;
-            int y1 = tnkPtr->y;
-            int x2 = tnkPtr->x + tankWidth;
-            int y2 = tnkPtr->y + tankHeight;
-            if(Collision(x, y, x1, y1, x2, y2))
-            {
-                retval = true;
-                *idx = i;
-                i = 0;
-                break;
-            }
+/******************************************************************************
+* RunExport
+* Play a match with random input, drawing every tick into an offscreen
+* surface, and export the frames. The simulation runs as fast as it can;
+* conversion and compression happen on the exporter's worker threads.
+* Targets ending in ".png" give a PNG sequence, anything else raw I420
+* video (see TFrameExporter).
+******************************************************************************/
+int RunExport(const char *target, const char *loadFile, int frames)
+{
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "Unable to initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_Surface *canvas = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, WINDOW_HEIGHT, 32,
+                                                         SDL_PIXELFORMAT_ARGB8888);
+    renderer = canvas ? SDL_CreateSoftwareRenderer(canvas) : nullptr;
+    if (renderer == nullptr) {
+        fprintf(stderr, "Unable to create offscreen renderer: %s\n", SDL_GetError());
+        return 1;
+    }
+    drawText = std::make_unique<DrawText>();
+    if (!InitImages()) {
+        fprintf(stderr, "The images do not match SpriteInfo.h\n");
+        return 1;
+    }
+    match.InitLists();
+    if (loadFile != nullptr) {
+        if (!LoadSnapshotFile(loadFile, match)) {
+            fprintf(stderr, "Unable to load %s\n", loadFile);
+            return 1;
         }
-        i = i-1;
+        match.RebuildWalls();
+        match.LoadBullets();
     }
 
-    return retval;
-}
-
-/*****************************************************************************
-* Summary: When moving thru a door, mov tank to the new screen.
-* Parameters: x,y  - Point to be tested
-*             idx  - Index of the wall block to ne checked
-* Returns: True if point is inside the wall block
-* Test collision of point with a wall block.
-*****************************************************************************/
-bool WallCollision(int x, int y, int *idx)
-{
-    bool retval = false;
+    std::string name = target;
+    bool png = name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0;
+    TFrameExporter exporter(png ? EXPORT_PNG : EXPORT_YUV, name, WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (!exporter.Ok())
+        return 1;
 
-    int i = blocksList.size() - 1;
-    while(i >=0)
-    {
-        std::shared_ptr<TItemRec> ptRec(blocksList[i]);
-        if(ptRec->screen == curScrn)
-        {
-            int x1 = ptRec->x - 1;
-            int y1 = ptRec->y - 1;
-            int x2 = ptRec->x + blockWidth;
-            int y2 = ptRec->y + blockHeight;
-            if(Collision(x, y, x1, y1, x2, y2))
-            {
-                retval = true;
-                *idx = i;
-                i = 0;
-                break;
-            }
-        }
-        i = i - 1;
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+    TRenderFrame exportFrame;
+    int frame = 0;
+    while (frame < frames && match.CheckGameOver() == 0) {
+        match.ApplyAction(match.playerIdx, BotAction());
+        match.UpdateGame();
+        CaptureFrame(match, exportFrame);
+        UpdateParticles(exportFrame, 1.0f / FPS);
+        PaintGame(exportFrame);
+        ShowScore(exportFrame);
+        SDL_RenderPresent(renderer); // Finishes drawing into the canvas
+        exporter.Submit(canvas);
+        frame++;
     }
-    return retval;
-}
+    double simSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
+    exporter.Finish();
+    double totalSeconds = (double)(SDL_GetPerformanceCounter() - start) / freq;
 
-/*****************************************************************************
-* Test to see if point is inside rectangle.
-* Parameters:
-*   x, y            - Point
-*   x1, y1, x2, y2  - Rectangle
-* Returns:
-*****************************************************************************/
-bool Collision(int x, int y, int x1, int y1, int x2, int y2)
-{
-    bool retval = ((x >x1) && (x <x2) && (y > y1) && (y < y2));
+    // Progress goes to stderr, stdout may be carrying the video
+    fprintf(stderr, "%ld of %d frames exported in %.2f s, %.1f frames/s; "
+            "drawing %.1f frames/s, %.0f ms waiting for the encoder\n",
+            exporter.FramesWritten(), frame, totalSeconds, exporter.FramesPerSecond(),
+            frame / simSeconds, exporter.StallMs());
 
-    return retval;
-} // Collision
+    atlas.ReleaseTextures();
+    SDL_DestroyRenderer(renderer);
+    renderer = nullptr;
+    SDL_FreeSurface(canvas);
+    SDL_Quit();
+    return exporter.FramesWritten() == frame ? 0 : 1;
+} // RunExport
 
 /******************************************************************************
-* Test to see if tank[idx] is aiming at a target.
+* Time PaintGame() offscreen at the given output size and at the original
+* 800x600, on the same ticks, with the software renderer. Shows what the
+* scaled sprite sheets cost compared to drawing at 1:1.
 ******************************************************************************/
-bool AimingAtTarget(int idx)
+int RunDrawBench(int w, int h)
 {
-    bool retVal = false;
-    std::shared_ptr<TItemRec> tnkPtr(tanksList[idx]);
-    int x2 = tnkPtr->x + (tankWidth / 2);
-    int y2 = tnkPtr->y + (tankHeight / 2);
-    int dir = tnkPtr->directionIdx;
-
-    tnkPtr = tanksList[GoodGuyIdx];
-
-    if(tnkPtr->color == BlueTank )
-    {
-        int x1 = tnkPtr->x + (tankWidth / 2);
-        int y1 = tnkPtr->y + (tankHeight / 2);
-
-        int deltaX  = (x1 - x2);
-        int deltaY  = (y2 - y1);
-        int t = 999;
-        if(deltaY != 0)
-            t = (deltaX * 100) / deltaY;
-        switch(dir)
-        {
-            case 0:
-                retVal = (deltaY > 1) && ( abs(t) < 20);
-                break;
-            case 1:
-                retVal = (deltaX > 1) && ( t > 40) and (t < 300);
-                break;
-            case 2:
-                retVal = (deltaX > 1) && ( abs(t) > 400);
-                break;
-            case 3:
-                retVal = (deltaX > 1) && ( t < -40) and (t > -300);
-                break;
-            case 4:
-                retVal = (deltaY < -1) && ( abs(t) < 20);
-                break;
-            case 5:
-                retVal = (deltaX < -1) && ( t > 40) and (t < 300);
-                break;
-            case 6:
-                retVal = (deltaX < -1) && ( abs(t) > 400);
-                break;
-            case 7:
-                retVal = (deltaX < -1) && ( t < -40) and (t > -300);
-                break;
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "Unable to initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    drawText = std::make_unique<DrawText>();
+    if (!InitImages()) {
+        fprintf(stderr, "The images do not match SpriteInfo.h\n");
+        return 1;
+    }
+    const int ticks = FPS * 10;
+    const int sizes[2][2] = {{WINDOW_WIDTH, WINDOW_HEIGHT}, {w, h}};
+    for (const auto &size : sizes) {
+        SDL_Surface *canvas = SDL_CreateRGBSurfaceWithFormat(0, size[0], size[1], 32,
+                                                             SDL_PIXELFORMAT_ARGB8888);
+        renderer = canvas ? SDL_CreateSoftwareRenderer(canvas) : nullptr;
+        if (renderer == nullptr) {
+            fprintf(stderr, "Unable to create offscreen renderer: %s\n", SDL_GetError());
+            return 1;
+        }
+        UpdateView();
+        match.InitLists();
+        match.rngState = 1;
+        TRenderFrame benchFrame;
+        Uint64 drawTicks = 0;
+        for (int i = 0; i < ticks && match.CheckGameOver() == 0; i++) {
+            match.ApplyAction(match.playerIdx, BotAction());
+            match.UpdateGame();
+            CaptureFrame(match, benchFrame);
+            Uint64 start = SDL_GetPerformanceCounter();
+            UpdateParticles(benchFrame, 1.0f / FPS);
+            PaintGame(benchFrame);
+            ShowScore(benchFrame);
+            SDL_RenderPresent(renderer);
+            drawTicks += SDL_GetPerformanceCounter() - start;
         }
+        fprintf(stderr, "%dx%d: scale %.2f, %.3f ms per frame, sprites scaled in %.1f ms\n",
+                size[0], size[1], view.scale,
+                (double)drawTicks * 1000.0 / SDL_GetPerformanceFrequency() / ticks, atlas.BuildMs());
+        atlas.ReleaseTextures();
+        SDL_DestroyRenderer(renderer);
+        renderer = nullptr;
+        SDL_FreeSurface(canvas);
     }
+    SDL_Quit();
+    return 0;
+} // RunDrawBench
 
-    return retVal;
-}// AimingAtTarget
-/*****************************************************************************
- * Summary:
- * Parameters:
- *****************************************************************************/
-void badGuyRoutine(int tankIdx) {
-    std::shared_ptr<TItemRec> tnkPtr(tanksList[tankIdx]);
-
-    int i = rand() % 10 + 1;
-    if (i == 2) {
-        tnkPtr->directionIdx++;
-        if (tnkPtr->directionIdx >= DIR_COUNT)
-            tnkPtr->directionIdx = 0;
-    } else if (i == 4) {
-        tnkPtr->directionIdx--;
-        if (tnkPtr->directionIdx < 1)
-            tnkPtr->directionIdx = DIR_COUNT - 1;
-    } else {
-        MoveTank(tankIdx, 2);
-        if (tnkPtr->y < 2) {
-            if (tnkPtr->directionIdx < 2)
-                tnkPtr->directionIdx++;
-            else if (tnkPtr->directionIdx == (DIR_COUNT - 1))
-                tnkPtr->directionIdx--;
-        } else if (tnkPtr->y >= (MaxY - 2)) {
-            if ((tnkPtr->directionIdx < 6) && (tnkPtr->directionIdx >= 3))
-                    tnkPtr->directionIdx--;
-            else if (tnkPtr->directionIdx == 6)
-                tnkPtr->directionIdx++;
-        } else if (tnkPtr->x < 2) {
-            if (tnkPtr->directionIdx == 7)
-                tnkPtr->directionIdx = 0;
-            else if (tnkPtr->directionIdx >= 5)
-                tnkPtr->directionIdx--;
-        } else if (tnkPtr->x >= (MaxX - 2)) {
-            if (tnkPtr->directionIdx == 1)
-                tnkPtr->directionIdx--;
-            else if ((tnkPtr->directionIdx == 2) || (tnkPtr->directionIdx == 3))
-                tnkPtr->directionIdx--;
-        }
+char GetKeyboardChar()
+{
+    char c = ' ';
+    const Uint8 *key = SDL_GetKeyboardState(NULL);
+    if(key[SDLK_y])
+        c = 'Y';
+    else if(key[SDLK_n])
+        c= 'N';
+    return c;
+} // GetKeyboardChar
+
+/******************************************************************************
+* PlayEvents
+* Sound for what happened during the last tick.
+******************************************************************************/
+void PlayEvents()
+{
+    // Heard from the player's tank, or the middle of the screen without one
+    int listenerX = PLAY_WIDTH / 2, listenerY = PLAY_HEIGHT / 2;
+    if (match.playerIdx >= 0 && match.playerIdx < (int)match.tanksList.size()) {
+        const TItemRec &tank = match.tanksList[match.playerIdx];
+        listenerX = tank.x + tankWidth / 2;
+        listenerY = tank.y + tankHeight / 2;
     }
-    if (AimingAtTarget(tankIdx) && (tnkPtr->screen == curScrn)) {
-        std::shared_ptr<TItemRec> brPtr(new TItemRec);
-        brPtr->directionIdx = tnkPtr->directionIdx;
-        brPtr->dist = 0;
-        brPtr->screen = tnkPtr->screen;
-        brPtr->x = tnkPtr->x + ShotStartX[tnkPtr->directionIdx];
-        brPtr->y = tnkPtr->y + ShotStartY[tnkPtr->directionIdx];
-        bulletList.push_back(brPtr);
+    for (const TGameEvent &ev : match.events) {
+        if (ev.screen != match.curScrn)
+            continue; // Out of earshot
+        audio.PlayAt(ev.type == EV_TANK_HIT ? SND_TANK_HIT : SND_WALL_HIT, ev.x, ev.y, listenerX,
+                     listenerY);
     }
-} // badGuyRoutine
+} // PlayEvents
 
 /****************************************************************************
-*
+* Draw a whole sprite at a position in game coordinates. The size is given
+* by the view so neighbouring walls meet without gaps.
 ****************************************************************************/
-void DrawImage(SDL_Texture* image, const int x, const int y,
+void DrawImage(TSpriteId image, const int x, const int y,
     const int w, const int h)
 {
-    SDL_Rect destRect;
-    destRect.x = x;
-    destRect.y = y;
-    destRect.w = w;
-    destRect.h = h;
+    SDL_Rect destRect = view.Rect(x, y, w, h);
 
-    SDL_RenderCopy(renderer, image, nullptr, &destRect);
+    SDL_RenderCopy(renderer, atlas.Texture(renderer, image), nullptr, &destRect);
 }
 
 /****************************************************************************
-*
+* Draw one frame of a sprite sheet, copied 1:1 from the scaled sheet.
 ****************************************************************************/
-void DrawImageFrame(SDL_Texture* image, const int x, const int y,
-    const int width, const int height, const int frame, const int columns)
+void DrawImageFrame(TSpriteId image, const int x, const int y, const int frame)
 {
-    SDL_Rect destRect;
-    destRect.x = x;
-    destRect.y = y;
-    destRect.w = width;
-    destRect.h = height;
-
-    SDL_Rect sourceRect;
-    sourceRect.y = (frame/columns)*height;
-    sourceRect.x = (frame%columns)*width;
-    sourceRect.w = width;
-    sourceRect.h = height;
-
-    SDL_RenderCopy(renderer, image, &sourceRect, &destRect);
+    SDL_Rect sourceRect = atlas.Frame(image, frame);
+    SDL_Rect destRect = {view.X(x), view.Y(y), sourceRect.w, sourceRect.h};
+
+    SDL_RenderCopy(renderer, atlas.Texture(renderer, image), &sourceRect, &destRect);
 }
 
 /****************************************************************************
 * Summary: Paint all of  the objects on the game screen.
 ****************************************************************************/
-void PaintGame()
+void PaintGame(const TRenderFrame &frame)
 {
-    std::shared_ptr<TItemRec> ptRec;
+    const TItemRec *ptRec;
 
     ClearScreen();
 
     // Draw Wall
-    for(const auto & i : blocksList)
+    for(const auto & i : frame.blocks)
     {
-        ptRec = i;
-        if(ptRec->screen == curScrn)
-            DrawImage(BlockImage, ptRec->x, ptRec->y, blockWidth, blockHeight);
+        ptRec = &i;
+        if(ptRec->screen == frame.curScrn)
+            DrawImage(SPR_BLOCK, ptRec->x, ptRec->y, blockWidth, blockHeight);
 
     } // next i
 
     // Draw tanks
-    for(const auto & i : tanksList)
+    for(const auto & i : frame.tanks)
     {
-        ptRec = i;
-        if(ptRec->screen == curScrn)
+        ptRec = &i;
+        if(ptRec->screen == frame.curScrn)
         {
             if (ptRec->color == BlueTank)
             {
-                DrawImageFrame(blueTanks, ptRec->x, ptRec->y,
-                   tankWidth, tankHeight, ptRec->directionIdx, 8);
+                DrawImageFrame(SPR_BLUE_TANK, ptRec->x, ptRec->y, ptRec->directionIdx);
             }
             else if (ptRec->color == RedTank)
             {
-                DrawImageFrame(redTanks,  ptRec->x, ptRec->y,
-                    tankWidth, tankHeight, ptRec->directionIdx, 8);
+                DrawImageFrame(SPR_RED_TANK, ptRec->x, ptRec->y, ptRec->directionIdx);
             }
             else if (ptRec->color == DeadTank)
             {
-                DrawImageFrame(deadTanks, ptRec->x, ptRec->y,
-                    tankWidth, tankHeight, ptRec->directionIdx, 2);
+                DrawImageFrame(SPR_DEAD_TANK, ptRec->x, ptRec->y, ptRec->directionIdx);
             }
         }
     } // next i
 
     // Draw bullets
-    for(const auto & i : bulletList)
+    for(const auto & i : frame.bullets)
     {
-        ptRec = i;
-        if(ptRec->screen == curScrn)
+        ptRec = &i;
+        if(ptRec->screen == frame.curScrn)
         {
-            SDL_Rect rect;
-            rect.x = ptRec->x-1;
-            rect.y = ptRec->y-1;
-            rect.h = 3;
-            rect.w = 3;
+            SDL_Rect rect = view.Rect(ptRec->x - 1, ptRec->y - 1, 3, 3);
             SDL_SetRenderDrawColor(renderer, 0,0,0,255);
             //fill up rectangle with color
             SDL_RenderFillRect(renderer, &rect);
@@ -1608,34 +1373,113 @@ void PaintGame()
     }
 
     // Draw explosions
-    for(const auto & i : explosionList)
+    for(const auto & i : frame.explosions)
     {
-        ptRec = i;
-        if(ptRec->screen == curScrn)
+        ptRec = &i;
+        if(ptRec->screen == frame.curScrn)
         {
-            DrawImageFrame(explosions,  ptRec->x, ptRec->y,
-                    explosionWidth, explosionHeight, ptRec->directionIdx, 3);
+            DrawImageFrame(SPR_EXPLOSION, ptRec->x, ptRec->y, ptRec->directionIdx);
         }
     }
 
     // Draw Trees
-    for(const auto & i : treeList)
+    for(const auto & i : frame.trees)
     {
-        ptRec = i;
-        if(ptRec->screen == curScrn)
+        ptRec = &i;
+        if(ptRec->screen == frame.curScrn)
         {
-            DrawImage(TreeImage, ptRec->x, ptRec->y, treeWidth, treeHeight);
+            DrawImageFrame(SPR_TREE, ptRec->x, ptRec->y, 0);
         }
     }
+
+    // Smoke rises over everything
+    DrawParticles();
 } // PaintGame()
 
 
-void ShowScore()
+/****************************************************************************
+* Start effects for what happened in the frame's tick, then move all
+* particles on by dt seconds. They are dropped when the screen changes.
+****************************************************************************/
+void UpdateParticles(const TRenderFrame &frame, float dt)
+{
+    if (!particlesOn)
+        return;
+    if (frame.curScrn != particleScreen) {
+        particles.Clear();
+        particleScreen = frame.curScrn;
+    }
+    for (const TGameEvent &ev : frame.events) {
+        if (ev.screen != frame.curScrn)
+            continue;
+        if (ev.type == EV_TANK_HIT) {
+            particles.Debris((float)ev.x, (float)ev.y, 60, 0xFF9020);
+            particles.Debris((float)ev.x, (float)ev.y, 20, 0x383838);
+            particles.Smoke((float)ev.x, (float)ev.y, 15);
+        } else if (ev.type == EV_WALL_HIT) {
+            particles.Debris((float)ev.x, (float)ev.y, 15, 0x8C6E50);
+        }
+    }
+    for (const TItemRec &b : frame.bullets)
+        particles.Trail((float)b.x, (float)b.y);
+    for (const TItemRec &t : frame.tanks)
+        if (t.color == DeadTank)
+            particles.Smoke((float)(t.x + tankWidth / 2), (float)(t.y + tankHeight / 3), 2);
+    particles.Update(dt);
+}
+
+/****************************************************************************
+* All particles as one batch of triangles.
+****************************************************************************/
+void DrawParticles()
+{
+    if (particles.Count() == 0)
+        return;
+    int n = particles.BuildQuads((float)view.scale, (float)view.offsetX, (float)view.offsetY,
+                                 particleVerts, particleIndices);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometry(renderer, nullptr, reinterpret_cast<const SDL_Vertex *>(particleVerts.data()),
+                       n * 4, particleIndices.data(), n * 6);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
+
+/****************************************************************************
+* Overlay with the live and peak bytes of every memory tag, the frame
+* arena and what the shown tick cost.
+****************************************************************************/
+void DrawProfiler(const TRenderFrame &frame)
+{
+    const int LINE = 24;
+    char lines[MEM_TAG_COUNT + 4][80];
+    int n = 0;
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        TMemTagStats m = MemStats((TMemTag)t);
+        snprintf(lines[n++], sizeof(lines[0]), "%s: %.1f KB, peak %.1f KB", MemTagNames[t],
+                 m.live / 1024.0, m.peak / 1024.0);
+    }
+    const TArena &scratch = FrameArena();
+    snprintf(lines[n++], sizeof(lines[0]), "Frame arena: %.1f of %.1f KB",
+             scratch.Used() / 1024.0, scratch.Reserved() / 1024.0);
+    snprintf(lines[n++], sizeof(lines[0]), "Particles: %d", particles.Count());
+    snprintf(lines[n++], sizeof(lines[0]), "Tick %u: %.2f ms", frame.tick, frame.simMs);
+    snprintf(lines[n++], sizeof(lines[0]), "Mixer: %.0f%% of each %.0f ms buffer",
+             audio.RecentShare() * 100, audio.PeriodMs());
+
+    SDL_Rect box = view.Rect(8, 8, 330, n * LINE + 8);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 200);
+    SDL_RenderFillRect(renderer, &box);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    for (int i = 0; i < n; i++)
+        drawText->printText(renderer, lines[i], view.X(14), view.Y(12 + i * LINE));
+}
+
+void ShowScore(const TRenderFrame &frame)
 {
     char s[20];
-    sprintf(s, "Score: %4.1f", score);
-    int x= width - 150;
-    int y= height +1;
+    sprintf(s, "Score: %4.1f", frame.score);
+    int x= view.X(width - 150);
+    int y= view.Y(height + 1);
 
     drawText->printText(renderer, s, x, y);
 }
@@ -1645,8 +1489,11 @@ void ShowScore()
 *******************************************************************************/
 void ClearScreen()
 {
-    SDL_SetRenderDrawColor(renderer, 220, 220, 180, 255); // Color background
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Bars beside the game
     SDL_RenderClear(renderer);
+    SDL_Rect game = view.Rect(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    SDL_SetRenderDrawColor(renderer, 220, 220, 180, 255); // Color background
+    SDL_RenderFillRect(renderer, &game);
 }
 
 /*******************************************************************************
@@ -0,0 +1,413 @@
+//
+// Headless server running many independent matches on a thread pool.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "BatchEnv.h"
+#include "Bullets.h"
+#include "MapGen.h"
+#include "Memory.h"
+#include "Pacer.h"
+#include "Match.h"
+#include "Particles.h"
+#include "RenderPipe.h"
+#include "Telemetry.h"
+#include "ThreadPool.h"
+
+using TClock = std::chrono::steady_clock;
+
+const int REPORT_SECONDS = 5;
+
+/****************************************************************************
+ * One hosted match and the stand-in player driving its blue tank. Kept on
+ * its own cache lines so threads ticking neighbours do not share them.
+ ***************************************************************************/
+struct alignas(64) TMatchSlot {
+    std::unique_ptr<Match> match;
+    uint32_t botRand = 1;
+    // Counters for the current report period
+    long ticks = 0;
+    long overruns = 0;     // Ticks that went over the per-match budget
+    double tickUs = 0;     // Total time spent ticking
+    double worstUs = 0;
+    long gamesPlayed = 0;
+};
+
+/****************************************************************************
+ * Random but plausible input: mostly driving, some turning and shooting.
+ ***************************************************************************/
+static uint8_t BotAction(TMatchSlot &slot)
+{
+    slot.botRand = slot.botRand * 1103515245 + 12345;
+    int r = (slot.botRand >> 16) & 0x7FFF;
+    uint8_t action = 0;
+    if (r % 4 != 0)
+        action |= ACT_FORWARD;
+    if (r % 16 == 1)
+        action |= ACT_LEFT;
+    else if (r % 16 == 2)
+        action |= ACT_RIGHT;
+    if ((r >> 4) % 6 == 0)
+        action |= ACT_FIRE;
+    return action;
+}
+
+/****************************************************************************
+ * Advance one match by a tick and account for the time it took. A finished
+ * match starts over right away with a new seed.
+ ***************************************************************************/
+static void TickMatch(TMatchSlot &slot, double budgetUs)
+{
+    TClock::time_point start = TClock::now();
+    Match &m = *slot.match;
+    m.ApplyAction(GoodGuyIdx, BotAction(slot));
+    m.UpdateGame();
+    if (m.CheckGameOver() != 0) {
+        m.rngState = slot.botRand;
+        m.InitLists();
+        slot.gamesPlayed++;
+    }
+    double us = std::chrono::duration<double, std::micro>(TClock::now() - start).count();
+    slot.ticks++;
+    slot.tickUs += us;
+    slot.worstUs = std::max(slot.worstUs, us);
+    if (us > budgetUs)
+        slot.overruns++;
+    TelemetryEmit(TEL_TICK, m.telemetrySource, m.tick, -1, -1, m.blueCount + m.redCount,
+                  (int)m.bullets.Size(), (int)us);
+}
+
+/****************************************************************************
+ * Print the period's numbers and clear them. Matches per core is how many
+ * matches one core could keep at FPS, given the average tick cost.
+ ***************************************************************************/
+static void Report(std::vector<TMatchSlot> &slots, int threads, double seconds, long frameOverruns)
+{
+    long ticks = 0, overruns = 0, games = 0;
+    double tickUs = 0, worstUs = 0;
+    for (TMatchSlot &slot : slots) {
+        ticks += slot.ticks;
+        overruns += slot.overruns;
+        tickUs += slot.tickUs;
+        worstUs = std::max(worstUs, slot.worstUs);
+        games += slot.gamesPlayed;
+        slot.ticks = slot.overruns = 0;
+        slot.tickUs = slot.worstUs = 0;
+    }
+    double avgUs = ticks > 0 ? tickUs / ticks : 0;
+    double perCore = avgUs > 0 ? 1e6 / FPS / avgUs : 0;
+    printf("matches %zu, threads %d, ticks/s %.0f, tick avg %.1f us worst %.1f us, "
+           "over budget %ld, late frames %ld, games %ld, matches per core %.0f\n",
+           slots.size(), threads, ticks / seconds, avgUs, worstUs, overruns, frameOverruns,
+           games, perCore);
+    fflush(stdout);
+}
+
+/****************************************************************************
+ * Step a TBatchEnv with random actions and report steps per second, the
+ * way a training loop would drive it.
+ ***************************************************************************/
+static int RunBatchBench(int count, int threads, int seconds)
+{
+    TBatchEnv env(count, 1, threads);
+    std::vector<uint8_t> obs(OBS_SIZE * env.Count());
+    std::vector<uint8_t> actions(env.Count());
+    std::vector<float> rewards(env.Count());
+    std::vector<uint8_t> dones(env.Count());
+    TMatchSlot bot;
+    env.Reset(obs.data());
+
+    printf("Stepping %d worlds on %d threads, %zu observation bytes per world\n",
+           env.Count(), env.Threads(), OBS_SIZE);
+    TClock::time_point start = TClock::now();
+    long steps = 0, episodes = 0;
+    double reward = 0, elapsed = 0;
+    while (elapsed < seconds) {
+        for (uint8_t &a : actions)
+            a = BotAction(bot);
+        env.Step(actions.data(), obs.data(), rewards.data(), dones.data());
+        steps += env.Count();
+        for (int i = 0; i < env.Count(); i++) {
+            reward += rewards[i];
+            episodes += dones[i];
+        }
+        elapsed = std::chrono::duration<double>(TClock::now() - start).count();
+    }
+    printf("steps/s %.0f, per core %.0f, episodes %ld, mean episode reward %.2f\n",
+           steps / elapsed, steps / elapsed / env.Threads(), episodes,
+           episodes > 0 ? reward / episodes : 0.0);
+    return 0;
+}
+
+/****************************************************************************
+ * Time generating one map, with the pool and on a single thread, and check
+ * both give the same world.
+ ***************************************************************************/
+static int RunMapBench(int cols, int rows, uint32_t seed, int threads)
+{
+    TThreadPool pool(threads);
+    Match parallel, serial;
+    TClock::time_point t0 = TClock::now();
+    GenerateMap(parallel, cols, rows, seed, &pool);
+    TClock::time_point t1 = TClock::now();
+    GenerateMap(serial, cols, rows, seed);
+    TClock::time_point t2 = TClock::now();
+    bool same = parallel.blocksList.size() == serial.blocksList.size() &&
+                memcmp(parallel.blocksList.data(), serial.blocksList.data(),
+                       serial.blocksList.size() * sizeof(TItemRec)) == 0 &&
+                parallel.tanksList.size() == serial.tanksList.size();
+    printf("%d screens: %.1f ms on %d threads, %.1f ms on one; %zu blocks, %zu tanks, %zu trees%s\n",
+           cols * rows, std::chrono::duration<double, std::milli>(t1 - t0).count(), pool.Threads(),
+           std::chrono::duration<double, std::milli>(t2 - t1).count(), serial.blocksList.size(),
+           serial.tanksList.size(), serial.treeList.size(), same ? "" : " - RESULTS DIFFER");
+    return same ? 0 : 1;
+}
+
+/****************************************************************************
+ * Time moving a large number of bullets. Bullets that leave the screen are
+ * replaced after each tick, outside the timed part, so the count stays put.
+ ***************************************************************************/
+static int RunBulletBench(int count, int seconds)
+{
+    TBullets bullets;
+    uint32_t rnd = 12345;
+    auto next = [&rnd](int n) {
+        rnd = rnd * 1103515245u + 12345u;
+        return (int)((rnd >> 8) % (uint32_t)n);
+    };
+    auto refill = [&]() {
+        while ((int)bullets.Size() < count)
+            bullets.Add(2 + next(PLAY_WIDTH - 4), 2 + next(PLAY_HEIGHT - 4), 0, next(DIR_COUNT), 0);
+    };
+
+    refill();
+    double stepMs = 0;
+    long ticks = 0, removed = 0;
+    TClock::time_point start = TClock::now();
+    while (std::chrono::duration<double>(TClock::now() - start).count() < seconds) {
+        TClock::time_point t0 = TClock::now();
+        removed += count - (long)bullets.Step(PLAY_WIDTH, PLAY_HEIGHT);
+        stepMs += std::chrono::duration<double, std::milli>(TClock::now() - t0).count();
+        ticks++;
+        refill();
+    }
+    printf("%d bullets, %ld ticks: move and drop %.3f ms per tick, "
+           "%.0f bullets per ms, %.1f%% removed per tick\n",
+           count, ticks, stepMs / ticks, count * ticks / stepMs,
+           100.0 * removed / ((double)count * ticks));
+    return 0;
+}
+
+/****************************************************************************
+ * Time capturing render frames of every screen, as the overview and the
+ * minimap need them, on a match played by a bot on the --map.
+ ***************************************************************************/
+static int RunCaptureBench(int cols, int rows, uint32_t seed, int seconds)
+{
+    Match match;
+    GenerateMap(match, cols, rows, seed);
+    TMatchSlot bot;
+    TRenderFrame frame;
+    double oneMs = 0, allMs = 0;
+    long ticks = 0, items = 0;
+    TClock::time_point start = TClock::now();
+    while (std::chrono::duration<double>(TClock::now() - start).count() < seconds) {
+        match.ApplyAction(GoodGuyIdx, BotAction(bot));
+        match.UpdateGame();
+        if (match.CheckGameOver() != 0)
+            GenerateMap(match, cols, rows, ++seed);
+        TClock::time_point t0 = TClock::now();
+        CaptureFrame(match, frame);
+        TClock::time_point t1 = TClock::now();
+        CaptureFrame(match, frame, true);
+        TClock::time_point t2 = TClock::now();
+        oneMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        allMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        items += (long)(frame.allTanks.items.size() + frame.allBullets.items.size() +
+                        frame.allExplosions.items.size());
+        ticks++;
+    }
+    printf("%d screens, %ld ticks, %.0f moving items and %zu walls on average: "
+           "capture %.3f ms for one screen, %.3f ms for all\n",
+           cols * rows, ticks, (double)items / ticks, match.blocksList.size(), oneMs / ticks,
+           allMs / ticks);
+    return 0;
+}
+
+/****************************************************************************
+ * Time updating N particles and building their vertices each tick. Expired
+ * particles are replaced outside the timed part, so the count stays put.
+ ***************************************************************************/
+static int RunParticleBench(int count, int seconds)
+{
+    TParticles particles(std::max(count, PARTICLE_CAPACITY));
+    TParticleVerts verts;
+    TParticleIndices indices;
+    double updateMs = 0, buildMs = 0;
+    long ticks = 0;
+    TClock::time_point start = TClock::now();
+    while (std::chrono::duration<double>(TClock::now() - start).count() < seconds) {
+        for (int i = 0; particles.Count() < count; i++)
+            particles.Debris((float)(i * 37 % PLAY_WIDTH), (float)(i * 11 % PLAY_HEIGHT),
+                             std::min(64, count - particles.Count()), 0xFF8020);
+        TClock::time_point t0 = TClock::now();
+        particles.Update(1.0f / FPS);
+        TClock::time_point t1 = TClock::now();
+        particles.BuildQuads(1, 0, 0, verts, indices);
+        TClock::time_point t2 = TClock::now();
+        updateMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        buildMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        ticks++;
+    }
+    printf("%d particles, %ld ticks: update %.3f ms, vertices %.3f ms per tick\n", count, ticks,
+           updateMs / ticks, buildMs / ticks);
+    return 0;
+}
+
+static void Usage(const char *prog)
+{
+    printf("Usage: %s [--matches N] [--threads N] [--seconds N] [--map CxR[:seed]]\n"
+           "          [--bench | --batch | --mapgen | --bullets N | --capture]\n"
+           "          [--particles N]\n"
+           "  --matches N  matches to host (default 64)\n"
+           "  --threads N  worker threads, 0 for one per core (default 0)\n"
+           "  --seconds N  stop after N seconds (default run forever, 10 with --bench)\n"
+           "  --bench      tick as fast as possible instead of at %d ticks/s\n"
+           "  --batch      measure the training API (TBatchEnv) instead\n"
+           "  --map CxR[:seed]  play on generated maps of C x R screens\n"
+           "  --mapgen     time generating the --map (default 40x25) instead\n"
+           "  --bullets N  time moving N bullets per tick instead\n"
+           "  --capture    time capturing every screen of the --map for drawing instead\n"
+           "  --particles N  time updating N particles and their vertices instead\n"
+           "  --telemetry target  stream match events to a file or unix:socket\n",
+           prog, FPS);
+}
+
+int main(int argc, char *argv[])
+{
+    int matchCount = 64;
+    int threads = 0;
+    int seconds = 0;
+    bool bench = false;
+    bool batch = false;
+    bool mapBench = false;
+    bool captureBench = false;
+    int particleCount = 0;
+    int bulletCount = 0;
+    int mapCols = 0, mapRows = 0;
+    uint32_t mapSeed = 0;
+    const char *telemetryTarget = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--matches") == 0 && i + 1 < argc) {
+            matchCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "--mapgen") == 0) {
+            mapBench = true;
+        } else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+            particleCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            captureBench = true;
+        } else if (strcmp(argv[i], "--bullets") == 0 && i + 1 < argc) {
+            bulletCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            telemetryTarget = argv[++i];
+        } else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc &&
+                   ParseMapSize(argv[i + 1], mapCols, mapRows, mapSeed)) {
+            i++;
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (matchCount < 1)
+        matchCount = 1;
+    if ((bench || batch || bulletCount > 0 || captureBench || particleCount > 0) && seconds <= 0)
+        seconds = 10;
+    if (bulletCount > 0)
+        return RunBulletBench(bulletCount, seconds);
+    if (batch)
+        return RunBatchBench(matchCount, threads, seconds);
+    if (particleCount > 0)
+        return RunParticleBench(particleCount, seconds);
+    if (captureBench)
+        return mapSeed != 0 ? RunCaptureBench(mapCols, mapRows, mapSeed, seconds)
+                            : RunCaptureBench(40, 25, 1, seconds);
+    if (mapBench)
+        return mapSeed != 0 ? RunMapBench(mapCols, mapRows, mapSeed, threads)
+                            : RunMapBench(40, 25, 1, threads);
+
+    TThreadPool pool(threads);
+    std::vector<TMatchSlot> slots(matchCount);
+    for (int i = 0; i < matchCount; i++) {
+        slots[i].botRand = 7919u * (i + 1);
+        slots[i].match = std::make_unique<Match>(1000u + i);
+        if (mapSeed != 0)
+            GenerateMap(*slots[i].match, mapCols, mapRows, mapSeed);
+        slots[i].match->playerIdx = -1; // Nobody watching, curScrn stays put
+        slots[i].match->telemetrySource = (uint16_t)i;
+    }
+
+    // Each match gets its share of a frame on its thread
+    const double frameUs = 1e6 / FPS;
+    const double budgetUs = frameUs * pool.Threads() / matchCount;
+    printf("Hosting %d matches on %d threads, %s, budget %.1f us per match tick\n",
+           matchCount, pool.Threads(), bench ? "benchmark" : "real time", budgetUs);
+
+    if (telemetryTarget != nullptr && !TelemetryStart(telemetryTarget)) {
+        fprintf(stderr, "Unable to open telemetry sink %s\n", telemetryTarget);
+        return 1;
+    }
+
+    TClock::time_point startTime = TClock::now();
+    TClock::time_point reportTime = startTime;
+    TFramePacer pacer(FPS);
+    long lateReported = 0;
+    for (;;) {
+        pool.ParallelFor(matchCount, [&](int i) { TickMatch(slots[i], budgetUs); });
+
+        if (!bench)
+            pacer.Wait();
+        TClock::time_point now = TClock::now();
+        double sinceReport = std::chrono::duration<double>(now - reportTime).count();
+        bool finished = seconds > 0 &&
+                        std::chrono::duration<double>(now - startTime).count() >= seconds;
+        if (sinceReport >= REPORT_SECONDS || finished) {
+            Report(slots, pool.Threads(), sinceReport, pacer.LateFrames() - lateReported);
+            lateReported = pacer.LateFrames();
+            reportTime = now;
+        }
+        if (finished)
+            break;
+    }
+    if (!bench) {
+        char pacing[4096];
+        pacer.Format(pacing, sizeof(pacing));
+        printf("Pacing: %s\n", pacing);
+    }
+    if (telemetryOn) {
+        char stats[256];
+        TelemetryStop();
+        TelemetryFormat(stats, sizeof(stats));
+        printf("Telemetry: %s\n", stats);
+    }
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        TMemTagStats m = MemStats((TMemTag)t);
+        if (m.peak > 0)
+            printf("Memory %s: %.1f KB live, %.1f KB peak, %lld allocations\n", MemTagNames[t],
+                   m.live / 1024.0, m.peak / 1024.0, (long long)m.allocs);
+    }
+    return 0;
+} // main
@@ -0,0 +1,59 @@
+//
+// Converts telemetry streams to CSV for spreadsheets and scripts.
+//
+
+#include <cstdio>
+#include <cstring>
+#include "Telemetry.h"
+
+/****************************************************************************
+ * Copy one stream to stdout as CSV rows. A stream that does not start with
+ * a telemetry header of this version is refused; one that ends in the
+ * middle of a record, as a file being written may, loses that record only.
+ ***************************************************************************/
+static bool Convert(FILE *in, const char *name)
+{
+    TTelemetryHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, "TKTL", 4) != 0 ||
+        header.version != TELEMETRY_VERSION || header.recordSize != sizeof(TTelemetryRecord)) {
+        fprintf(stderr, "%s: not a telemetry stream\n", name);
+        return false;
+    }
+    TTelemetryRecord batch[1024];
+    size_t n;
+    while ((n = fread(batch, sizeof(TTelemetryRecord), 1024, in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const TTelemetryRecord &r = batch[i];
+            const char *type = r.type < TEL_TYPE_COUNT ? TelemetryTypeNames[r.type] : "unknown";
+            printf("%lld,%u,%u,%s,%d,%d,%d,%d,%d,%d\n", (long long)header.startMs, r.tick,
+                   r.source, type, r.tank, r.screen, r.x, r.y, r.a, r.b);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s file... (- for stdin) > events.csv\n"
+                        "Older rotated files first, e.g. %s log.2 log.1 log\n", argv[0], argv[0]);
+        return 1;
+    }
+    printf("start_ms,tick,source,event,tank,screen,x,y,a,b\n");
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-") == 0) {
+            failed += !Convert(stdin, "stdin");
+            continue;
+        }
+        FILE *in = fopen(argv[i], "rb");
+        if (in == nullptr) {
+            perror(argv[i]);
+            failed++;
+            continue;
+        }
+        failed += !Convert(in, argv[i]);
+        fclose(in);
+    }
+    return failed > 0 ? 1 : 0;
+}
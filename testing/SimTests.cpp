@@ -0,0 +1,615 @@
+//
+// Regression tests for the simulation: golden per-tick hashes of scripted
+// matches, and edge cases of the collision, movement and squad rules.
+//
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Match.h"
+#include "MapGen.h"
+#include "Rewind.h"
+#include "Snapshot.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                       \
+    do {                                                                     \
+        const long long va = (a), vb = (b);                                  \
+        if (va != vb) {                                                      \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #a, va, vb); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+/****************************************************************************
+ * A match on the four classic screens emptied of everything, for the unit
+ * tests to place only what they need.
+ ***************************************************************************/
+static void Clear(Match &m)
+{
+    m.tanksList.clear();
+    m.bulletList.clear();
+    m.bullets.Clear();
+    m.explosionList.clear();
+    m.blocksList.clear();
+    m.treeList.clear();
+    m.curScrn = 0;
+    m.RebuildWalls();
+    m.BuildTankGrid();
+}
+
+static int AddTank(Match &m, int color, int x, int y, int screen, int dir)
+{
+    TItemRec &t = m.tanksList.emplace_back();
+    t = {x, y, screen, dir, color, 0};
+    m.BuildTankGrid();
+    return (int)m.tanksList.size() - 1;
+}
+
+static void AddBlock(Match &m, int x, int y, int screen)
+{
+    TItemRec &b = m.blocksList.emplace_back();
+    b = {x, y, screen, 0, 0, 0};
+    m.RebuildWalls();
+}
+
+// Strictly inside: points on the edge of the rectangle do not collide
+static void TestCollision()
+{
+    CHECK(Match::Collision(5, 5, 0, 0, 10, 10));
+    CHECK(Match::Collision(1, 9, 0, 0, 10, 10));
+    CHECK(!Match::Collision(0, 5, 0, 0, 10, 10));
+    CHECK(!Match::Collision(10, 5, 0, 0, 10, 10));
+    CHECK(!Match::Collision(5, 0, 0, 0, 10, 10));
+    CHECK(!Match::Collision(5, 10, 0, 0, 10, 10));
+    CHECK(!Match::Collision(-1, -1, 0, 0, 10, 10));
+    CHECK(!Match::Collision(5, 5, 5, 5, 5, 5));
+    CHECK(!Match::Collision(5, 5, 10, 10, 0, 0)); // Corners swapped
+}
+
+// A block covers blockWidth x blockHeight pixels from its corner, on its screen only
+static void TestWallCollision()
+{
+    Match m(1);
+    Clear(m);
+    AddBlock(m, 100, 100, 0);
+    CHECK(m.WallCollision(100, 100, 0));
+    CHECK(m.WallCollision(100 + blockWidth - 1, 100 + blockHeight - 1, 0));
+    CHECK(!m.WallCollision(99, 105, 0));
+    CHECK(!m.WallCollision(100 + blockWidth, 105, 0));
+    CHECK(!m.WallCollision(105, 99, 0));
+    CHECK(!m.WallCollision(105, 100 + blockHeight, 0));
+    CHECK(!m.WallCollision(105, 105, 1));
+    CHECK(!m.WallCollision(105, 105, 3));
+
+    // Outside the play area and unknown screens are open
+    CHECK(!m.WallCollision(-1, 105, 0));
+    CHECK(!m.WallCollision(m.width, 105, 0));
+    CHECK(!m.WallCollision(105, m.height, 0));
+    CHECK(!m.WallCollision(105, 105, -1));
+    CHECK(!m.WallCollision(105, 105, m.ScreenCount()));
+
+    // The hand-made screens are walled all round except at the doors
+    Match classic(1);
+    CHECK(classic.WallCollision(2, 2, 0));
+}
+
+static void TestNewScreenCheck()
+{
+    Match m(1);
+    Clear(m);
+    const int t = AddTank(m, BlueTank, m.MaxX - 4, 200, 0, 2);
+    m.playerIdx = t;
+    TItemRec &tnk = m.tanksList[t];
+
+    m.NewScreenCheck(t); // Right edge of screen 0
+    CHECK_EQ(tnk.screen, 1);
+    CHECK_EQ(tnk.x, 5);
+    CHECK_EQ(m.curScrn, 1);
+
+    tnk.x = m.MaxX - 4; // Right edge of the map
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 1);
+    CHECK_EQ(tnk.x, m.MaxX - 4);
+
+    tnk.x = 3; // Back left
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 0);
+    CHECK_EQ(tnk.x, m.MaxX - (tankWidth + 1));
+
+    tnk.x = m.MaxX - 5; // Just short of the door
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 0);
+
+    tnk.x = 200;
+    tnk.y = m.MaxY - 4; // Down
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 2);
+    CHECK_EQ(tnk.y, 5);
+    CHECK_EQ(m.curScrn, 2);
+
+    tnk.y = 3; // And up again
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 0);
+    CHECK_EQ(tnk.y, m.MaxY - (tankHeight + 1));
+
+    tnk.y = 3; // Top of the map
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 0);
+    CHECK_EQ(tnk.y, 3);
+
+    // In a corner the horizontal door wins
+    tnk.x = m.MaxX - 4;
+    tnk.y = m.MaxY - 4;
+    m.NewScreenCheck(t);
+    CHECK_EQ(tnk.screen, 1);
+    CHECK_EQ(tnk.y, m.MaxY - 4);
+
+    // Only the player's tank takes the view along
+    const int other = AddTank(m, RedTank, m.MaxX - 4, 200, 0, 2);
+    m.curScrn = 0;
+    m.NewScreenCheck(other);
+    CHECK_EQ(m.tanksList[other].screen, 1);
+    CHECK_EQ(m.curScrn, 0);
+
+    // Larger maps step by a column or a row of screens
+    Match big(1);
+    GenerateMap(big, 3, 3, 5);
+    Clear(big);
+    const int b = AddTank(big, BlueTank, big.MaxX - 4, 200, 4, 2);
+    big.NewScreenCheck(b);
+    CHECK_EQ(big.tanksList[b].screen, 5);
+    big.tanksList[b].x = 200;
+    big.tanksList[b].y = big.MaxY - 4;
+    big.NewScreenCheck(b);
+    CHECK_EQ(big.tanksList[b].screen, 8);
+    big.tanksList[b].y = big.MaxY - 4; // Bottom row
+    big.NewScreenCheck(b);
+    CHECK_EQ(big.tanksList[b].screen, 8);
+}
+
+static void TestAimingAtTarget()
+{
+    Match m(1);
+    Clear(m);
+    const int red = AddTank(m, RedTank, 100, 200, 0, 2); // Facing right
+    const int blue = AddTank(m, BlueTank, 400, 200, 0, 0);
+    CHECK(m.AimingAtTarget(red));
+
+    m.tanksList[red].directionIdx = 6; // Facing away
+    CHECK(!m.AimingAtTarget(red));
+    m.tanksList[red].directionIdx = 2;
+
+    m.tanksList[blue].y = 400; // Well below the line of fire
+    m.BuildTankGrid();
+    CHECK(!m.AimingAtTarget(red));
+    m.tanksList[red].directionIdx = 3; // Down and right
+    CHECK(m.AimingAtTarget(red));
+
+    m.tanksList[red].directionIdx = 4; // Straight down, target right below
+    m.tanksList[blue].x = 100;
+    m.BuildTankGrid();
+    CHECK(m.AimingAtTarget(red));
+    m.tanksList[red].directionIdx = 0;
+    CHECK(!m.AimingAtTarget(red));
+
+    m.tanksList[blue].y = 20; // Straight up
+    m.BuildTankGrid();
+    CHECK(m.AimingAtTarget(red));
+
+    // Too close along the aim, on another screen, or dead: no shot
+    m.tanksList[blue].y = 199;
+    m.BuildTankGrid();
+    CHECK(!m.AimingAtTarget(red));
+    m.tanksList[blue].y = 20;
+    m.tanksList[blue].screen = 1;
+    m.BuildTankGrid();
+    CHECK(!m.AimingAtTarget(red));
+    m.tanksList[blue].screen = 0;
+    m.tanksList[blue].color = DeadTank;
+    m.BuildTankGrid();
+    CHECK(!m.AimingAtTarget(red));
+
+    // Walls do not spoil the aim
+    m.tanksList[blue].color = BlueTank;
+    AddBlock(m, 110, 100, 0);
+    m.BuildTankGrid();
+    CHECK(m.AimingAtTarget(red));
+
+    // Other red tanks are not targets
+    m.tanksList[blue].color = RedTank;
+    m.BuildTankGrid();
+    CHECK(!m.AimingAtTarget(red));
+}
+
+static void TestMoveTank()
+{
+    Match m(1);
+    Clear(m);
+    const int t = AddTank(m, BlueTank, 200, 200, 0, 2);
+    TItemRec &tnk = m.tanksList[t];
+
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, 203);
+    CHECK_EQ(tnk.y, 200);
+
+    // A wall two pixels ahead lets the tank close up to it, then stops it
+    AddBlock(m, tnk.x + tankWidth + 2, 200, 0);
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, 205);
+    CHECK(!m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, 205);
+
+    // Diagonally into the wall it slides along it
+    tnk.directionIdx = 3; // Down and right
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, 205);
+    CHECK_EQ(tnk.y, 203);
+
+    // Clamped at the left edge of the map
+    tnk = {1, 300, 0, 6, BlueTank, 0};
+    m.BuildTankGrid();
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, 0);
+    CHECK(!m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, 0);
+    CHECK_EQ(tnk.screen, 0);
+
+    // And at the right edge of the last screen
+    tnk = {m.MaxX - 2, 300, 1, 2, BlueTank, 0};
+    m.BuildTankGrid();
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(tnk.x, m.MaxX - 1);
+    CHECK_EQ(tnk.screen, 1);
+
+    // Through the door from screen 0 to 1
+    tnk = {m.MaxX - 6, 300, 0, 2, BlueTank, 0};
+    m.BuildTankGrid();
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(tnk.screen, 1);
+    CHECK_EQ(tnk.x, 5);
+
+    // Another tank in the way stops it; one on another screen does not
+    tnk = {300, 400, 0, 2, BlueTank, 0};
+    const int other = AddTank(m, RedTank, 300 + tankWidth + 1, 400, 0, 6);
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(m.tanksList[t].x, 301);
+    CHECK(!m.MoveTank(t, 3));
+    m.tanksList[other].screen = 2;
+    m.BuildTankGrid();
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(m.tanksList[t].x, 304);
+
+    // Tanks that already overlap can drive apart
+    m.tanksList[other] = {m.tanksList[t].x + 10, 400, 0, 6, RedTank, 0};
+    m.tanksList[t].directionIdx = 6;
+    m.BuildTankGrid();
+    CHECK(m.MoveTank(t, 3));
+    CHECK_EQ(m.tanksList[t].x, 301);
+}
+
+static void TestSquad()
+{
+    TSquadMemory mem;
+    mem.started = mem.known = mem.engaging = true;
+    mem.seenX = PLAY_WIDTH - 1;
+    mem.seenY = PLAY_HEIGHT - 1;
+    mem.age = MEMORY_THINKS;
+    mem.desiredDir = DIR_COUNT - 1;
+    mem.countdown = THINK_TICKS - 1;
+    const uint32_t packed = mem.Pack();
+    const TSquadMemory back = TSquadMemory::Unpack(packed);
+    CHECK(back.started && back.known && back.engaging);
+    CHECK_EQ(back.seenX, PLAY_WIDTH - 1);
+    CHECK_EQ(back.seenY, PLAY_HEIGHT - 1);
+    CHECK_EQ(back.age, MEMORY_THINKS);
+    CHECK_EQ(back.desiredDir, DIR_COUNT - 1);
+    CHECK_EQ(back.countdown, THINK_TICKS - 1);
+    CHECK(!TSquadMemory::Unpack(0).started); // New tanks think on their first tick
+
+    CHECK_EQ(HeadingTo(0, -10), 0);
+    CHECK_EQ(HeadingTo(10, -10), 1);
+    CHECK_EQ(HeadingTo(10, -3), 2);
+    CHECK_EQ(HeadingTo(10, 10), 3);
+    CHECK_EQ(HeadingTo(0, 10), 4);
+    CHECK_EQ(HeadingTo(-10, 10), 5);
+    CHECK_EQ(HeadingTo(-10, 0), 6);
+    CHECK_EQ(HeadingTo(-10, -10), 7);
+    CHECK_EQ(TurnToward(0, 2), 1);
+    CHECK_EQ(TurnToward(0, 6), 7);
+    CHECK_EQ(TurnToward(7, 1), 0);
+    CHECK_EQ(TurnToward(3, 3), 3);
+
+    // After the first tick a quarter of the squad thinks on each tick
+    Match m(1);
+    Clear(m);
+    AddTank(m, BlueTank, 100, 100, 3, 0);
+    for (int i = 0; i < 8; i++)
+        AddTank(m, RedTank, 60 + i * 80, 60 + (i % 2) * 300, 0, 4);
+    m.UpdateGame();
+    for (int tick = 0; tick < 8; tick++) {
+        m.UpdateGame();
+        int thought = 0;
+        for (const TItemRec &t : m.tanksList)
+            if (t.color == RedTank)
+                thought += TSquadMemory::Unpack(t.ai).countdown == THINK_TICKS - 1;
+        CHECK_EQ(thought, 8 / THINK_TICKS);
+    }
+
+    // A tank behind a wall learns where the player is from one that sees it
+    Clear(m);
+    const int player = AddTank(m, BlueTank, 600, 300, 0, 0);
+    const int hidden = AddTank(m, RedTank, 600, 100, 0, 4);
+    AddTank(m, RedTank, 100, 300, 0, 2);
+    for (int x = 560; x < 700; x += blockWidth)
+        AddBlock(m, x, 200, 0);
+    m.playerIdx = player;
+    m.UpdateGame();
+    const TSquadMemory learned = TSquadMemory::Unpack(m.tanksList[hidden].ai);
+    CHECK(learned.known);
+    CHECK_EQ(learned.seenX, 600 + tankWidth / 2);
+    CHECK_EQ(learned.seenY, 300 + tankHeight / 2);
+}
+
+/****************************************************************************
+ * Golden runs. A golden file holds a scripted match and the world hash
+ * after each of its ticks:
+ *
+ *   seed 100           Match seed
+ *   map 3x3:5          Optional generated map, as for --map
+ *   ticks 600          How long to run
+ *   script U*20 R US*5 Input, one token per tick
+ *   restore 250        Optional: after tick 250 save the match and go on
+ *                      in a fresh match loaded from the save
+ *   rewind 250 30      Optional: after tick 250 rewind 30 ticks through the
+ *                      rewind buffer and play them again
+ *   12 1f3a...         Tick and hash, written by --update
+ *
+ * A token lists the keys pressed that tick, handed to ApplyAction() one at
+ * a time in order the way queued key presses are, with *n to repeat it:
+ * U forward, L and R turn, S fire, '.' nothing. Ticks after the script
+ * has no input. Lines starting with # are comments. A run that restores
+ * or rewinds must end with the hashes of the same run played straight
+ * through.
+ ***************************************************************************/
+struct TGolden {
+    std::vector<std::string> header; // Lines kept by --update
+    uint32_t seed = 1;
+    int cols = 0, rows = 0;
+    uint32_t mapSeed = 0;
+    int ticks = 0;
+    int restoreAt = 0;
+    int rewindAt = 0, rewindTicks = 0;
+    std::vector<std::string> script;
+    std::vector<std::pair<int, std::string>> hashes;
+};
+
+static bool LoadGolden(const char *fileName, TGolden &g)
+{
+    std::ifstream in(fileName);
+    if (!in) {
+        fprintf(stderr, "%s: cannot open\n", fileName);
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key) || key[0] == '#') {
+            g.header.push_back(line);
+            continue;
+        }
+        if (key[0] >= '0' && key[0] <= '9') {
+            std::string hash;
+            words >> hash;
+            g.hashes.push_back({atoi(key.c_str()), hash});
+            continue;
+        }
+        g.header.push_back(line);
+        if (key == "seed") {
+            words >> g.seed;
+        } else if (key == "map") {
+            std::string size;
+            words >> size;
+            if (!ParseMapSize(size.c_str(), g.cols, g.rows, g.mapSeed)) {
+                fprintf(stderr, "%s: bad map %s\n", fileName, size.c_str());
+                return false;
+            }
+        } else if (key == "ticks") {
+            words >> g.ticks;
+        } else if (key == "restore") {
+            words >> g.restoreAt;
+        } else if (key == "rewind") {
+            words >> g.rewindAt >> g.rewindTicks;
+        } else if (key == "script") {
+            for (std::string token; words >> token;) {
+                const size_t star = token.find('*');
+                const int count = star == std::string::npos ? 1 : atoi(token.c_str() + star + 1);
+                for (int i = 0; i < count; i++)
+                    g.script.push_back(token.substr(0, star));
+            }
+        } else {
+            fprintf(stderr, "%s: unknown line %s\n", fileName, line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t KeyAction(char key)
+{
+    switch (key) {
+        case 'U': return ACT_FORWARD;
+        case 'L': return ACT_LEFT;
+        case 'R': return ACT_RIGHT;
+        case 'S': return ACT_FIRE;
+        default: return 0;
+    }
+}
+
+static std::vector<std::string> RunGolden(const TGolden &g)
+{
+    Match first(g.seed);
+    if (g.mapSeed != 0)
+        GenerateMap(first, g.cols, g.rows, g.mapSeed);
+    Match resumed(g.seed + 1); // Everything it plays with comes from the save
+    Match *m = &first;
+    TRewindBuffer history;
+    bool rewound = false;
+    std::vector<std::string> hashes;
+    for (int tick = 0; tick < g.ticks; tick++) {
+        if (tick < (int)g.script.size())
+            for (char key : g.script[tick])
+                m->ApplyAction(m->playerIdx, KeyAction(key));
+        m->UpdateGame();
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)WorldHash(m->Synced()));
+        hashes.push_back(hex);
+        history.Record(m->Synced());
+
+        if (tick + 1 == g.restoreAt) {
+            std::vector<uint8_t> save;
+            SaveSnapshot(m->Synced(), save);
+            if (!RestoreSnapshot(resumed, save.data(), save.size()))
+                fprintf(stderr, "tick %d: cannot restore the save\n", tick + 1);
+            resumed.RebuildWalls();
+            resumed.LoadBullets();
+            m = &resumed;
+        }
+        if (tick + 1 == g.rewindAt && !rewound) {
+            // Walls are not recorded, they stay as they are
+            if (!history.Rewind(*m, g.rewindTicks))
+                fprintf(stderr, "tick %d: cannot rewind\n", tick + 1);
+            m->LoadBullets();
+            rewound = true;
+            tick -= g.rewindTicks;
+            hashes.resize(tick + 1);
+        }
+    }
+    return hashes;
+}
+
+static int CheckGolden(const char *fileName)
+{
+    TGolden g;
+    if (!LoadGolden(fileName, g))
+        return 1;
+    const std::vector<std::string> hashes = RunGolden(g);
+    if ((int)g.hashes.size() != g.ticks) {
+        fprintf(stderr, "%s: %zu hashes for %d ticks, run with --update\n", fileName,
+                g.hashes.size(), g.ticks);
+        return 1;
+    }
+    for (int i = 0; i < g.ticks; i++) {
+        if (g.hashes[i].first != i + 1 || g.hashes[i].second != hashes[i]) {
+            fprintf(stderr, "%s: tick %d is %s, expected %s\n", fileName, i + 1,
+                    hashes[i].c_str(), g.hashes[i].second.c_str());
+            return 1;
+        }
+    }
+    printf("%s: %d ticks match\n", fileName, g.ticks);
+    return 0;
+}
+
+// Rewrite the hashes of a golden file from the current code
+static int UpdateGolden(const char *fileName)
+{
+    TGolden g;
+    if (!LoadGolden(fileName, g))
+        return 1;
+    const std::vector<std::string> hashes = RunGolden(g);
+    std::ofstream out(fileName);
+    for (const std::string &line : g.header)
+        out << line << '\n';
+    for (int i = 0; i < g.ticks; i++)
+        out << i + 1 << ' ' << hashes[i] << '\n';
+    printf("%s: %d ticks written\n", fileName, g.ticks);
+    return out ? 0 : 1;
+}
+
+// Records that would index past a table are refused, leaving the world as it was
+static void TestSnapshotRanges()
+{
+    Match m(3);
+    std::vector<uint8_t> good;
+    SaveSnapshot(m.Synced(), good);
+    const uint64_t before = WorldHash(m.Synced());
+    const size_t firstTank = sizeof(TSnapshotHeader) + m.bulletList.size() * sizeof(TItemRec);
+    auto refused = [&](size_t offset, int32_t value) {
+        std::vector<uint8_t> bad = good;
+        memcpy(&bad[offset], &value, sizeof(value));
+        CHECK(!RestoreSnapshot(m, bad.data(), bad.size()));
+        CHECK(WorldHash(m.Synced()) == before);
+    };
+    refused(firstTank + offsetof(TItemRec, screen), m.ScreenCount());
+    refused(firstTank + offsetof(TItemRec, screen), -1);
+    refused(firstTank + offsetof(TItemRec, directionIdx), DIR_COUNT);
+    refused(firstTank + offsetof(TItemRec, color), 0);
+    refused(offsetof(TSnapshotHeader, curScrn), m.ScreenCount());
+    CHECK(RestoreSnapshot(m, good.data(), good.size()));
+
+    // A state without walls is checked against the map it is restored into
+    Match big(3);
+    GenerateMap(big, 3, 3, 5);
+    std::vector<uint8_t> state;
+    SaveSnapshot(big.Synced(), state, 0);
+    CHECK(!RestoreSnapshot(m, state.data(), state.size()));
+    CHECK(WorldHash(m.Synced()) == before);
+}
+
+static const struct {
+    const char *name;
+    void (*run)();
+} UnitTests[] = {
+    {"collision", TestCollision},
+    {"wall_collision", TestWallCollision},
+    {"new_screen_check", TestNewScreenCheck},
+    {"aiming_at_target", TestAimingAtTarget},
+    {"move_tank", TestMoveTank},
+    {"squad", TestSquad},
+    {"snapshot_ranges", TestSnapshotRanges},
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "--golden") == 0) {
+        int failed = 0;
+        for (int i = 2; i < argc; i++)
+            failed += CheckGolden(argv[i]);
+        return failed > 0 ? 1 : 0;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--update") == 0) {
+        int failed = 0;
+        for (int i = 2; i < argc; i++)
+            failed += UpdateGolden(argv[i]);
+        return failed > 0 ? 1 : 0;
+    }
+    int ran = 0;
+    for (const auto &test : UnitTests) {
+        if (argc >= 2 && strcmp(argv[1], test.name) != 0)
+            continue;
+        const int before = failures;
+        test.run();
+        printf("%s: %s\n", test.name, failures == before ? "ok" : "FAILED");
+        ran++;
+    }
+    if (ran == 0) {
+        fprintf(stderr, "Usage: %s [test] | --golden file... | --update file...\n", argv[0]);
+        return 1;
+    }
+    return failures > 0 ? 1 : 0;
+}